@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "binparse/bounded_queue.hpp"
+#include "binparse/parser.hpp"
+#include "binparse/tail.hpp"
+
+namespace bp {
+
+// 后台线程 tail 一个增长中的文件并解码成 LineBatch，经有界队列交给消费端：
+//   - 每批最多 batch_lines 行；读到当前文件末尾时（TailOptions::on_idle）立即交出不满的批，
+//     实时流不会卡在半批
+//   - 跨 chunk 的半行在内部拼接，行偏移是流内累计字节偏移（轮转/截断后不归零）
+//   - 队列满时后台线程阻塞，不再读文件（背压）
+class BatchStream {
+public:
+    // fields：只解码这些列（见 FieldMask）
+    BatchStream(std::string path, TailOptions opt,
+                std::size_t batch_lines = 65536, std::size_t queue_batches = 4,
+                FieldMask fields = {});
+    ~BatchStream();
+    BatchStream(const BatchStream&) = delete;
+    BatchStream& operator=(const BatchStream&) = delete;
+
+    // 阻塞取下一批。tail 结束（inactivity 超时或 stop()）且队列取空后返回 false；
+    // 后台线程的异常在取空后重新抛出。out 里原有的批交还给后台线程复用列的容量，
+    // 所以循环里反复传同一个 out 时稳态下不再分配
+    bool next(LineBatch& out);
+
+    // 任意线程调用：通知 tail 退出并等待后台线程结束，未取走的批被丢弃
+    void stop();
+
+    [[nodiscard]] std::size_t batch_lines() const noexcept { return batch_lines_; }
+
+private:
+    void run();
+    void on_bytes(std::span<const std::byte> chunk);
+    void append(std::span<const std::byte> lines);
+    void push();
+    void join();
+
+    std::string path_;
+    TailOptions opt_;
+    std::size_t batch_lines_;
+    FieldMask   fields_;
+
+    // 仅后台线程访问
+    LineBatch cur_;
+    uint64_t  next_offset_ = 0;
+    LineCarry carry_;
+
+    BoundedQueue<LineBatch> queue_;
+    BoundedQueue<LineBatch> free_; // next() 交还的批，push() 优先取用
+    std::atomic<bool>       stop_{false};
+    std::exception_ptr      err_;
+    std::mutex              join_mu_; // next() 与 stop() 可能在不同线程上 join
+    std::thread             worker_;
+};
+
+} // namespace bp
@@ -0,0 +1,85 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace bp {
+
+// 有界阻塞队列（多生产者/多消费者，mutex + condvar）。满时 push 阻塞，形成背压；
+// close() 后 push 失败，pop 取完剩余元素后返回 false。
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : cap_(capacity ? capacity : 1) {}
+
+    bool push(T v) {
+        std::unique_lock lk(mu_);
+        not_full_.wait(lk, [&] { return q_.size() < cap_ || closed_; });
+        if (closed_) return false;
+        q_.push_back(std::move(v));
+        lk.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // 不阻塞：满或已关闭时返回 false
+    bool try_push(T v) {
+        std::unique_lock lk(mu_);
+        if (closed_ || q_.size() >= cap_) return false;
+        q_.push_back(std::move(v));
+        lk.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(T& out) {
+        std::unique_lock lk(mu_);
+        not_empty_.wait(lk, [&] { return !q_.empty() || closed_; });
+        if (q_.empty()) return false;
+        out = std::move(q_.front());
+        q_.pop_front();
+        lk.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        std::unique_lock lk(mu_);
+        if (q_.empty()) return false;
+        out = std::move(q_.front());
+        q_.pop_front();
+        lk.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard lk(mu_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    [[nodiscard]] bool closed() const {
+        std::lock_guard lk(mu_);
+        return closed_;
+    }
+    [[nodiscard]] std::size_t size() const {
+        std::lock_guard lk(mu_);
+        return q_.size();
+    }
+    [[nodiscard]] std::size_t capacity() const noexcept { return cap_; }
+
+private:
+    const std::size_t       cap_;
+    mutable std::mutex      mu_;
+    std::condition_variable not_full_, not_empty_;
+    std::deque<T>           q_;
+    bool                    closed_ = false;
+};
+
+} // namespace bp
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+
+namespace bp {
+
+// 池计数；可以在另一线程上随时读取
+struct ChunkPoolStats {
+    std::atomic<uint64_t> acquired{0};
+    std::atomic<uint64_t> stalls{0};     // acquire 时没有空闲块、需要等待（背压）
+    std::atomic<uint32_t> in_use{0};     // 当前被租出的块数
+    std::atomic<uint32_t> max_in_use{0};
+};
+
+namespace detail {
+struct ChunkPoolState;
+
+struct ChunkSlot {
+    ChunkPoolState*              pool = nullptr;
+    std::unique_ptr<std::byte[]> buf;
+    std::atomic<uint32_t>        refs{0};
+    uint32_t                     index  = 0;
+    std::size_t                  len    = 0;
+    uint64_t                     offset = 0;
+};
+
+// 最后一个租约释放时把块还给池（池已析构且这是最后一块时一并释放池）
+void release_slot(ChunkSlot* s) noexcept;
+} // namespace detail
+
+// 池中一块缓冲的引用计数租约。复制只做一次原子加，可以把租约（连同指向块内的 span）
+// 交给其他线程，最后一个副本析构时块回到池里。块内容在交出后只读。
+class ChunkLease {
+public:
+    ChunkLease() = default;
+    ChunkLease(const ChunkLease& o) noexcept : s_(o.s_) {
+        if (s_) s_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    ChunkLease(ChunkLease&& o) noexcept : s_(std::exchange(o.s_, nullptr)) {}
+    ChunkLease& operator=(ChunkLease o) noexcept {
+        std::swap(s_, o.s_);
+        return *this;
+    }
+    ~ChunkLease() { reset(); }
+
+    void reset() noexcept {
+        if (s_ && s_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) detail::release_slot(s_);
+        s_ = nullptr;
+    }
+
+    explicit operator bool() const noexcept { return s_ != nullptr; }
+    std::span<const std::byte> bytes() const noexcept { return {s_->buf.get(), s_->len}; }
+    const std::byte* data() const noexcept { return s_->buf.get(); }
+    std::size_t size() const noexcept { return s_->len; }
+    uint64_t offset() const noexcept { return s_->offset; } // 块首字节在流中的偏移
+    uint32_t use_count() const noexcept { return s_ ? s_->refs.load(std::memory_order_relaxed) : 0; }
+
+    // ---- 生产端：交出前填写 ----
+    // 整块容量（ChunkPool::chunk_bytes()）；只有唯一持有者可以写
+    std::span<std::byte> writable() const noexcept;
+    void set_bytes(std::size_t len, uint64_t offset) noexcept {
+        s_->len = len;
+        s_->offset = offset;
+    }
+
+private:
+    friend class ChunkPool;
+    explicit ChunkLease(detail::ChunkSlot* s) noexcept : s_(s) {}
+    detail::ChunkSlot* s_ = nullptr;
+};
+
+// 固定 chunks 块、每块 chunk_bytes 字节的缓冲池。所有块都被租出时 acquire 阻塞，
+// 由此把下游的处理速度反压到读文件的一端。acquire 可以在任意线程调用，租约可以在
+// 任意线程释放；池可以先于租约析构，块内存在最后一个租约释放时回收。
+class ChunkPool {
+public:
+    ChunkPool(std::size_t chunks, std::size_t chunk_bytes);
+    ~ChunkPool();
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    // 阻塞直到有空闲块；close() 后返回空租约
+    ChunkLease acquire();
+    // 最多等 timeout；超时或已关闭时返回空租约
+    ChunkLease acquire_for(std::chrono::milliseconds timeout);
+    ChunkLease try_acquire();
+
+    // 唤醒并拒绝之后的 acquire；已租出的块不受影响
+    void close() noexcept;
+    bool closed() const noexcept;
+
+    std::size_t chunks() const noexcept;
+    std::size_t chunk_bytes() const noexcept;
+    std::size_t available() const noexcept;
+    const ChunkPoolStats& stats() const noexcept;
+
+private:
+    ChunkLease lend(detail::ChunkSlot* s) noexcept;
+
+    detail::ChunkPoolState* st_;
+};
+
+} // namespace bp
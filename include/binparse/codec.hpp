@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace bp {
+
+// 针对 32B 行结构的无损压缩。每行按类型编码，状态只在块内延续，块之间互不依赖：
+//   - 全零行、与上一行相同的行：游程编码
+//   - Data：vldb/bx_cnt/ob_cnt 相对上一 Data 行做差（zigzag varint），6 个 data word
+//     按其中最大位宽统一 bit-pack
+//   - TRG：bx_cnt/ob_cnt/reserved1 相对上一 TRG 行做差
+//   - RDH_L0/L1 及其它行：与最近 8 个同类行之一（packet_counter / hb_packet_counter 预测 +1）
+//     逐字节比较，只存不同的字节和一个字节掩码；各 link 的 RDH 自然留在这 8 个参考里
+// 任意字节流都能还原（包括不足一行的尾部和未识别的行）。
+//
+// 容器格式（小端）：char magic[8] = "BPXZ0001", uint32 block_bytes, uint32 0，
+// 然后若干块，每块 uint32 raw_len, uint32 comp_len, comp_len 字节编码数据。
+struct CodecOptions {
+    std::size_t block_bytes = 1u << 20; // 每块原始字节数（向下取整到 32 的倍数）
+    unsigned    threads     = 1;        // 0 = hardware_concurrency
+};
+
+// 单块：把 raw 编码追加到 out，返回追加的字节数
+std::size_t compress_block(std::span<const std::byte> raw, std::vector<std::byte>& out);
+// 单块：把 comp 解码为恰好 out.size() 字节；数据损坏时抛 ParseError
+void decompress_block(std::span<const std::byte> comp, std::span<std::byte> out);
+
+// 整段压缩成容器格式（块并行）
+std::vector<std::byte> compress(std::span<const std::byte> raw, const CodecOptions& opt = {});
+// 容器格式 → 原始字节（块并行）
+std::vector<std::byte> decompress(std::span<const std::byte> packed, unsigned threads = 1);
+// 容器中所有块的原始字节数之和；不是容器格式时抛 ParseError
+uint64_t decompressed_size(std::span<const std::byte> packed);
+
+// 流式解压：按块顺序把原始字节交给 on_bytes（可直接接 StreamParser::feed），
+// 只用 threads+1 个块大小的缓冲，不生成完整副本。threads>1 时由常驻线程提前解码后面的块，
+// 回调在调用线程上按序执行。交出的 span 在回调返回后即被复用。
+void decompress_stream(std::span<const std::byte> packed,
+                       const std::function<void(std::span<const std::byte>)>& on_bytes,
+                       unsigned threads = 1);
+
+} // namespace bp
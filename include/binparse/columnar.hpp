@@ -0,0 +1,129 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "binparse/mapped_file.hpp"
+#include "binparse/parser.hpp"
+
+namespace bp {
+
+// 列文件中的表：每种行类型一张
+enum class ColumnTable : uint16_t { Data = 0, Trg = 1, RdhL0 = 2, RdhL1 = 3, Undefined = 4 };
+inline constexpr std::size_t kColumnTables = 5;
+// "DATA" / "TRG" / "L0" / "L1" / "UNDEFINED"（与 pybinparse.decode_arrays 的键一致）
+const char* to_string(ColumnTable t) noexcept;
+
+// 元素类型，取值即字节宽度
+enum class ColumnType : uint8_t { U8 = 1, U16 = 2, U32 = 4, U64 = 8 };
+
+template <class T> constexpr ColumnType column_type_of() noexcept {
+    static_assert(std::is_unsigned_v<T> && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8));
+    return static_cast<ColumnType>(sizeof(T));
+}
+
+// 分块列文件（小端，按宿主布局直接写出，读取端 mmap 后零拷贝）：
+//   文件头 64B：char magic[8] = "BPXCOL01", uint32 version, uint32 header_size, 其余为 0
+//   之后是若干块，每块一张表的一段行，长度为 64 的倍数：
+//     块头 32B：uint32 magic "BPXC", uint16 table, uint16 ncols, uint64 rows, uint64 chunk_bytes, uint64 0
+//     ncols 个列描述 48B：char name[24], uint8 type, uint8 pad[7], uint64 data_offset（相对块头）, uint64 bytes
+//     各列数据，起始按 64 字节对齐
+// 每块自带列名与类型，只追加写；写到一半的末块在读取时被忽略。
+class ColumnFileWriter {
+public:
+    // fields：只写这些列（offset 列总会写）；chunk_lines：feed() 攒够这么多行写一批
+    explicit ColumnFileWriter(const std::string& path, FieldMask fields = {}, std::size_t chunk_lines = 65536);
+    ~ColumnFileWriter();
+    ColumnFileWriter(const ColumnFileWriter&) = delete;
+    ColumnFileWriter& operator=(const ColumnFileWriter&) = delete;
+
+    // 原始流字节：跨调用的半行在内部拼接，行偏移按流内累计
+    void feed(std::span<const std::byte> bytes);
+    // 已解码的批：每张非空表写一块（只写已填充的列）
+    void write(const LineBatch& batch);
+    // 把 feed() 攒下的行写出并 flush 到文件
+    void flush();
+    void close();
+
+    [[nodiscard]] uint64_t bytes_written() const noexcept { return bytes_; }
+    [[nodiscard]] uint64_t chunks() const noexcept { return chunks_; }
+    [[nodiscard]] uint64_t lines() const noexcept { return lines_; }
+
+private:
+    struct Column {
+        const char*                name;
+        ColumnType                 type;
+        std::span<const std::byte> bytes;
+    };
+    void write_chunk(ColumnTable t, uint64_t rows, const std::vector<Column>& cols);
+
+    std::string   path_;
+    std::ofstream out_;
+    FieldMask     fields_;
+    std::size_t   chunk_lines_;
+    LineBatch     cur_;
+    uint64_t      next_offset_ = 0;
+    std::array<std::byte, ByteCursor::kLineSize> carry_{};
+    std::size_t   carry_len_ = 0;
+    uint64_t      bytes_ = 0;
+    uint64_t      chunks_ = 0;
+    uint64_t      lines_ = 0;
+    bool          closed_ = false;
+};
+
+// 列文件的只读视图：整个文件 mmap，列数据直接以 span<const T> 交出，不拷贝、不解码
+class ColumnFileReader {
+public:
+    struct ColumnChunk {
+        std::string_view           name;
+        ColumnType                 type;
+        uint64_t                   rows;
+        std::span<const std::byte> bytes;
+
+        // 类型不符时抛 std::invalid_argument
+        template <class T>
+        std::span<const T> as() const {
+            if (type != column_type_of<T>())
+                throw std::invalid_argument("column " + std::string(name) + ": element type mismatch");
+            return {reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+        }
+    };
+    struct Chunk {
+        ColumnTable              table;
+        uint64_t                 rows;
+        uint64_t                 file_offset;
+        std::vector<ColumnChunk> columns;
+        const ColumnChunk* find(std::string_view name) const noexcept;
+    };
+
+    explicit ColumnFileReader(const std::string& path);
+
+    [[nodiscard]] std::span<const Chunk> chunks() const noexcept { return chunks_; }
+    [[nodiscard]] uint64_t rows(ColumnTable t) const noexcept;
+    // 文件末尾不完整的字节（写入端仍在写或异常退出）
+    [[nodiscard]] uint64_t truncated_bytes() const noexcept { return truncated_; }
+
+    // 某表某列在各块中的数据，每块一个 span，按文件顺序；缺该列的块被跳过
+    template <class T>
+    std::vector<std::span<const T>> column(ColumnTable t, std::string_view name) const {
+        std::vector<std::span<const T>> out;
+        for (const auto& c : chunks_)
+            if (c.table == t)
+                if (const auto* col = c.find(name)) out.push_back(col->as<T>());
+        return out;
+    }
+
+private:
+    MappedFile         file_;
+    std::vector<Chunk> chunks_;
+    uint64_t           truncated_ = 0;
+};
+
+} // namespace bp
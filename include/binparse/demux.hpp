@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "binparse/bounded_queue.hpp"
+#include "binparse/parser.hpp"
+
+namespace bp {
+
+// 链路标识：取自当前 RDH_L0
+struct LinkKey {
+    uint16_t cru_id  = 0;
+    uint8_t  link_id = 0;
+    uint16_t fee_id  = 0;
+    bool operator==(const LinkKey&) const = default;
+};
+
+struct LinkKeyHash {
+    std::size_t operator()(const LinkKey& k) const noexcept {
+        const uint64_t v = (uint64_t{k.cru_id} << 24) | (uint64_t{k.link_id} << 16) | k.fee_id;
+        return static_cast<std::size_t>(v * 0x9E3779B97F4A7C15ull >> 16);
+    }
+};
+
+struct DemuxOptions {
+    std::size_t consumers     = 1;          // 消费线程数（link 组数），link 按哈希固定分到某组
+    std::size_t queue_batches = 64;         // 每组队列最多积压的批数，满了 feed() 阻塞（背压）
+    std::size_t batch_bytes   = 64u << 10;  // 单个 link 攒够这么多字节再投递
+    bool        pin_threads   = false;      // Linux：把第 i 个消费线程绑到 CPU first_cpu+i
+    int         first_cpu     = 0;
+};
+
+// 按 (cru_id, link_id, fee_id) 拆分流：每个包的 payload 行（RDH 之后、下一个 RDH_L0 之前的
+// 数据/TRG/未识别行）拷进该 link 的批缓冲，攒满后投递到所属组的有界队列，由该组的消费线程
+// 调用 consumer。同一 link 的批总在同一线程上按流顺序到达。
+class LinkDemux {
+public:
+    using Consumer = std::function<void(const LinkKey&, std::span<const std::byte> lines)>;
+
+    LinkDemux(DemuxOptions opt, Consumer consumer);
+    ~LinkDemux();
+    LinkDemux(const LinkDemux&) = delete;
+    LinkDemux& operator=(const LinkDemux&) = delete;
+
+    // 生产端（单线程）：任意长度 chunk，半行由内部 parser 暂存
+    void feed(std::span<const std::byte> chunk);
+    // 把所有未满的批投递出去
+    void flush();
+    // flush 后关闭队列并等待消费线程结束；消费者抛出的第一个异常在此重新抛出
+    void close();
+
+    std::size_t group_of(const LinkKey& k) const noexcept { return LinkKeyHash{}(k) % groups_.size(); }
+    // RDH_L0 出现之前的 payload 行无法归属，被丢弃
+    std::size_t orphan_lines() const noexcept { return orphans_; }
+
+private:
+    struct Batch {
+        LinkKey                key;
+        std::vector<std::byte> bytes;
+    };
+
+    struct Group {
+        explicit Group(std::size_t cap) : queue(cap) {}
+        BoundedQueue<Batch> queue;
+        std::thread         worker;
+    };
+
+    // BasicStreamParser 的 handler：只记当前 link 并搬运行
+    struct Router {
+        LinkDemux* d;
+        void on_rdh_l0(const RDH_L0& r, std::span<const std::byte>) { d->switch_link(r); }
+        void on_data_line(const DataLine&, std::span<const std::byte> line) { d->route(line); }
+        void on_trg_line(const TrgLine&, std::span<const std::byte> line) { d->route(line); }
+        void on_packet(const Packet& p) { d->route(p.block); }
+    };
+
+    void switch_link(const RDH_L0& r);
+    void route(std::span<const std::byte> line);
+    void dispatch(Batch& b);
+    void run_group(std::size_t gi);
+    std::vector<std::byte> take_buffer();
+
+    DemuxOptions opt_;
+    Consumer     consumer_;
+    BasicStreamParser<Router> parser_{Router{this}};
+
+    std::unordered_map<LinkKey, Batch, LinkKeyHash> pending_;
+    Batch*      cur_ = nullptr;
+    std::size_t orphans_ = 0;
+    bool        closed_ = false;
+
+    std::vector<std::unique_ptr<Group>> groups_;
+
+    // 消费端用完的缓冲回收给生产端，稳态下不再分配
+    BoundedQueue<std::vector<std::byte>> free_;
+
+    std::mutex         err_mu_;
+    std::exception_ptr err_;
+};
+
+} // namespace bp
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "binparse/synth.hpp"
+
+namespace bp {
+
+// 写入端与读取端在同一主机上比较的单调时钟（libstdc++/libc++ 在 Linux 上是 CLOCK_MONOTONIC，跨进程可比）
+inline uint64_t monotonic_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// 数据源：每次调用把下一条记录（整包或整行块）追加到 out；返回 false 表示没有更多数据
+using DmaSource = std::function<bool(std::vector<std::byte>& out)>;
+
+// 合成流，每条记录一个包
+DmaSource synth_source(SynthOptions opt);
+// 已录制的文件，每条记录最多 block_bytes（按整行截断）；loop=true 时读到末尾后从头再来
+DmaSource file_source(std::string path, bool loop = false, std::size_t block_bytes = 64u << 10);
+
+// 模拟 CRU DMA 往文件里追加数据的写入端，用于端到端测 tail 延迟。
+//   - 记录攒到至少 write_bytes 后一次写出，所以每次写入都在记录边界结束
+//   - 每写 burst_writes 次按 rate_mbps 补齐间隔（令牌桶，长期平均速率不漂移）
+//   - rotate_bytes/truncate_bytes 在两次写入之间触发：rotate 把文件改名为 path + ".1" 再新建，
+//     truncate 把文件截回 0 字节
+//   - timestamp=true 时每次写入前把 monotonic_ns() 写进块内每个 TRG 行的 reserved1（偏移 24），
+//     读取端用 now - reserved1 得到 写入→回调 的延迟。这会改写数据（录制文件原有的 reserved1 丢失），
+//     所以默认关闭，由调用方显式打开
+struct DmaSimOptions {
+    double      rate_mbps      = 0;         // MB/s（10^6 字节）；0 = 不限速
+    std::size_t write_bytes    = 64u << 10;
+    std::size_t burst_writes   = 1;
+    uint64_t    total_bytes    = 0;         // 0 = 不限（合成源和 loop 时要靠 duration_s 或 stop 结束）
+    double      duration_s     = 0;         // 0 = 不限
+    uint64_t    rotate_bytes   = 0;         // 0 = 不轮转
+    uint64_t    truncate_bytes = 0;         // 0 = 不截断
+    bool        timestamp      = false;
+    bool        append         = false;     // true：接着已有文件写；false：先截断
+
+    // 外部停止标志：在下一次写入前检查
+    const std::atomic<bool>* stop = nullptr;
+};
+
+struct DmaSimStats {
+    uint64_t bytes       = 0;
+    uint64_t writes      = 0;
+    uint64_t rotations   = 0;
+    uint64_t truncations = 0;
+    uint64_t stamped     = 0; // 写入了时间戳的 TRG 行
+    double   seconds     = 0;
+};
+
+// 按 opt 把 src 写进 path，直到数据源耗尽、达到 total_bytes/duration_s 或 stop 置位。
+// 打开或写入失败时抛 std::runtime_error
+DmaSimStats run_dma_sim(const std::string& path, const DmaSimOptions& opt, const DmaSource& src);
+
+} // namespace bp
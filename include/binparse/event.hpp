@@ -0,0 +1,133 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "binparse/parser.hpp"
+
+namespace bp {
+
+inline constexpr uint32_t kBxPerOrbit = 3564;
+
+struct EventBuilderOptions {
+    uint16_t    window   = 0;               // Data 行 bx 落在 TRG bx ± window 内即归属该触发
+    uint32_t    max_lag  = 2 * kBxPerOrbit; // 容忍的乱序（bx）：最新时间超过 t + window + max_lag 时发出 t 的事件
+    std::size_t max_open = 4096;            // 同时打开的事件数上限，满了提前发出最早的事件
+    std::size_t max_hits = 1u << 16;        // 单个事件的 Data 行上限，超出的计入 dropped_hits
+    std::size_t max_early = 1u << 16;       // 先于 TRG 到达、暂存待匹配的 Data 行上限
+};
+
+// 事件中的一行 Data
+struct EventHit {
+    uint64_t                offset = 0;  // 在流中的字节偏移
+    std::array<uint32_t, 6> words{};
+    int16_t                 dbx    = 0;  // 相对触发的 bx 差（Data 时间 - TRG 时间）
+    uint8_t                 vldb_id = 0;
+};
+
+struct Event {
+    uint32_t              orbit      = 0; // TRG ob_cnt 低 32 位
+    uint16_t              bx         = 0; // TRG bx_cnt 低 12 位
+    uint32_t              trg_lines  = 0; // 同一 (orbit, bx) 的 TRG 行数（多条 link 各报一次）
+    uint64_t              trg_offset = 0; // 第一条 TRG 行的偏移
+    bool                  forced     = false; // 因 max_open 提前发出，之后到达的 Data 行不再计入
+    bool                  truncated  = false; // Data 行超过 max_hits
+    std::vector<EventHit> hits;               // 按到达顺序
+    std::array<uint64_t, 4> vldb_mask{};      // 出现过的 header_vldb_id
+
+    bool has_vldb(uint8_t v) const noexcept { return (vldb_mask[v >> 6] >> (v & 63)) & 1; }
+};
+
+struct EventBuilderStats {
+    uint64_t trg_lines     = 0;
+    uint64_t events        = 0; // 已发出的事件
+    uint64_t forced        = 0; // 其中因 max_open 提前发出的
+    uint64_t data_lines    = 0;
+    uint64_t matched       = 0; // 归入某个事件的 Data 行（含 early_matched）
+    uint64_t early_matched = 0; // 先于 TRG 到达、后来被认领的
+    uint64_t orphan_data   = 0; // 窗口内始终没有 TRG
+    uint64_t late_data     = 0; // 到达时所属时间已发出
+    uint64_t late_trg      = 0; // 同上，TRG 行被丢弃
+    uint64_t dropped_hits  = 0; // 超出 max_hits / max_early
+    std::size_t max_open_seen = 0;
+};
+
+// 触发-数据事件组装：按时间 t = orbit * 3564 + bx 把各 header_vldb_id 的 Data 行归到
+// 窗口内最近的 TRG。打开的事件放在按 t 取模的环里（容量约为 window + max_lag，取 2 的幂），
+// 查找和插入都是 O(window)，不做哈希；事件对象和 hits 缓冲循环复用。
+//   - 乱序：只要 Data/TRG 比流中出现过的最新时间晚不超过 max_lag，就还能归位；
+//     Data 先于 TRG 到达时暂存在所属时间的槽里，TRG 到达时认领窗口内的暂存行
+//   - 最新时间越过 t + window + max_lag 后按 t 升序发出事件，事件对象在 sink 返回后复用
+//   - 内存上界：环 + max_open 个事件 × max_hits + max_early 行暂存
+// 单线程；按流顺序调用 add()，结束时 flush()。
+class EventBuilder {
+public:
+    using Sink = std::function<void(const Event&)>;
+
+    explicit EventBuilder(Sink sink, EventBuilderOptions opt = {});
+
+    static FieldMask required_fields() noexcept;
+
+    // 逐行接口
+    void add_trigger(uint64_t ob_cnt, uint64_t bx_cnt, uint64_t offset);
+    void add_data(uint32_t ob_cnt, uint16_t bx_cnt, uint8_t vldb_id,
+                  std::span<const uint32_t, 6> words, uint64_t offset);
+    // 按 batch.type 的流顺序加入 decode_batch 的结果；缺列时抛 std::invalid_argument
+    void add(const LineBatch& batch);
+    // 发出所有打开的事件（流结束）；之后再到达的更早时间视为迟到
+    void flush();
+
+    const EventBuilderStats& stats() const noexcept { return stats_; }
+    std::size_t open_events() const noexcept { return open_; }
+    const EventBuilderOptions& options() const noexcept { return opt_; }
+
+private:
+    static constexpr uint32_t kNone = ~0u;
+    static constexpr int64_t  kAdvanceStep = 64;
+
+    struct Slot {
+        int64_t  t     = -1;    // 占用该槽的时间，-1 为空
+        uint32_t event = kNone; // events_ 下标
+        uint32_t early = kNone; // early_ 下标
+    };
+
+    static int64_t time_of(uint64_t orbit, uint64_t bx) noexcept {
+        return static_cast<int64_t>(orbit) * kBxPerOrbit + static_cast<int64_t>(bx);
+    }
+    Slot& slot(int64_t t) noexcept { return ring_[static_cast<std::size_t>(t) & mask_]; }
+
+    int64_t next_occupied(int64_t from, int64_t end) const noexcept;
+    void occupy(Slot& s, int64_t t) noexcept;
+    void release(Slot& s) noexcept;
+    void observe(int64_t t);
+    void advance_to(int64_t horizon);
+    void finalize(int64_t t);
+    void emit(uint32_t ev, bool forced);
+    void attach(Event& e, int64_t dbx, uint8_t vldb_id, std::span<const uint32_t, 6> words, uint64_t offset);
+    uint32_t alloc_event();
+    uint32_t alloc_early();
+
+    Sink                  sink_;
+    EventBuilderOptions   opt_;
+    std::vector<Slot>     ring_;
+    std::vector<uint64_t> occupied_; // ring_ 的占用位图，收尾时跳过空槽
+    std::size_t           mask_ = 0;
+
+    std::vector<Event>    events_;
+    std::vector<uint32_t> free_events_;
+    std::vector<std::vector<EventHit>> early_;
+    std::vector<uint32_t> free_early_;
+    std::size_t           early_hits_ = 0;
+    std::size_t           open_ = 0;
+
+    bool    started_ = false;
+    int64_t newest_  = 0;  // 出现过的最新时间
+    int64_t horizon_ = 0;  // 不晚于此的时间都已发出
+
+    EventBuilderStats stats_;
+};
+
+} // namespace bp
@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace bp {
+
+// 延迟/大小直方图：对数-线性分桶，每个 2 的幂区间再分 32 个子桶，
+// 分位数的相对误差 < 1/32；覆盖整个 uint64 范围，内存固定（约 15 KiB）。单线程使用。
+class LatencyHistogram {
+public:
+    void add(uint64_t v) noexcept;
+    void merge(const LatencyHistogram& o) noexcept;
+    void reset() noexcept { *this = LatencyHistogram{}; }
+
+    uint64_t count() const noexcept { return n_; }
+    uint64_t min() const noexcept { return n_ ? min_ : 0; }
+    uint64_t max() const noexcept { return max_; }
+    double   mean() const noexcept { return n_ ? static_cast<double>(sum_) / static_cast<double>(n_) : 0.0; }
+    // q ∈ [0, 1]；返回第 q 分位所在桶的上界（不超过 max()）
+    uint64_t percentile(double q) const noexcept;
+    // 按升序对每个非空桶调用 f(桶上界, 计数)
+    template <class F>
+    void for_each_bucket(F&& f) const {
+        for (std::size_t i = 0; i < kBuckets; ++i)
+            if (counts_[i]) f(bucket_upper(i), counts_[i]);
+    }
+
+    static constexpr int         kSubBits = 5;
+    static constexpr std::size_t kBuckets = std::size_t{64 - kSubBits + 1} << kSubBits;
+    static std::size_t bucket_of(uint64_t v) noexcept;
+    static uint64_t    bucket_upper(std::size_t idx) noexcept;
+
+private:
+    friend class AtomicLatencyHistogram;
+
+    std::array<uint64_t, kBuckets> counts_{};
+    uint64_t n_   = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+
+// 与 LatencyHistogram 同样分桶的无锁版本：record() 只做 relaxed 原子加，可在任意线程记录、
+// 任意线程 snapshot()；快照就是一个 LatencyHistogram，分位数也由它计算
+class AtomicLatencyHistogram {
+public:
+    void record(uint64_t v) noexcept;
+    // 各桶分别原子读取，与并发的 record() 之间不是同一时刻的一致快照
+    LatencyHistogram snapshot() const noexcept;
+    void reset() noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets> counts_{};
+    std::atomic<uint64_t> n_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> min_{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> max_{0};
+};
+
+} // namespace bp
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace bp {
+
+// 一个 RDH_L0 的位置。按 (orbit, bc, offset) 排序存放，便于二分查找。
+struct IndexEntry {
+    uint32_t orbit;
+    uint16_t bc;
+    uint16_t cru_id;
+    uint16_t fee_id;
+    uint8_t  link_id;
+    uint8_t  reserved;
+    uint32_t size;     // 到下一个包的字节数（offset_new_packet，不可信时取文件中下一个 RDH 的距离）
+    uint64_t offset;   // RDH_L0 行在数据文件中的偏移
+};
+static_assert(sizeof(IndexEntry) == 24);
+
+// 数据文件中的字节区间 [begin, end)
+struct ByteRange {
+    uint64_t begin = 0;
+    uint64_t end   = 0;
+};
+
+// 查询条件；未设置的字段不参与过滤
+struct IndexQuery {
+    uint32_t orbit_lo = 0;
+    uint32_t orbit_hi = UINT32_MAX;
+    std::optional<uint16_t> cru_id;
+    std::optional<uint8_t>  link_id;
+    std::optional<uint16_t> fee_id;
+};
+
+// RDH_L0 旁路索引。sidecar 文件格式（小端）：
+//   char magic[8] = "BPXIDX01", uint32 entry_size, uint32 fingerprint（数据开头至多 4 KiB 的 FNV-1a，0 = 未记录）,
+//   uint64 count, uint64 data_size, 然后 count 个 IndexEntry
+class RdhIndex {
+public:
+    RdhIndex() = default;
+
+    // 扫描内存中的数据；nthreads>1 时按 RDH_L0 边界分段并行扫描
+    static RdhIndex build(std::span<const std::byte> data, unsigned nthreads = 1);
+    // mmap 数据文件后 build
+    static RdhIndex build_file(const std::string& data_path, unsigned nthreads = 1);
+
+    void save(const std::string& idx_path) const;
+    static RdhIndex load(const std::string& idx_path);
+    // 同上，并与数据文件对照：数据比建索引时短，或开头的指纹不同（被改写/轮转）时抛 ParseError。
+    // 数据变长（追加写入）时照常返回，索引只覆盖前 data_size() 字节
+    static RdhIndex load(const std::string& idx_path, const std::string& data_path);
+
+    [[nodiscard]] std::span<const IndexEntry> entries() const noexcept { return entries_; }
+    [[nodiscard]] uint64_t data_size() const noexcept { return data_size_; }
+    [[nodiscard]] uint32_t fingerprint() const noexcept { return fingerprint_; }
+
+    // orbit ∈ [orbit_lo, orbit_hi] 的条目（二分定位），按排序顺序
+    [[nodiscard]] std::span<const IndexEntry> orbit_window(uint32_t orbit_lo, uint32_t orbit_hi) const;
+
+    // 满足条件的包所占的字节区间，按文件偏移排序，相邻区间合并
+    [[nodiscard]] std::vector<ByteRange> query(const IndexQuery& q) const;
+
+private:
+    std::vector<IndexEntry> entries_;
+    uint64_t                data_size_ = 0;
+    uint32_t                fingerprint_ = 0;
+};
+
+// 默认 sidecar 路径：<data>.bpxidx
+inline std::string index_path_for(const std::string& data_path) { return data_path + ".bpxidx"; }
+
+} // namespace bp
@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "binparse/demux.hpp"
+#include "binparse/parser.hpp"
+
+namespace bp {
+
+enum class AnomalyKind : uint8_t {
+    PacketCounterGap,  // RDH_L0.packet_counter 不是上一页 +1（mod 256）；count = 丢失的页数
+    HbCounterGap,      // RDH_L1.hb_packet_counter 不是帧内上一页 +1（新帧应从 0 开始）
+    OrbitRegress,      // 同一 link 的 RDH_L0.orbit 比上一页小
+    BcRegress,         // orbit 相同而 bc 比上一页小
+    MissingRdhL1,      // RDH_L0 之后不是 RDH_L1
+    TrgDataBxMismatch, // Data.bx_cnt 与前一个 TRG 的 bx_cnt（低 12 位）不一致；count = run 内不一致行数
+    TrgDataObMismatch, // Data.ob_cnt 与前一个 TRG 的 ob_cnt（低 32 位）不一致
+};
+inline constexpr std::size_t kAnomalyKinds = 7;
+
+const char* to_string(AnomalyKind k) noexcept;
+
+// 一条异常：offset 是出问题那一行在流中的字节偏移，expected/got 是对应字段的期望值与实际值
+struct Anomaly {
+    uint64_t    offset   = 0;
+    uint32_t    expected = 0;
+    uint32_t    got      = 0;
+    uint32_t    count    = 1;
+    LinkKey     link;
+    AnomalyKind kind     = AnomalyKind::PacketCounterGap;
+};
+
+struct IntegrityStats {
+    uint64_t packets    = 0; // 检查过的 RDH_L0
+    uint64_t trg_lines  = 0;
+    uint64_t data_lines = 0; // 与 TRG 比对过的 Data 行（link 或 TRG 未知的不计）
+    std::array<uint64_t, kAnomalyKinds> anomalies{};
+
+    uint64_t total_anomalies() const noexcept {
+        uint64_t n = 0;
+        for (auto v : anomalies) n += v;
+        return n;
+    }
+};
+
+// 按 link 检查流的连续性，直接在 decode_batch 的列上运行：
+//   - 按 LineBatch::type 的同类型 run 推进各列游标；RDH 行逐页检查 packet_counter、
+//     hb_packet_counter、(orbit, bc) 单调，并切换当前 link
+//   - 一段 Data run 与它前面最近的 TRG 比对 bx_cnt/ob_cnt：先对整段列做无分支的比较计数
+//     （可向量化），只有存在不一致时才逐行定位，每段至多产生两条记录
+// 批与批之间保留每个 link 的状态，按流顺序逐批调用 check() 即可检查任意长的流。
+// 需要的列见 required_fields()；缺列时 check() 抛 std::invalid_argument。
+class IntegrityChecker {
+public:
+    static FieldMask required_fields() noexcept;
+
+    // 检查一批，异常追加到 out，返回本批新增的条数
+    std::size_t check(const LineBatch& batch, std::vector<Anomaly>& out);
+
+    const IntegrityStats& stats() const noexcept { return stats_; }
+    std::size_t links() const noexcept { return links_.size(); }
+    void reset();
+
+private:
+    struct LinkState {
+        LinkKey  key;
+        uint32_t orbit = 0;
+        uint16_t bc = 0;
+        uint8_t  packet_counter = 0;
+        uint16_t hb_packet_counter = 0;
+        bool     stop = true;       // 上一页结束了 HB 帧（第一页应从 0 开始）
+        bool     new_orbit = false; // 当前页的 orbit 与上一页不同
+        bool     has_trg = false;
+        uint16_t trg_bx = 0;
+        uint32_t trg_ob = 0;
+    };
+
+    void on_rdh_l0(const LineBatch& b, std::size_t k, std::vector<Anomaly>& out);
+    void on_rdh_l1(const LineBatch& b, std::size_t k, std::vector<Anomaly>& out);
+    void check_data_run(const LineBatch& b, std::size_t k0, std::size_t n, std::vector<Anomaly>& out);
+    void emit(std::vector<Anomaly>& out, AnomalyKind kind, uint64_t offset,
+              uint32_t expected, uint32_t got, uint32_t count = 1);
+
+    std::unordered_map<LinkKey, LinkState, LinkKeyHash> links_;
+    LinkState*     cur_ = nullptr;     // 最近一个 RDH_L0 所属的 link
+    bool           pending_l1_ = false; // 上一行是 RDH_L0
+    uint64_t       pending_l1_offset_ = 0;
+    IntegrityStats stats_;
+};
+
+} // namespace bp
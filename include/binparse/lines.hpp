@@ -0,0 +1,401 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <iostream>
+#include <iomanip>
+
+#include "binparse/bytecursor.hpp"
+
+// 32B 行的布局与逐字段解码。放在头文件里，便于 BasicStreamParser 等模板内联。
+
+namespace bp {
+
+enum class LineType : uint16_t {
+    Data      = 0,
+    TRG       = 0xBBBB,
+    RDH_L0    = 0x0007,
+    RDH_L1    = 0x0003,
+    Sync      = 0xAAAA,
+    Heartbeat = 0xEEEE,
+    Undefined = 0xFFFF
+};
+
+// 行模式下 block 是一条未识别的行；包模式下 block 是整个包（RDH 起到 memory_size 为止），
+// payload 是 RDH 头之后的部分
+struct Packet {
+    std::span<const std::byte> block;
+    std::span<const std::byte> payload{};
+};
+
+struct Heartbeat {
+    std::array<std::span<const std::byte>, 2> lines;
+};
+
+struct DataLine {
+    uint8_t     header_type; // 0xAC
+    uint8_t     header_vldb_id;
+    uint16_t    bx_cnt; // 12 bits
+    uint32_t    ob_cnt;
+    uint32_t    data_word0;
+    uint32_t    data_word1;
+    uint32_t    data_word2;
+    uint32_t    data_word3;
+    uint32_t    data_word4;
+    uint32_t    data_word5;
+    void display() const {
+        std::ios old(nullptr);
+        old.copyfmt(std::cout);
+        std::cout << std::hex << std::setfill('0')
+                  << "\n[DATA] hdr=" << std::setw(2) << (int)header_type
+                  << " vldb_id=" << std::setw(2) << (int)header_vldb_id
+                  << " bx=" << std::setw(4) << bx_cnt
+                  << " ob=" << std::setw(8) << ob_cnt
+                  << " dw0=" << std::setw(8) << data_word0
+                  << " dw1=" << std::setw(8) << data_word1
+                  << " dw2=" << std::setw(8) << data_word2
+                  << " dw3=" << std::setw(8) << data_word3
+                  << " dw4=" << std::setw(8) << data_word4
+                  << " dw5=" << std::setw(8) << data_word5;
+        std::cout.copyfmt(old);
+    }
+};
+
+struct TrgLine {
+    uint32_t    header_type; // 0xBBBB
+    uint64_t    bx_cnt;
+    uint64_t    ob_cnt;
+    uint32_t    reserved0;
+    uint64_t    reserved1;
+    void display() const {
+        std::ios old(nullptr);
+        old.copyfmt(std::cout);
+        std::cout << std::hex << std::setfill('0')
+                  << "\n[TRG ] hdr=" << std::setw(4) << header_type
+                  << " bx=" << std::setw(16) << bx_cnt
+                  << " ob=" << std::setw(16) << ob_cnt;
+        std::cout.copyfmt(old);
+    }
+};
+
+struct RDH_L0{
+    uint8_t     header_version;
+    uint8_t     header_size;
+    uint16_t    fee_id;
+    uint8_t     priority_bit;
+    uint8_t     system_id;
+    uint16_t    reserved0;
+    uint16_t    offset_new_packet;
+    uint16_t    memory_size;
+    uint8_t     link_id;
+    uint8_t     packet_counter;
+    uint16_t    cru_id;     // 12 bits
+    uint8_t     dw;         // 4 bits
+    uint16_t    bc;         // 12 bits
+    uint32_t    reserved1;  // 20 bits
+    uint32_t    orbit;
+    uint8_t     data_format;
+    uint32_t    reserved2;  // 24 bits
+    uint32_t    reserved3;
+    void display() const {
+        std::ios old(nullptr);
+        old.copyfmt(std::cout);
+        std::cout << std::dec << std::setfill(' ')
+                  << "\n[RDH_L0]"
+                  << " version=" << (int)header_version
+                  << " size=" << (int)header_size
+                  << " fee_id=" << fee_id
+                  << " priority=" << (int)priority_bit
+                  << " system_id=" << (int)system_id
+                  << " offset_new_packet=" << offset_new_packet
+                  << " mem_size=" << memory_size
+                  << " link=" << (int)link_id
+                  << " pkt_cnt=" << (int)packet_counter
+                  << " cru_id=" << cru_id
+                  << " dw=" << (int)dw
+                  << " bc=" << bc
+                  << " orbit=" << orbit
+                  << " fmt=" << (int)data_format;
+        std::cout.copyfmt(old);
+    }
+};
+struct RDH_L1{
+    uint32_t    trg_type;
+    uint16_t    hb_packet_counter;
+    uint8_t     stop_bit;
+    uint8_t     reserved0;
+    uint32_t    reserved1;
+    uint32_t    reserved2;
+    uint32_t    detector_field;
+    uint16_t    par_bit;
+    uint16_t    reserved3;
+    uint32_t    reserved4;
+    uint32_t    reserved5;
+    void display() const {
+        std::ios old(nullptr);
+        old.copyfmt(std::cout);
+        std::cout << std::dec
+                  << "\n[RDH_L1]"
+                  << " trg_type=" << trg_type
+                  << " hb_cnt=" << hb_packet_counter
+                  << " stop=" << (int)stop_bit
+                  << " detector_field=" << detector_field
+                  << " par_bit=" << par_bit;
+        std::cout.copyfmt(old);
+    }
+};
+
+namespace detail {
+
+// 不做边界检查的小端加载，调用方保证 p 起有 sizeof(T) 字节
+template <class T>
+inline T ld(const std::byte* p) noexcept {
+    T v; std::memcpy(&v, p, sizeof(T));
+    if constexpr (sizeof(T) > 1 && std::endian::native == std::endian::big) v = std::byteswap(v);
+    return v;
+}
+
+inline uint8_t le8_at(std::span<const std::byte> s, std::size_t off) {
+    if (off + 1 > s.size()) return 0;
+    uint8_t v; std::memcpy(&v, s.data()+off, 1);
+    return v;
+}
+inline uint16_t le16_at(std::span<const std::byte> s, std::size_t off) {
+    if (off + 2 > s.size()) return 0;
+    uint16_t v; std::memcpy(&v, s.data()+off, 2);
+    if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
+    return v;
+}
+inline uint32_t le32_at(std::span<const std::byte> s, std::size_t off) {
+    if (off + 4 > s.size()) return 0;
+    uint32_t v; std::memcpy(&v, s.data()+off, 4);
+    if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
+    return v;
+}
+inline uint64_t le64_at(std::span<const std::byte> s, std::size_t off) {
+    if (off + 8 > s.size()) return 0;
+    uint64_t v; std::memcpy(&v, s.data()+off, 8);
+    if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
+    return v;
+}
+
+namespace off_L0 {
+    constexpr std::size_t header_version   = 0; // uint8_t
+    constexpr std::size_t header_size      = 1; // uint8_t
+    constexpr std::size_t fee_id           = 2; // uint16_t
+    constexpr std::size_t priority_bit     = 4; // uint8_t
+    constexpr std::size_t system_id        = 5; // uint8_t
+    constexpr std::size_t reserved0        = 6; // uint16_t
+    constexpr std::size_t offset_new_packet= 8; // uint16_t
+    constexpr std::size_t memory_size      = 10; // uint16_t
+    constexpr std::size_t link_id          = 12; // uint8_t
+    constexpr std::size_t packet_counter   = 13; // uint8_t
+    constexpr std::size_t cru_id           = 14; // uint16_t (12 bits)
+    constexpr std::size_t dw               = 15; // uint8_t  (4 bits)
+    constexpr std::size_t bc               = 16; // uint16_t (12 bits
+    constexpr std::size_t reserved1        = 17; // uint32_t (20 bits)
+    constexpr std::size_t orbit            = 20; // uint32_t
+    constexpr std::size_t data_format      = 24; // uint8_t
+    constexpr std::size_t reserved2        = 25; // uint32_t (24 bits)
+    constexpr std::size_t reserved3        = 28; // uint32_t
+}
+namespace off_L1 {
+    constexpr std::size_t trg_type          = 0; // uint32_t
+    constexpr std::size_t hb_packet_counter = 4; // uint16_t
+    constexpr std::size_t stop_bit          = 6; // uint8_t
+    constexpr std::size_t reserved0         = 7; // uint8_t
+    constexpr std::size_t reserved1         = 8; // uint32_t
+    constexpr std::size_t reserved2         = 12; // uint32_t
+    constexpr std::size_t detector_field    = 16; // uint32_t
+    constexpr std::size_t par_bit           = 20; // uint16_t
+    constexpr std::size_t reserved3         = 22; // uint16_t
+    constexpr std::size_t reserved4         = 24; // uint32_t
+    constexpr std::size_t reserved5         = 28; // uint32_t
+}
+namespace off_data {
+    constexpr std::size_t header_type = 0; // uint8_t
+    constexpr std::size_t header_vldb_id = 1; // uint8_t
+    constexpr std::size_t bx_cnt = 2; // uint16_t
+    constexpr std::size_t ob_cnt = 4; // uint32_t
+    constexpr std::size_t data_word0 = 8; // uint32_t
+    constexpr std::size_t data_word1 = 12; // uint32_t
+    constexpr std::size_t data_word2 = 16; // uint32_t
+    constexpr std::size_t data_word3 = 20; // uint32_t
+    constexpr std::size_t data_word4 = 24; // uint32_t
+    constexpr std::size_t data_word5 = 28; // uint32_t
+}
+namespace off_trg {
+    constexpr std::size_t header_type = 0; // uint32_t
+    constexpr std::size_t bx_cnt = 4;   // uint64_t
+    constexpr std::size_t ob_cnt = 12;  // uint64_t
+    constexpr std::size_t reserved0 = 20; // uint32_t
+    constexpr std::size_t reserved1 = 24; // uint64_t
+}
+
+} // namespace detail
+
+// 单行标量分类；批量请用 classify_lines()
+inline LineType classify_line(std::span<const std::byte> line) {
+    uint16_t t = detail::le16_at(line, 0);   // 头2字节的小端
+    uint8_t low = static_cast<uint8_t>(t & 0xff);
+    if (low == 0xac) return LineType::Data;
+    if (low == 0xbb) return LineType::TRG;
+    if (low == 0x07) return LineType::RDH_L0;
+    if (low == 0x03) return LineType::RDH_L1;
+    return LineType::Undefined;
+}
+
+inline RDH_L0 parse_rdh_l0(std::span<const std::byte> line) {
+    using namespace detail;
+    RDH_L0 r{};
+    r.header_version    = le8_at(line, off_L0::header_version);
+    r.header_size       = le8_at(line, off_L0::header_size);
+    r.fee_id            = le16_at(line, off_L0::fee_id);
+    r.priority_bit      = le8_at(line, off_L0::priority_bit);
+    r.system_id         = le8_at(line, off_L0::system_id);
+    r.reserved0         = le16_at(line, off_L0::reserved0);
+    r.offset_new_packet = le16_at(line, off_L0::offset_new_packet);
+    r.memory_size       = le16_at(line, off_L0::memory_size);
+    r.link_id           = le8_at(line, off_L0::link_id);
+    r.packet_counter    = le8_at(line, off_L0::packet_counter);
+    r.cru_id            = le16_at(line, off_L0::cru_id) & 0x0FFF; // 12 bits
+    r.dw                = (le8_at(line, off_L0::dw) >> 4) & 0x0F; // 4 bits
+    r.bc                = le16_at(line, off_L0::bc) & 0x0FFF; // 12 bits
+    r.reserved1         = (le32_at(line, off_L0::reserved1) & 0x00FFFFF0) >> 4;
+    r.orbit             = le32_at(line, off_L0::orbit);
+    r.data_format       = le8_at(line, off_L0::data_format);
+    r.reserved2         = (le32_at(line, off_L0::reserved2) & 0x00FFFFFF);
+    r.reserved3         = le32_at(line, off_L0::reserved3);
+    return r;
+}
+
+inline RDH_L1 parse_rdh_l1(std::span<const std::byte> line) {
+    using namespace detail;
+    RDH_L1 r{};
+    r.trg_type          = le32_at(line, off_L1::trg_type);
+    r.hb_packet_counter = le16_at(line, off_L1::hb_packet_counter);
+    r.stop_bit          = le8_at(line, off_L1::stop_bit);
+    r.reserved0         = le8_at(line, off_L1::reserved0);
+    r.reserved1         = le32_at(line, off_L1::reserved1);
+    r.reserved2         = le32_at(line, off_L1::reserved2);
+    r.detector_field    = le32_at(line, off_L1::detector_field);
+    r.par_bit           = le16_at(line, off_L1::par_bit);
+    r.reserved3         = le16_at(line, off_L1::reserved3);
+    r.reserved4         = le32_at(line, off_L1::reserved4);
+    r.reserved5         = le32_at(line, off_L1::reserved5);
+    return r;
+}
+
+inline DataLine parse_data_line(std::span<const std::byte> line) {
+    using namespace detail;
+    DataLine r{};
+    r.header_type   = le8_at(line, off_data::header_type);
+    r.header_vldb_id= le8_at(line, off_data::header_vldb_id);
+    r.bx_cnt        = (le16_at(line, off_data::bx_cnt) & 0x0FFF); // 12 bits
+    r.ob_cnt        = le32_at(line, off_data::ob_cnt);
+    r.data_word0    = le32_at(line, off_data::data_word0);
+    r.data_word1    = le32_at(line, off_data::data_word1);
+    r.data_word2    = le32_at(line, off_data::data_word2);
+    r.data_word3    = le32_at(line, off_data::data_word3);
+    r.data_word4    = le32_at(line, off_data::data_word4);
+    r.data_word5    = le32_at(line, off_data::data_word5);
+    return r;
+}
+
+inline TrgLine parse_trg_line(std::span<const std::byte> line) {
+    using namespace detail;
+    TrgLine r{};
+    r.header_type = le32_at(line, off_trg::header_type);
+    r.bx_cnt      = le64_at(line, off_trg::bx_cnt);
+    r.ob_cnt      = le64_at(line, off_trg::ob_cnt);
+    r.reserved0   = le32_at(line, off_trg::reserved0);
+    r.reserved1   = le64_at(line, off_trg::reserved1);
+    return r;
+}
+
+// ---------- 惰性视图 ----------
+// 32B 行上的只读视图：只保存行指针，字段在访问时才加载并掩码，没用到的字段不产生任何指令。
+// 行必须完整（parser 交出的行总是 32B）。decode() 得到与 parse_* 相同的完整结构。
+
+class RdhL0View {
+public:
+    explicit RdhL0View(std::span<const std::byte> line) noexcept : p_(line.data()) {}
+    uint8_t  header_version()    const noexcept { return ld<uint8_t>(detail::off_L0::header_version); }
+    uint8_t  header_size()       const noexcept { return ld<uint8_t>(detail::off_L0::header_size); }
+    uint16_t fee_id()            const noexcept { return ld<uint16_t>(detail::off_L0::fee_id); }
+    uint8_t  priority_bit()      const noexcept { return ld<uint8_t>(detail::off_L0::priority_bit); }
+    uint8_t  system_id()         const noexcept { return ld<uint8_t>(detail::off_L0::system_id); }
+    uint16_t offset_new_packet() const noexcept { return ld<uint16_t>(detail::off_L0::offset_new_packet); }
+    uint16_t memory_size()       const noexcept { return ld<uint16_t>(detail::off_L0::memory_size); }
+    uint8_t  link_id()           const noexcept { return ld<uint8_t>(detail::off_L0::link_id); }
+    uint8_t  packet_counter()    const noexcept { return ld<uint8_t>(detail::off_L0::packet_counter); }
+    uint16_t cru_id()            const noexcept { return ld<uint16_t>(detail::off_L0::cru_id) & 0x0FFF; }
+    uint8_t  dw()                const noexcept { return (ld<uint8_t>(detail::off_L0::dw) >> 4) & 0x0F; }
+    uint16_t bc()                const noexcept { return ld<uint16_t>(detail::off_L0::bc) & 0x0FFF; }
+    uint32_t orbit()             const noexcept { return ld<uint32_t>(detail::off_L0::orbit); }
+    uint8_t  data_format()       const noexcept { return ld<uint8_t>(detail::off_L0::data_format); }
+
+    std::span<const std::byte> bytes() const noexcept { return {p_, ByteCursor::kLineSize}; }
+    RDH_L0 decode() const { return parse_rdh_l0(bytes()); }
+
+private:
+    template <class T> T ld(std::size_t off) const noexcept { return detail::ld<T>(p_ + off); }
+    const std::byte* p_;
+};
+
+class RdhL1View {
+public:
+    explicit RdhL1View(std::span<const std::byte> line) noexcept : p_(line.data()) {}
+    uint32_t trg_type()          const noexcept { return ld<uint32_t>(detail::off_L1::trg_type); }
+    uint16_t hb_packet_counter() const noexcept { return ld<uint16_t>(detail::off_L1::hb_packet_counter); }
+    uint8_t  stop_bit()          const noexcept { return ld<uint8_t>(detail::off_L1::stop_bit); }
+    uint32_t detector_field()    const noexcept { return ld<uint32_t>(detail::off_L1::detector_field); }
+    uint16_t par_bit()           const noexcept { return ld<uint16_t>(detail::off_L1::par_bit); }
+
+    std::span<const std::byte> bytes() const noexcept { return {p_, ByteCursor::kLineSize}; }
+    RDH_L1 decode() const { return parse_rdh_l1(bytes()); }
+
+private:
+    template <class T> T ld(std::size_t off) const noexcept { return detail::ld<T>(p_ + off); }
+    const std::byte* p_;
+};
+
+class DataLineView {
+public:
+    explicit DataLineView(std::span<const std::byte> line) noexcept : p_(line.data()) {}
+    uint8_t  header_type()    const noexcept { return ld<uint8_t>(detail::off_data::header_type); }
+    uint8_t  header_vldb_id() const noexcept { return ld<uint8_t>(detail::off_data::header_vldb_id); }
+    uint16_t bx_cnt()         const noexcept { return ld<uint16_t>(detail::off_data::bx_cnt) & 0x0FFF; }
+    uint32_t ob_cnt()         const noexcept { return ld<uint32_t>(detail::off_data::ob_cnt); }
+    // i = 0..5
+    uint32_t data_word(std::size_t i) const noexcept { return ld<uint32_t>(detail::off_data::data_word0 + 4 * i); }
+
+    std::span<const std::byte> bytes() const noexcept { return {p_, ByteCursor::kLineSize}; }
+    DataLine decode() const { return parse_data_line(bytes()); }
+
+private:
+    template <class T> T ld(std::size_t off) const noexcept { return detail::ld<T>(p_ + off); }
+    const std::byte* p_;
+};
+
+class TrgLineView {
+public:
+    explicit TrgLineView(std::span<const std::byte> line) noexcept : p_(line.data()) {}
+    uint32_t header_type() const noexcept { return ld<uint32_t>(detail::off_trg::header_type); }
+    uint64_t bx_cnt()      const noexcept { return ld<uint64_t>(detail::off_trg::bx_cnt); }
+    uint64_t ob_cnt()      const noexcept { return ld<uint64_t>(detail::off_trg::ob_cnt); }
+    uint32_t reserved0()   const noexcept { return ld<uint32_t>(detail::off_trg::reserved0); }
+    uint64_t reserved1()   const noexcept { return ld<uint64_t>(detail::off_trg::reserved1); }
+
+    std::span<const std::byte> bytes() const noexcept { return {p_, ByteCursor::kLineSize}; }
+    TrgLine decode() const { return parse_trg_line(bytes()); }
+
+private:
+    template <class T> T ld(std::size_t off) const noexcept { return detail::ld<T>(p_ + off); }
+    const std::byte* p_;
+};
+
+} // namespace bp
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace bp {
+
+// 只读整文件映射（RAII）。POSIX 下为 mmap；其它平台退化为一次性读入内存。
+class MappedFile {
+public:
+    enum class Advice { Normal, Sequential, Random, WillNeed };
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::span<const std::byte> bytes() const noexcept { return {data_, size_}; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    // madvise 提示；不支持的平台上为空操作
+    void advise(Advice a, std::size_t off = 0, std::size_t len = 0) const noexcept;
+
+private:
+    void reset() noexcept;
+
+    const std::byte*       data_ = nullptr;
+    std::size_t            size_ = 0;
+    bool                   mapped_ = false;
+    std::vector<std::byte> fallback_;
+};
+
+} // namespace bp
@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "binparse/bounded_queue.hpp"
+#include "binparse/demux.hpp"
+#include "binparse/tail.hpp"
+
+namespace bp {
+
+struct MergeOptions {
+    bool        follow        = false;     // true：按 tail 跟随增长中的文件（见 tail），否则读到 EOF 为止
+    TailOptions tail;                      // follow 时的读取参数；inactivity_timeout_ms 决定源何时算结束
+    std::size_t read_chunk    = 4u << 20;  // 非 follow 时每次交给分帧的字节数
+    std::size_t batch_bytes   = 256u << 10; // 每个源攒够这么多字节的包再投递给合并线程
+    std::size_t queue_batches = 4;         // 每个源最多积压的批数，满了该源的解码线程阻塞（背压）
+    std::size_t reorder_bytes = 16u << 20; // 每个源为等齐各 link 最多暂存的字节数，超过后不再等没有数据的 link
+};
+
+// 合并输出的一个包：从 RDH_L0 起到 offset_new_packet 为止（含填充）的原始字节，
+// 依次 feed 给一个 StreamParser 即得到合并后的流。
+// 包边界上不是合法 RDH_L0 的连续行作为一个 framed=false 的块交出，link 与时间沿用该源上一个包；
+// 源结束时不完整的末包只交出其中的整行
+struct MergedPacket {
+    std::size_t                source = 0; // 在 paths 中的下标
+    uint32_t                   orbit  = 0; // RDH_L0 orbit
+    uint16_t                   bc     = 0; // RDH_L0 bc
+    uint64_t                   offset = 0; // 在源文件（流）中的字节偏移
+    LinkKey                    link;       // RDH_L0 的 (cru_id, link_id, fee_id)
+    bool                       framed = true;
+    std::span<const std::byte> bytes;
+};
+
+struct MergeSourceStats {
+    uint64_t packets     = 0;
+    uint64_t bytes       = 0;
+    uint64_t stray_lines = 0; // 不在包边界上的行
+    uint64_t regressions = 0; // 比同一源同一 link 上一个包更早的包（link 自身未按时间排序，按流顺序交出）
+    uint64_t truncated_bytes = 0; // 源末尾不足一行、被丢弃的字节
+};
+
+struct MergeStats {
+    uint64_t packets      = 0;
+    uint64_t bytes        = 0;
+    uint64_t out_of_order = 0; // 比前一个交出的包更早（由 link 内回退或超出 reorder_bytes 造成）
+    uint64_t waits        = 0; // 合并线程因某个源还没有数据而阻塞的次数
+    std::vector<MergeSourceStats> sources;
+};
+
+// N 路按时间合并：每个源一个解码线程，把文件切成包（按 RDH_L0 的 offset_new_packet）、取出
+// (orbit, bc) 和 link，攒成批放进该源的有界队列。多 link 的 CRU 文件里各 link 的页交错写入，
+// 源内整体并不按时间排序，但每条 link 自身是有序的；所以 run() 在调用线程上把每个源再拆成
+// 按 link 的子队列，用小顶堆按 (orbit, bc, 源下标, link) 反复取最早的包交给 sink。
+// 每条 link 的包各自按流顺序，link 内按时间非降时输出整体有序。
+//   - 某个源的某条 link 暂时没有数据时，合并线程继续从该源取批直到它有数据、源结束，或该源
+//     暂存的批超过 reorder_bytes（之后该 link 的包可能乱序，计入 out_of_order）
+//   - 内存上界：每个源 queue_batches + 2 批，另加至多约 reorder_bytes + batch_bytes 的暂存
+//   - 合并线程要等每个未结束的源至少有一个包才能确定最早者；follow 时一个停滞的源会拖住整体，
+//     直到它的 inactivity_timeout_ms 到期
+// run() 只能调用一次；sink 或任一源抛出的第一个异常在 run() 中重新抛出。
+class SourceMerger {
+public:
+    using Sink = std::function<void(const MergedPacket&)>;
+
+    explicit SourceMerger(std::vector<std::string> paths, MergeOptions opt = {});
+    ~SourceMerger();
+    SourceMerger(const SourceMerger&) = delete;
+    SourceMerger& operator=(const SourceMerger&) = delete;
+
+    // 阻塞直到所有源结束或 stop()
+    void run(const Sink& sink);
+    // 任意线程：让 run() 尽快返回（未交出的包被丢弃）
+    void stop() noexcept;
+
+    // run() 返回后有效
+    const MergeStats& stats() const noexcept { return stats_; }
+    std::size_t sources() const noexcept { return sources_.size(); }
+
+private:
+    struct Record {
+        uint64_t key;    // orbit << 12 | bc
+        uint64_t offset;
+        uint32_t begin;  // 在 Batch::bytes 中的位置
+        uint32_t len;
+        uint32_t lane;   // 源内 link 的编号（见 Source::lane_ids）
+        LinkKey  link;
+        bool     framed;
+    };
+
+    struct Batch {
+        std::vector<std::byte> bytes;
+        std::vector<Record>    records;
+    };
+
+    struct Source {
+        explicit Source(std::size_t cap) : queue(cap), free(cap + 2) {}
+        std::string        path;
+        BoundedQueue<Batch> queue;
+        BoundedQueue<Batch> free; // 合并线程用完的批回收给解码线程
+        std::thread        worker;
+        MergeSourceStats   stats;
+
+        // 解码线程的分帧状态
+        Batch                  cur;
+        std::vector<std::byte> pend;         // 跨 chunk 的不完整包
+        uint64_t               offset = 0;   // 下一个未分帧字节的流偏移
+        std::unordered_map<LinkKey, uint32_t, LinkKeyHash> lane_ids;
+        std::vector<uint64_t>  lane_key;     // 每条 link 上一个包的时间
+        LinkKey                last_link;    // 上一个单元所在的 link，连续同一 link 时免去查表
+        uint32_t               last_lane = 0;
+    };
+
+    void run_source(std::size_t i);
+    void feed(Source& s, std::span<const std::byte> chunk);
+    std::size_t frame(Source& s, std::span<const std::byte> bytes, bool eof);
+    void append(Source& s, std::span<const std::byte> unit, uint64_t key, const LinkKey& link, bool framed);
+    void dispatch(Source& s);
+    void fail(std::exception_ptr e) noexcept;
+
+    MergeOptions                         opt_;
+    std::vector<std::unique_ptr<Source>> sources_;
+    std::atomic<bool>                    stop_{false};
+    bool                                 ran_ = false;
+    MergeStats                           stats_;
+
+    std::mutex         err_mu_;
+    std::exception_ptr err_;
+};
+
+} // namespace bp
@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "binparse/histogram.hpp"
+#include "binparse/lines.hpp"
+
+namespace bp {
+
+struct MetricsSnapshot {
+    double   uptime_s        = 0; // 距构造或 reset() 的时间
+    uint64_t bytes_read      = 0;
+    uint64_t reads           = 0; // read 系统调用次数（mmap 模式：交出的块数）
+    uint64_t chunks_parsed   = 0;
+    uint64_t data_lines      = 0;
+    uint64_t trg_lines       = 0;
+    uint64_t rdh_l0_lines    = 0;
+    uint64_t rdh_l1_lines    = 0;
+    uint64_t undefined_lines = 0;
+    uint64_t carry_events    = 0; // feed 结束时暂存了半行或不完整包的次数
+    uint64_t carried_bytes   = 0;
+    uint64_t rotations       = 0;
+    uint64_t truncations     = 0;
+    LatencyHistogram read_ns;     // 单次 read 系统调用
+    LatencyHistogram parse_ns;    // 单次 feed()
+    LatencyHistogram callback_ns; // 单次 on_bytes 回调（含解析）
+
+    uint64_t lines() const noexcept {
+        return data_lines + trg_lines + rdh_l0_lines + rdh_l1_lines + undefined_lines;
+    }
+};
+
+// 解码链路的运行计数，全部是无锁原子量。tail_growing_file（TailOptions::metrics）
+// 写入读/回调相关的量，BasicStreamParser（set_metrics）写入行计数、解析耗时与 carry；
+// 同一个对象可以同时交给两者，在任意线程用 snapshot() 读取。
+struct DecoderMetrics {
+    std::atomic<uint64_t> bytes_read{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> chunks_parsed{0};
+    std::atomic<uint64_t> data_lines{0};
+    std::atomic<uint64_t> trg_lines{0};
+    std::atomic<uint64_t> rdh_l0_lines{0};
+    std::atomic<uint64_t> rdh_l1_lines{0};
+    std::atomic<uint64_t> undefined_lines{0};
+    std::atomic<uint64_t> carry_events{0};
+    std::atomic<uint64_t> carried_bytes{0};
+    std::atomic<uint64_t> rotations{0};
+    std::atomic<uint64_t> truncations{0};
+    AtomicLatencyHistogram read_ns;
+    AtomicLatencyHistogram parse_ns;
+    AtomicLatencyHistogram callback_ns;
+
+    DecoderMetrics() noexcept : start_(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+    DecoderMetrics(const DecoderMetrics&) = delete;
+    DecoderMetrics& operator=(const DecoderMetrics&) = delete;
+
+    // 各字段分别原子读取，彼此之间不是同一时刻的一致快照
+    MetricsSnapshot snapshot() const noexcept;
+    void reset() noexcept;
+
+private:
+    std::atomic<std::chrono::steady_clock::rep> start_;
+};
+
+// 单行 JSON（无换行），字段名与 MetricsSnapshot 一致；直方图给出 count/mean/p50/p90/p99/max
+// 与非空桶的 [上界, 计数] 列表
+std::string to_json(const MetricsSnapshot& s);
+
+} // namespace bp
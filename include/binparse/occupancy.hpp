@@ -0,0 +1,156 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "binparse/parser.hpp"
+
+namespace bp {
+
+inline constexpr std::size_t kOccVldbs    = 256;  // header_vldb_id
+inline constexpr std::size_t kOccBx       = 4096; // 12 位 bx_cnt
+inline constexpr std::size_t kOccWords    = 6;    // data_word0..5
+inline constexpr std::size_t kOccWordBits = 32;
+
+struct OccupancyOptions {
+    std::size_t orbit_window  = 1024;   // 每 orbit 计数保留最近多少个 orbit（向上取 2 的幂）
+    std::size_t flush_lines   = 16384;  // Recorder 每解析这么多行把本地计数发布一次
+    std::size_t max_recorders = 64;
+};
+
+// 合并后的直方图；各数组是连续的 uint64 计数，二维的按行主序
+struct OccupancySnapshot {
+    uint64_t seq        = 0; // 第几次定时发布；直接调用 snapshot() 得到的为 0
+    double   uptime_s   = 0;
+    uint64_t data_lines = 0;
+    uint64_t trg_lines  = 0;
+    uint64_t late_orbit_lines = 0; // 所属 orbit 已滑出 orbit_window 的 Data 行（不计入 orbit_data）
+    std::vector<uint64_t> vldb;          // [256]     每个 header_vldb_id 的 Data 行数
+    std::vector<uint64_t> data_bx;       // [4096]    每个 bx 的 Data 行数
+    std::vector<uint64_t> trg_bx;        // [4096]    每个 bx（低 12 位）的 TRG 行数
+    std::vector<uint64_t> orbit;         // 最近的 orbit 号（Data ob_cnt），连续升序，至多 orbit_window 个
+    std::vector<uint64_t> orbit_data;    // 与 orbit 对应的 Data 行数
+    std::vector<uint64_t> word_bits;     // [6][32]   各 data word 每一位为 1 的次数（通道占用）
+    std::vector<uint64_t> word_popcount; // [6][33]   各 data word 置位数的分布
+};
+
+// 在线占用率/直方图聚合。每个解析线程取一个 Recorder（线程局部计数，热路径上无原子操作），
+// 每 flush_lines 行把增量发布到该 Recorder 自己的原子镜像（单写者，relaxed load+store）；
+// snapshot() 在任意线程上无锁地合并所有镜像。start() 起一个线程按 interval 定时合并发布，
+// latest() 取最近一次发布的快照（shared_ptr，可跨线程持有，pybinparse 以此零拷贝地给出 NumPy 视图）。
+class OccupancyMonitor {
+public:
+    class Recorder;
+    using Callback = std::function<void(const OccupancySnapshot&)>;
+
+    explicit OccupancyMonitor(OccupancyOptions opt = {});
+    ~OccupancyMonitor();
+    OccupancyMonitor(const OccupancyMonitor&) = delete;
+    OccupancyMonitor& operator=(const OccupancyMonitor&) = delete;
+
+    // 新建一个 Recorder，生存期与 monitor 相同；一个 Recorder 只能由一个线程使用。
+    // 超过 max_recorders 时抛 std::length_error
+    Recorder& recorder();
+
+    // 立即合并所有 Recorder 已发布的计数
+    OccupancySnapshot snapshot() const;
+
+    // 定时发布：每 interval 合并一次，存为 latest() 并调用 on_publish（在发布线程上）
+    void start(std::chrono::milliseconds interval, Callback on_publish = {});
+    void stop();
+    std::shared_ptr<const OccupancySnapshot> latest() const;
+
+    const OccupancyOptions& options() const noexcept { return opt_; }
+
+private:
+    void run(std::chrono::milliseconds interval);
+
+    OccupancyOptions opt_;
+    std::chrono::steady_clock::time_point t0_ = std::chrono::steady_clock::now();
+
+    std::mutex                             reg_mu_; // 只保护注册
+    std::vector<std::unique_ptr<Recorder>> owned_;
+    std::unique_ptr<std::atomic<Recorder*>[]> recorders_;
+    std::atomic<std::size_t>               n_recorders_{0};
+
+    mutable std::mutex                       latest_mu_;
+    std::shared_ptr<const OccupancySnapshot> latest_;
+    uint64_t                                 seq_ = 0;
+
+    Callback                on_publish_;
+    std::mutex              mu_;
+    std::condition_variable cv_;
+    bool                    stopping_ = false;
+    std::thread             publisher_;
+};
+
+class OccupancyMonitor::Recorder {
+public:
+    explicit Recorder(const OccupancyOptions& opt);
+
+    // 用内部的 BasicStreamParser 解析任意长度的 chunk（半行跨 chunk 暂存）并计数
+    void feed(std::span<const std::byte> chunk);
+    // 把本地计数立即发布给 snapshot()
+    void flush();
+
+    // 逐行计数：已有自己的 BasicStreamParser handler 时从中转调（之后需自行调用 flush()）
+    bool wants(LineType t) const noexcept { return t == LineType::Data || t == LineType::TRG; }
+    void on_data_line(DataLineView d) noexcept;
+    void on_trg_line(TrgLineView t) noexcept;
+
+private:
+    friend class OccupancyMonitor;
+
+    // 计数在扁平数组中的位置
+    static constexpr std::size_t kDataLines = 0;
+    static constexpr std::size_t kTrgLines  = 1;
+    static constexpr std::size_t kLateOrbit = 2;
+    static constexpr std::size_t kVldb      = 3;
+    static constexpr std::size_t kDataBx    = kVldb + kOccVldbs;
+    static constexpr std::size_t kTrgBx     = kDataBx + kOccBx;
+    static constexpr std::size_t kWordBits  = kTrgBx + kOccBx;
+    static constexpr std::size_t kWordPop   = kWordBits + kOccWords * kOccWordBits;
+    static constexpr std::size_t kCounters  = kWordPop + kOccWords * (kOccWordBits + 1);
+    static constexpr uint64_t    kNoOrbit   = ~uint64_t{0};
+    static constexpr std::size_t kWordBatch = 15;
+
+    struct Handler {
+        Recorder* r;
+        bool wants(LineType t) const noexcept { return r->wants(t); }
+        void on_data_line(DataLineView d) noexcept { r->on_data_line(d); }
+        void on_trg_line(TrgLineView t) noexcept { r->on_trg_line(t); }
+    };
+
+    void spill_words() noexcept;
+    void publish_orbit(std::size_t i) noexcept;
+    void merge_into(OccupancySnapshot& s, std::vector<uint64_t>& okeys, std::vector<uint64_t>& ocounts) const;
+
+    std::size_t flush_lines_;
+    std::size_t pending_lines_ = 0;
+
+    // 线程局部部分（只有所属线程读写）
+    std::vector<uint64_t> local_;
+    std::vector<uint64_t> orbit_key_;
+    std::vector<uint64_t> orbit_count_;
+    std::size_t           orbit_mask_;
+    std::array<std::array<uint32_t, kWordBatch>, kOccWords> words_{}; // 待统计的 data word，按 word 分列
+    std::size_t n_words_ = 0;
+
+    // 发布的镜像（单写者，任意线程读）
+    std::unique_ptr<std::atomic<uint64_t>[]> pub_;
+    std::unique_ptr<std::atomic<uint64_t>[]> pub_orbit_key_;
+    std::unique_ptr<std::atomic<uint64_t>[]> pub_orbit_count_;
+
+    BasicStreamParser<Handler> parser_{Handler{this}};
+};
+
+} // namespace bp
@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "binparse/mapped_file.hpp"
+#include "binparse/parser.hpp"
+
+namespace bp {
+
+// 文件中的一段 [offset, offset+size)；起点在 32B 边界上，且（除首段外）落在 RDH_L0 行，
+// 保证包不会跨段。
+struct Shard {
+    uint64_t    offset = 0;
+    std::size_t size   = 0;
+};
+
+// 把 data 切成至多 nshards 段：先按字节均分并对齐到 32B，再向后吸附到下一个 RDH_L0
+// （只向后找 64 KiB，找不到就不在这里切）。吸附后为空的段被丢弃；返回的段按文件顺序、
+// 首尾相接覆盖全部完整行。
+std::vector<Shard> plan_shards(std::span<const std::byte> data, std::size_t nshards);
+
+// 在 work-stealing 线程池上处理 shards：每个线程持有一段 shard 下标队列，
+// 从队头取自己的，空了就从其它线程队尾偷。nthreads==0 表示 hardware_concurrency。
+// 任一任务抛出的第一个异常会在所有线程结束后重新抛出。
+void run_shards_parallel(std::span<const std::byte> data,
+                         const std::vector<Shard>& shards,
+                         unsigned nthreads,
+                         const std::function<void(std::size_t idx, std::span<const std::byte> bytes)>& task);
+
+// 每个线程多切几段，让 work stealing 有东西可偷
+inline constexpr std::size_t kShardsPerThread = 4;
+
+// mmap 整个文件并行解码。handler_factory() 或 handler_factory(shard_idx) 为每段造一个
+// handler，段内用 BasicStreamParser<Handler> 顺序解码；返回的 handler 按文件顺序排列。
+// 工厂在调用线程上、解码开始前按段号顺序逐个调用，不需要线程安全；handler 之后被移到
+// 工作线程里使用，各段的 handler 之间不能共享未加锁的可变状态。
+// 需要单一结果时用下面带 merge 的重载。
+template <class Factory>
+auto decode_file_parallel(const std::string& path, unsigned nthreads, Factory&& handler_factory) {
+    auto make = [&](std::size_t idx) {
+        if constexpr (std::invocable<Factory&, std::size_t>) return handler_factory(idx);
+        else return handler_factory();
+    };
+    using Handler = decltype(make(std::size_t{}));
+
+    MappedFile file(path);
+    file.advise(MappedFile::Advice::Sequential);
+
+    if (nthreads == 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+    const auto shards = plan_shards(file.bytes(), std::size_t{nthreads} * kShardsPerThread);
+
+    std::vector<std::optional<Handler>> slots(shards.size());
+    for (std::size_t i = 0; i < slots.size(); ++i) slots[i].emplace(make(i));
+    run_shards_parallel(file.bytes(), shards, nthreads,
+        [&](std::size_t idx, std::span<const std::byte> bytes) {
+            BasicStreamParser<Handler> parser(std::move(*slots[idx]));
+            parser.feed(bytes);
+            slots[idx].emplace(std::move(parser.handler()));
+        });
+
+    std::vector<Handler> out;
+    out.reserve(slots.size());
+    for (auto& s : slots) out.push_back(std::move(*s));
+    return out;
+}
+
+// 同上（工厂同样只在调用线程上调用），再按文件顺序把各段的 handler 并成一个返回：merge(acc, std::move(next)) 把后一段
+// 并入前面各段的累积结果（第 0 段作初值），所以只依赖顺序的状态（例如“上一个包”）也能
+// 在 merge 里拼接。文件里没有完整行时返回 handler_factory 造的空 handler。
+template <class Factory, class Merge>
+auto decode_file_parallel(const std::string& path, unsigned nthreads, Factory&& handler_factory, Merge&& merge) {
+    auto parts = decode_file_parallel(path, nthreads, handler_factory);
+    using Handler = typename decltype(parts)::value_type;
+    if (parts.empty()) {
+        if constexpr (std::invocable<Factory&, std::size_t>) return Handler(handler_factory(std::size_t{0}));
+        else return Handler(handler_factory());
+    }
+    Handler acc = std::move(parts.front());
+    for (std::size_t i = 1; i < parts.size(); ++i) merge(acc, std::move(parts[i]));
+    return acc;
+}
+
+} // namespace bp
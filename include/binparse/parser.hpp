@@ -1,146 +1,573 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <span>
+#include <utility>
 #include <vector>
-#include <iostream>
-#include <iomanip>
 #include <cstddef>
 
+#include "binparse/bytecursor.hpp"
+#include "binparse/lines.hpp"
+#include "binparse/metrics.hpp"
+
 namespace bp {
 
-enum class LineType : uint16_t {
-    Data      = 0,
-    TRG       = 0xBBBB,
-    RDH_L0    = 0x0007,
-    RDH_L1    = 0x0003,
-    Sync      = 0xAAAA,
-    Heartbeat = 0xEEEE,
-    Undefined = 0xFFFF
+// 批量分类：把 chunk 中每个完整 32B 行的类型写入 out（至少 chunk.size()/32 个元素），
+// 返回行数。运行时按 CPU 选 AVX-512 / AVX2 / 标量实现。
+std::size_t classify_lines(std::span<const std::byte> chunk, LineType* out);
+// 当前选中的分类内核名："avx512" / "avx2" / "scalar"
+const char* classify_isa() noexcept;
+
+// ---------- 列式（SoA）批量解码 ----------
+// 每种行类型一组连续列；offset 为该行在文件（流）中的字节偏移。
+// clear() 只清空长度、保留容量，批与批之间可复用而不重新分配。
+struct DataColumns {
+    std::vector<uint64_t> offset;
+    std::vector<uint8_t>  header_vldb_id;
+    std::vector<uint16_t> bx_cnt;   // 12 bits
+    std::vector<uint32_t> ob_cnt;
+    std::vector<uint32_t> data_word0;
+    std::vector<uint32_t> data_word1;
+    std::vector<uint32_t> data_word2;
+    std::vector<uint32_t> data_word3;
+    std::vector<uint32_t> data_word4;
+    std::vector<uint32_t> data_word5;
+    std::size_t size() const noexcept { return offset.size(); }
+    void resize(std::size_t n, uint32_t fields = ~0u); // 未选中的列清空
+    void clear() { resize(0); }
 };
 
-struct Packet {
-    std::span<const std::byte> block;
+struct TrgColumns {
+    std::vector<uint64_t> offset;
+    std::vector<uint64_t> bx_cnt;
+    std::vector<uint64_t> ob_cnt;
+    std::size_t size() const noexcept { return offset.size(); }
+    void resize(std::size_t n, uint32_t fields = ~0u);
+    void clear() { resize(0); }
 };
 
-struct Heartbeat {
-    std::array<std::span<const std::byte>, 2> lines;
+struct RdhL0Columns {
+    std::vector<uint64_t> offset;
+    std::vector<uint16_t> fee_id;
+    std::vector<uint16_t> offset_new_packet;
+    std::vector<uint16_t> memory_size;
+    std::vector<uint8_t>  link_id;
+    std::vector<uint8_t>  packet_counter;
+    std::vector<uint16_t> cru_id;   // 12 bits
+    std::vector<uint16_t> bc;       // 12 bits
+    std::vector<uint32_t> orbit;
+    std::size_t size() const noexcept { return offset.size(); }
+    void resize(std::size_t n, uint32_t fields = ~0u);
+    void clear() { resize(0); }
 };
 
-struct DataLine {
-    uint8_t     header_type; // 0xAC
-    uint8_t     header_vldb_id;
-    uint16_t    bx_cnt; // 12 bits
-    uint32_t    ob_cnt;
-    uint32_t    data_word0;
-    uint32_t    data_word1;
-    uint32_t    data_word2;
-    uint32_t    data_word3;
-    uint32_t    data_word4;
-    uint32_t    data_word5;
-    void display() const {
-        std::ios old(nullptr);
-        old.copyfmt(std::cout);
-        std::cout << std::hex << std::setfill('0')
-                  << "\n[DATA] hdr=" << std::setw(2) << (int)header_type
-                  << " vldb_id=" << std::setw(2) << (int)header_vldb_id
-                  << " bx=" << std::setw(4) << bx_cnt
-                  << " ob=" << std::setw(8) << ob_cnt
-                  << " dw0=" << std::setw(8) << data_word0
-                  << " dw1=" << std::setw(8) << data_word1
-                  << " dw2=" << std::setw(8) << data_word2
-                  << " dw3=" << std::setw(8) << data_word3
-                  << " dw4=" << std::setw(8) << data_word4
-                  << " dw5=" << std::setw(8) << data_word5;
-        std::cout.copyfmt(old);
-    }
+struct RdhL1Columns {
+    std::vector<uint64_t> offset;
+    std::vector<uint32_t> trg_type;
+    std::vector<uint16_t> hb_packet_counter;
+    std::vector<uint8_t>  stop_bit;
+    std::vector<uint32_t> detector_field;
+    std::size_t size() const noexcept { return offset.size(); }
+    void resize(std::size_t n, uint32_t fields = ~0u);
+    void clear() { resize(0); }
 };
 
-struct TrgLine {
-    uint32_t    header_type; // 0xBBBB
-    uint64_t    bx_cnt;
-    uint64_t    ob_cnt;
-    uint32_t    reserved0;
-    uint64_t    reserved1;
-    void display() const {
-        std::ios old(nullptr);
-        old.copyfmt(std::cout);
-        std::cout << std::hex << std::setfill('0')
-                  << "\n[TRG ] hdr=" << std::setw(4) << header_type
-                  << " bx=" << std::setw(16) << bx_cnt
-                  << " ob=" << std::setw(16) << ob_cnt;
-        std::cout.copyfmt(old);
-    }
+// 列投影：每种行类型一个位掩码，只填被选中的列，其余列保持为空。
+// offset 列、LineBatch::type 和 undefined_offset 总会填写。
+namespace field {
+namespace data {
+    constexpr uint32_t header_vldb_id = 1u << 0;
+    constexpr uint32_t bx_cnt         = 1u << 1;
+    constexpr uint32_t ob_cnt         = 1u << 2;
+    constexpr uint32_t data_word0     = 1u << 3; // data_word1..5 依次为 1u<<4 .. 1u<<8
+    constexpr uint32_t data_words     = 0x3Fu << 3;
+}
+namespace trg {
+    constexpr uint32_t bx_cnt = 1u << 0;
+    constexpr uint32_t ob_cnt = 1u << 1;
+}
+namespace rdh_l0 {
+    constexpr uint32_t fee_id            = 1u << 0;
+    constexpr uint32_t offset_new_packet = 1u << 1;
+    constexpr uint32_t memory_size       = 1u << 2;
+    constexpr uint32_t link_id           = 1u << 3;
+    constexpr uint32_t packet_counter    = 1u << 4;
+    constexpr uint32_t cru_id            = 1u << 5;
+    constexpr uint32_t bc                = 1u << 6;
+    constexpr uint32_t orbit             = 1u << 7;
+}
+namespace rdh_l1 {
+    constexpr uint32_t trg_type          = 1u << 0;
+    constexpr uint32_t hb_packet_counter = 1u << 1;
+    constexpr uint32_t stop_bit          = 1u << 2;
+    constexpr uint32_t detector_field    = 1u << 3;
+}
+} // namespace field
+
+struct FieldMask {
+    uint32_t data   = ~0u;
+    uint32_t trg    = ~0u;
+    uint32_t rdh_l0 = ~0u;
+    uint32_t rdh_l1 = ~0u;
+
+    static constexpr FieldMask all() noexcept { return {}; }
+    static constexpr FieldMask none() noexcept { return {0, 0, 0, 0}; }
+    bool operator==(const FieldMask&) const = default;
 };
 
-struct RDH_L0{
-    uint8_t     header_version;
-    uint8_t     header_size;
-    uint16_t    fee_id;
-    uint8_t     priority_bit;
-    uint8_t     system_id;
-    uint16_t    reserved0;
-    uint16_t    offset_new_packet;
-    uint16_t    memory_size;
-    uint8_t     link_id;
-    uint8_t     packet_counter;
-    uint16_t    cru_id;     // 12 bits
-    uint8_t     dw;         // 4 bits
-    uint16_t    bc;         // 12 bits
-    uint32_t    reserved1;  // 20 bits
-    uint32_t    orbit;
-    uint8_t     data_format;
-    uint32_t    reserved2;  // 24 bits
-    uint32_t    reserved3;
-    void display() const {
-        std::ios old(nullptr);
-        old.copyfmt(std::cout);
-        std::cout << std::dec << std::setfill(' ')
-                  << "\n[RDH_L0]"
-                  << " version=" << (int)header_version
-                  << " size=" << (int)header_size
-                  << " fee_id=" << fee_id
-                  << " priority=" << (int)priority_bit
-                  << " system_id=" << (int)system_id
-                  << " offset_new_packet=" << offset_new_packet
-                  << " mem_size=" << memory_size
-                  << " link=" << (int)link_id
-                  << " pkt_cnt=" << (int)packet_counter
-                  << " cru_id=" << cru_id
-                  << " dw=" << (int)dw
-                  << " bc=" << bc
-                  << " orbit=" << orbit
-                  << " fmt=" << (int)data_format;
-        std::cout.copyfmt(old);
+struct LineBatch {
+    std::vector<LineType> type;              // 每行的类型，按流顺序
+    uint64_t              base_offset = 0;   // type[0] 对应的字节偏移
+    DataColumns   data;
+    TrgColumns    trg;
+    RdhL0Columns  rdh_l0;
+    RdhL1Columns  rdh_l1;
+    std::vector<uint64_t> undefined_offset;  // 未识别行
+
+    std::size_t lines() const noexcept { return type.size(); }
+    void clear();
+};
+
+// 把 chunk 中的完整行追加解码到 out 的各列；base_offset 是 chunk[0] 在文件中的偏移。
+// 末尾不足 32B 的字节被忽略，返回解码的行数。fields 之外的列不读取也不分配。
+std::size_t decode_batch(std::span<const std::byte> chunk, LineBatch& out, uint64_t base_offset,
+                         const FieldMask& fields = {});
+
+// 持有一个可复用的 LineBatch，并跨调用累计文件偏移
+class BatchDecoder {
+public:
+    explicit BatchDecoder(uint64_t start_offset = 0, FieldMask fields = {})
+        : fields_(fields), next_offset_(start_offset) {}
+
+    // 清空上一批后解码 chunk；返回的引用在下一次调用前有效
+    const LineBatch& decode_batch(std::span<const std::byte> chunk);
+
+    const LineBatch& batch() const noexcept { return batch_; }
+    uint64_t next_offset() const noexcept { return next_offset_; }
+    void set_next_offset(uint64_t off) noexcept { next_offset_ = off; }
+    const FieldMask& fields() const noexcept { return fields_; }
+
+private:
+    LineBatch batch_;
+    FieldMask fields_;
+    uint64_t  next_offset_;
+};
+
+// 跨 chunk 的半行暂存（32B，无堆分配）。BasicStreamParser 的行模式与 BatchStream 共用
+class LineCarry {
+public:
+    static constexpr std::size_t kLine = ByteCursor::kLineSize;
+
+    // 把 chunk 中的完整行交给 lines(span)：先补齐上次的半行（单独交出），
+    // 再交出其余的整行（可能为空），末尾不足一行的字节留到下次
+    template <class F>
+    void feed(std::span<const std::byte> chunk, F&& lines) {
+        if (len_ > 0) {
+            const std::size_t take = std::min(kLine - len_, chunk.size());
+            std::memcpy(buf_.data() + len_, chunk.data(), take);
+            len_ += take;
+            chunk = chunk.subspan(take);
+            if (len_ < kLine) return;
+            len_ = 0;
+            lines(std::span<const std::byte>(buf_));
+        }
+        const std::size_t rem = chunk.size() % kLine;
+        lines(chunk.first(chunk.size() - rem));
+        if (rem) {
+            std::memcpy(buf_.data(), chunk.data() + chunk.size() - rem, rem);
+            len_ = rem;
+        }
     }
+
+    std::size_t size() const noexcept { return len_; }
+    void clear() noexcept { len_ = 0; }
+
+private:
+    std::array<std::byte, kLine> buf_{};
+    std::size_t                  len_ = 0;
 };
-struct RDH_L1{
-    uint32_t    trg_type;
-    uint16_t    hb_packet_counter;
-    uint8_t     stop_bit;
-    uint8_t     reserved0;
-    uint32_t    reserved1;
-    uint32_t    reserved2;
-    uint32_t    detector_field;
-    uint16_t    par_bit;
-    uint16_t    reserved3;
-    uint32_t    reserved4;
-    uint32_t    reserved5;
-    void display() const {
-        std::ios old(nullptr);
-        old.copyfmt(std::cout);
-        std::cout << std::dec
-                  << "\n[RDH_L1]"
-                  << " trg_type=" << trg_type
-                  << " hb_cnt=" << hb_packet_counter
-                  << " stop=" << (int)stop_bit
-                  << " detector_field=" << detector_field
-                  << " par_bit=" << par_bit;
-        std::cout.copyfmt(old);
+
+// ---------- 编译期 handler ----------
+// BasicStreamParser<Handler> 在编译期检测 Handler 实现了哪些回调，
+// 没实现的行类型不生成任何解码代码；回调可被内联。签名与 StreamParser 的回调一致：
+//   on_packet(const Packet&)                                  行模式：未识别行；包模式：一个分帧的整包
+//   on_rdh_l0(const RDH_L0&, std::span<const std::byte>)
+//   on_rdh_l1(const RDH_L1&, std::span<const std::byte>)
+//   on_data_line(const DataLine&, std::span<const std::byte>)
+//   on_trg_line(const TrgLine&, std::span<const std::byte>)
+//   on_heartbeat(const Heartbeat&)                            仅包模式：stop_bit 结束的 HB 帧
+// 可选 bool wants(LineType) const：运行期整段跳过某类型的 run。
+// 行回调也可以改为接受惰性视图（只读用到的字段，不做整行解码）：
+//   on_rdh_l0(RdhL0View) / on_rdh_l1(RdhL1View) / on_data_line(DataLineView) / on_trg_line(TrgLineView)
+// 两种签名都有时优先视图。
+
+// 行模式：逐行分类分派。
+// 包模式：在包边界读 RDH_L0，整包（memory_size 字节）作为一个 Packet 交出，
+// 然后按 offset_new_packet 直接跳到下一个 RDH；RDH_L0/L1 回调照常触发，
+// payload 行只有 handler 处理 Data/TRG 时才逐行解码。边界上不是合法 RDH_L0 的行
+// 按行模式处理，直到重新对上包头。包模式下 on_packet 只表示整包：payload 里和边界上的
+// 未识别行不再逐行交给 on_packet（仍计入 metrics 的 undefined_lines）。
+enum class Framing { Lines, Packets };
+template <class H>
+concept HandlesPacket = requires(H& h, const Packet& p) { h.on_packet(p); };
+template <class H>
+concept HandlesRdhL0 = requires(H& h, const RDH_L0& r, std::span<const std::byte> s) { h.on_rdh_l0(r, s); };
+template <class H>
+concept HandlesRdhL1 = requires(H& h, const RDH_L1& r, std::span<const std::byte> s) { h.on_rdh_l1(r, s); };
+template <class H>
+concept HandlesDataLine = requires(H& h, const DataLine& d, std::span<const std::byte> s) { h.on_data_line(d, s); };
+template <class H>
+concept HandlesTrgLine = requires(H& h, const TrgLine& t, std::span<const std::byte> s) { h.on_trg_line(t, s); };
+template <class H>
+concept HandlesHeartbeat = requires(H& h, const Heartbeat& hb) { h.on_heartbeat(hb); };
+template <class H>
+concept HandlesRdhL0View = requires(H& h, RdhL0View v) { h.on_rdh_l0(v); };
+template <class H>
+concept HandlesRdhL1View = requires(H& h, RdhL1View v) { h.on_rdh_l1(v); };
+template <class H>
+concept HandlesDataLineView = requires(H& h, DataLineView v) { h.on_data_line(v); };
+template <class H>
+concept HandlesTrgLineView = requires(H& h, TrgLineView v) { h.on_trg_line(v); };
+template <class H>
+concept FiltersLineTypes = requires(const H& h, LineType t) { { h.wants(t) } -> std::convertible_to<bool>; };
+
+template <class Handler>
+class BasicStreamParser {
+public:
+    static constexpr std::size_t kClassifyBlock = 256; // 每次 SIMD 分类的行数
+
+    BasicStreamParser() = default;
+    explicit BasicStreamParser(Handler h) : h_(std::move(h)) {}
+
+    Handler&       handler() noexcept       { return h_; }
+    const Handler& handler() const noexcept { return h_; }
+
+    // 接受任意长度的 chunk：末尾不足一行的字节留在内部 32B carry 缓冲里，
+    // 下次 feed 时补齐后原地解析（无堆分配）
+    void feed(std::span<const std::byte> chunk);
+
+    // 暂存的字节数（行模式的半行 carry，或包模式下跨 chunk 的不完整包）
+    std::size_t pending_bytes() const noexcept { return carry_.size() + pkt_.size(); }
+    // 丢弃暂存状态（例如文件轮转/截断后重新对齐）
+    void reset() noexcept { carry_.clear(); pkt_.clear(); pkt_need_ = 0; skip_ = 0; }
+
+    // 切换分帧模式，同时 reset()
+    void set_framing(Framing f) noexcept { framing_ = f; reset(); }
+    Framing framing() const noexcept { return framing_; }
+
+    // 非空时每次 feed 结束后把行计数、解析耗时与 carry 写入 m（nullptr 关闭，默认）。
+    // 行按类型在本地累加，每次 feed 只做几次原子加
+    void set_metrics(DecoderMetrics* m) noexcept { metrics_ = m; counts_ = {}; }
+    DecoderMetrics* metrics() const noexcept { return metrics_; }
+
+private:
+    void feed_chunk(std::span<const std::byte> chunk);
+    void flush_metrics(std::chrono::steady_clock::duration dt);
+    void count_lines(std::span<const std::byte> lines);
+    void feed_lines(std::span<const std::byte> lines);
+    void feed_packets(std::span<const std::byte> chunk);
+    void emit_packet(std::span<const std::byte> block);
+    // 校验包头，合法时返回包长 (memory_size) 并写出到下一包的距离
+    static std::size_t packet_size(std::span<const std::byte> l0, std::size_t& stride);
+
+    static constexpr bool kRdhL0 = HandlesRdhL0<Handler> || HandlesRdhL0View<Handler>;
+    static constexpr bool kRdhL1 = HandlesRdhL1<Handler> || HandlesRdhL1View<Handler>;
+    static constexpr bool kData  = HandlesDataLine<Handler> || HandlesDataLineView<Handler>;
+    static constexpr bool kTrg   = HandlesTrgLine<Handler> || HandlesTrgLineView<Handler>;
+
+    // handler 接受视图时只交出行指针，否则整行解码
+    void deliver_rdh_l0(std::span<const std::byte> line) {
+        if constexpr (HandlesRdhL0View<Handler>) h_.on_rdh_l0(RdhL0View(line));
+        else h_.on_rdh_l0(parse_rdh_l0(line), line);
+    }
+    void deliver_rdh_l1(std::span<const std::byte> line) {
+        if constexpr (HandlesRdhL1View<Handler>) h_.on_rdh_l1(RdhL1View(line));
+        else h_.on_rdh_l1(parse_rdh_l1(line), line);
+    }
+    void deliver_data_line(std::span<const std::byte> line) {
+        if constexpr (HandlesDataLineView<Handler>) h_.on_data_line(DataLineView(line));
+        else h_.on_data_line(parse_data_line(line), line);
+    }
+    void deliver_trg_line(std::span<const std::byte> line) {
+        if constexpr (HandlesTrgLineView<Handler>) h_.on_trg_line(TrgLineView(line));
+        else h_.on_trg_line(parse_trg_line(line), line);
+    }
+
+    bool wants(LineType t) const {
+        if constexpr (FiltersLineTypes<Handler>) return h_.wants(t);
+        else return true;
+    }
+
+    Handler h_;
+    Framing framing_ = Framing::Lines;
+
+    // 行模式：半行 carry
+    LineCarry carry_;
+
+    // 包模式：跨 chunk 的包在 pkt_ 中拼接（容量复用）
+    std::vector<std::byte> pkt_;
+    std::size_t pkt_need_   = 0; // 当前包总长，0 表示包头还没收齐
+    std::size_t pkt_stride_ = 0;
+    std::size_t skip_       = 0; // 到下一个 RDH 之前要跳过的字节
+
+    // 计数：Data / TRG / RDH_L0 / RDH_L1 / 其他
+    static std::size_t count_slot(LineType t) noexcept {
+        switch (t) {
+        case LineType::Data:   return 0;
+        case LineType::TRG:    return 1;
+        case LineType::RDH_L0: return 2;
+        case LineType::RDH_L1: return 3;
+        default:               return 4;
+        }
     }
+    DecoderMetrics*            metrics_ = nullptr;
+    std::array<uint64_t, 5>    counts_{};
 };
 
+template <class Handler>
+void BasicStreamParser<Handler>::feed(std::span<const std::byte> chunk) {
+    if (!metrics_) return feed_chunk(chunk);
+    const auto t0 = std::chrono::steady_clock::now();
+    feed_chunk(chunk);
+    flush_metrics(std::chrono::steady_clock::now() - t0);
+}
+
+template <class Handler>
+void BasicStreamParser<Handler>::flush_metrics(std::chrono::steady_clock::duration dt) {
+    constexpr auto kRelaxed = std::memory_order_relaxed;
+    auto& m = *metrics_;
+    std::atomic<uint64_t>* const slots[] = {&m.data_lines, &m.trg_lines, &m.rdh_l0_lines,
+                                            &m.rdh_l1_lines, &m.undefined_lines};
+    for (std::size_t i = 0; i < counts_.size(); ++i)
+        if (counts_[i]) slots[i]->fetch_add(std::exchange(counts_[i], 0), kRelaxed);
+    m.chunks_parsed.fetch_add(1, kRelaxed);
+    m.parse_ns.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count()));
+    if (const std::size_t pending = pending_bytes()) {
+        m.carry_events.fetch_add(1, kRelaxed);
+        m.carried_bytes.fetch_add(pending, kRelaxed);
+    }
+}
+
+// 只计数不分派：包模式下 handler 不处理 payload 行时仍要统计行类型
+template <class Handler>
+void BasicStreamParser<Handler>::count_lines(std::span<const std::byte> lines) {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+    std::array<LineType, kClassifyBlock> types;
+    for (std::size_t off = 0; off < lines.size(); off += kClassifyBlock * kLine) {
+        const std::size_t m = classify_lines(lines.subspan(off, std::min(kClassifyBlock * kLine, lines.size() - off)),
+                                             types.data());
+        for (std::size_t i = 0; i < m; ++i) ++counts_[count_slot(types[i])];
+    }
+}
+
+template <class Handler>
+void BasicStreamParser<Handler>::feed_chunk(std::span<const std::byte> chunk) {
+    if (framing_ == Framing::Packets) return feed_packets(chunk);
+    carry_.feed(chunk, [this](std::span<const std::byte> lines) { feed_lines(lines); });
+}
+
+template <class Handler>
+void BasicStreamParser<Handler>::feed_lines(std::span<const std::byte> chunk) {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+    const std::size_t n = chunk.size() / kLine;
+    if (n == 0) return;
+
+    // 先整块分类（SIMD），再按同类型的连续 run 分派，
+    // 避免每行一次不可预测的 switch 分支
+    std::array<LineType, kClassifyBlock> types;
+
+    for (std::size_t base = 0; base < n; base += kClassifyBlock) {
+        const std::size_t m = std::min(kClassifyBlock, n - base);
+        auto block = chunk.subspan(base * kLine, m * kLine);
+        classify_lines(block, types.data());
+
+        for (std::size_t i = 0; i < m; ) {
+            const LineType type = types[i];
+            std::size_t j = i + 1;
+            while (j < m && types[j] == type) ++j;
+            if (metrics_) counts_[count_slot(type)] += j - i;
+
+            if (wants(type)) {
+                switch (type) {
+                case LineType::RDH_L0:
+                    if constexpr (kRdhL0)
+                        for (std::size_t k = i; k < j; ++k)
+                            deliver_rdh_l0(block.subspan(k * kLine, kLine));
+                    break;
+                case LineType::RDH_L1:
+                    if constexpr (kRdhL1)
+                        for (std::size_t k = i; k < j; ++k)
+                            deliver_rdh_l1(block.subspan(k * kLine, kLine));
+                    break;
+                case LineType::Data:
+                    if constexpr (kData)
+                        for (std::size_t k = i; k < j; ++k)
+                            deliver_data_line(block.subspan(k * kLine, kLine));
+                    break;
+                case LineType::TRG:
+                    if constexpr (kTrg)
+                        for (std::size_t k = i; k < j; ++k)
+                            deliver_trg_line(block.subspan(k * kLine, kLine));
+                    break;
+                default:
+                    if constexpr (HandlesPacket<Handler>)
+                        if (framing_ == Framing::Lines)
+                            for (std::size_t k = i; k < j; ++k)
+                                h_.on_packet(Packet{block.subspan(k * kLine, kLine)});
+                    break;
+                }
+            }
+            i = j;
+        }
+    }
+}
+
+template <class Handler>
+std::size_t BasicStreamParser<Handler>::packet_size(std::span<const std::byte> l0, std::size_t& stride) {
+    constexpr std::size_t kHeader = 2 * ByteCursor::kLineSize; // RDH_L0 + RDH_L1
+    if (classify_line(l0) != LineType::RDH_L0) return 0;
+    const std::size_t mem  = detail::le16_at(l0, detail::off_L0::memory_size);
+    const std::size_t next = detail::le16_at(l0, detail::off_L0::offset_new_packet);
+    if (mem < kHeader || next < mem) return 0;
+    stride = next;
+    return mem;
+}
+
+template <class Handler>
+void BasicStreamParser<Handler>::emit_packet(std::span<const std::byte> block) {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+    auto l0 = block.first(kLine);
+    auto l1 = block.subspan(kLine, kLine);
+    const bool has_l1 = classify_line(l1) == LineType::RDH_L1;
+
+    if constexpr (kRdhL0)
+        if (wants(LineType::RDH_L0)) deliver_rdh_l0(l0);
+    if (metrics_) {
+        ++counts_[count_slot(LineType::RDH_L0)];
+        ++counts_[count_slot(has_l1 ? LineType::RDH_L1 : classify_line(l1))];
+    }
+
+    uint8_t stop = 0;
+    if (has_l1) {
+        stop = detail::le8_at(l1, detail::off_L1::stop_bit);
+        if constexpr (kRdhL1)
+            if (wants(LineType::RDH_L1)) deliver_rdh_l1(l1);
+    }
+
+    auto payload = block.subspan(2 * kLine);
+    const auto lines = payload.first(payload.size() - payload.size() % kLine);
+    bool fed = false;
+    if constexpr (kData || kTrg)
+        if (wants(LineType::Data) || wants(LineType::TRG)) {
+            feed_lines(lines);
+            fed = true;
+        }
+    if (metrics_ && !fed) count_lines(lines);
+
+    if constexpr (HandlesPacket<Handler>)
+        if (wants(LineType::Undefined)) h_.on_packet(Packet{block, payload});
+
+    // stop_bit 标志 HB 帧的最后一页
+    if constexpr (HandlesHeartbeat<Handler>)
+        if (has_l1 && stop && wants(LineType::Heartbeat)) h_.on_heartbeat(Heartbeat{{l0, l1}});
+}
+
+template <class Handler>
+void BasicStreamParser<Handler>::feed_packets(std::span<const std::byte> chunk) {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+
+    while (!chunk.empty()) {
+        // 上一个包的 memory_size 之后、offset_new_packet 之前的填充
+        if (skip_ > 0) {
+            const std::size_t k = std::min(skip_, chunk.size());
+            chunk = chunk.subspan(k);
+            skip_ -= k;
+            continue;
+        }
+
+        if (pkt_.empty()) {
+            if (chunk.size() < kLine) { pkt_.assign(chunk.begin(), chunk.end()); return; }
+
+            std::size_t stride = 0;
+            const std::size_t size = packet_size(chunk.first(kLine), stride);
+            if (size == 0) {               // 不在包头上：按行处理，继续找下一个 RDH_L0
+                feed_lines(chunk.first(kLine));
+                chunk = chunk.subspan(kLine);
+                continue;
+            }
+            if (chunk.size() >= size) {    // 整包在 chunk 内：零拷贝交出
+                emit_packet(chunk.first(size));
+                chunk = chunk.subspan(size);
+                skip_ = stride - size;
+                continue;
+            }
+            pkt_need_ = size;
+            pkt_stride_ = stride;
+            pkt_.assign(chunk.begin(), chunk.end());
+            return;
+        }
+
+        // 续拼跨 chunk 的包；包头没收齐时先补齐一行
+        const std::size_t want = pkt_need_ ? pkt_need_ : kLine;
+        const std::size_t k = std::min(want - pkt_.size(), chunk.size());
+        pkt_.insert(pkt_.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(k));
+        chunk = chunk.subspan(k);
+        if (pkt_.size() < want) return;
+
+        if (pkt_need_ == 0) {
+            pkt_need_ = packet_size(std::span<const std::byte>(pkt_).first(kLine), pkt_stride_);
+            if (pkt_need_ == 0) {
+                feed_lines(pkt_);
+                pkt_.clear();
+            }
+            continue;
+        }
+
+        emit_packet(pkt_);
+        pkt_.clear();
+        skip_ = pkt_stride_ - pkt_need_;
+        pkt_need_ = 0;
+    }
+}
+
+// ---------- 类型擦除版本 ----------
+namespace detail {
+    // StreamParser 的 handler：转发到 std::function，空回调通过 wants() 按 run 跳过
+    struct CallbackHandler {
+        std::function<void(const Packet&)>                              packet;
+        std::function<void(const Heartbeat&)>                           heartbeat;
+        std::function<void(std::span<const std::byte>)>                 sync;
+        std::function<void(const RDH_L0&, std::span<const std::byte>)>  rdh_l0;
+        std::function<void(const RDH_L1&, std::span<const std::byte>)>  rdh_l1;
+        std::function<void(const DataLine&, std::span<const std::byte>)> data_line;
+        std::function<void(const TrgLine&, std::span<const std::byte>)> trg_line;
+
+        bool wants(LineType t) const noexcept {
+            switch (t) {
+            case LineType::RDH_L0:    return static_cast<bool>(rdh_l0);
+            case LineType::RDH_L1:    return static_cast<bool>(rdh_l1);
+            case LineType::Data:      return static_cast<bool>(data_line);
+            case LineType::TRG:       return static_cast<bool>(trg_line);
+            case LineType::Heartbeat: return static_cast<bool>(heartbeat);
+            default:                  return static_cast<bool>(packet);
+            }
+        }
+        void on_packet(const Packet& p) { packet(p); }
+        void on_heartbeat(const Heartbeat& hb) { heartbeat(hb); }
+        void on_rdh_l0(const RDH_L0& r, std::span<const std::byte> s) { rdh_l0(r, s); }
+        void on_rdh_l1(const RDH_L1& r, std::span<const std::byte> s) { rdh_l1(r, s); }
+        void on_data_line(const DataLine& d, std::span<const std::byte> s) { data_line(d, s); }
+        void on_trg_line(const TrgLine& t, std::span<const std::byte> s) { trg_line(t, s); }
+    };
+}
+
+extern template class BasicStreamParser<detail::CallbackHandler>;
+
 class StreamParser {
 public:
     using PacketCb    = std::function<void(const Packet&)>;
@@ -154,29 +581,23 @@ public:
 
     explicit StreamParser(PacketCb p, HeartbeatCb h, SyncCb s,
                           RDH_L0_Cb l0_cb = {}, RDH_L1_Cb l1_cb = {}, DataCb data_cb = {}, TrgLine trg_cb = {})
-        : on_packet_(std::move(p))
-        , on_heartbeat_(std::move(h))
-        , on_sync_(std::move(s))
-        , on_rdh_l0_(std::move(l0_cb))
-        , on_rdh_l1_(std::move(l1_cb))
-        , on_data_line_(std::move(data_cb))
-        , on_trg_line_(std::move(trg_cb)) {}
+        : impl_(detail::CallbackHandler{std::move(p), std::move(h), std::move(s),
+                                        std::move(l0_cb), std::move(l1_cb),
+                                        std::move(data_cb), std::move(trg_cb)}) {}
+    // 任意长度 chunk；不足一行的尾部字节在内部暂存，见 BasicStreamParser::feed
     void feed(std::span<const std::byte> chunk);
 
+    std::size_t pending_bytes() const noexcept { return impl_.pending_bytes(); }
+    void reset() noexcept { impl_.reset(); }
+
+    void set_framing(Framing f) noexcept { impl_.set_framing(f); }
+    Framing framing() const noexcept { return impl_.framing(); }
+
+    void set_metrics(DecoderMetrics* m) noexcept { impl_.set_metrics(m); }
+    DecoderMetrics* metrics() const noexcept { return impl_.metrics(); }
+
 private:
-    enum class State { Idle, CollectPacket };
-    // State state_ = State::Idle;
-
-    std::vector<std::span<const std::byte>> cur_lines_;
-    std::vector<std::span<const std::byte>> hb_lines_;
-
-    PacketCb    on_packet_;
-    HeartbeatCb on_heartbeat_;
-    SyncCb      on_sync_;
-    RDH_L0_Cb   on_rdh_l0_;
-    RDH_L1_Cb   on_rdh_l1_;
-    DataCb      on_data_line_;
-    TrgLine     on_trg_line_;
+    BasicStreamParser<detail::CallbackHandler> impl_;
 };
 
-} // namespace bp
\ No newline at end of file
+} // namespace bp
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "binparse/spsc_ring.hpp"
+
+namespace bp {
+
+// 流水线计数；可以在另一线程上随时读取
+struct PipelineStats {
+    std::atomic<uint64_t> chunks{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> producer_stalls{0}; // 槽位全被占用，读线程等解析线程
+    std::atomic<uint64_t> consumer_stalls{0}; // 没有已填充的槽位，解析线程等读线程
+    std::atomic<uint32_t> occupancy{0};       // 当前已填充待解析的槽位数
+    std::atomic<uint32_t> max_occupancy{0};
+};
+
+// 读线程 → 解析线程的块流水线：固定 slots 个 slot_bytes 大小的缓冲，
+// 已填充的槽位描述符和空闲槽位号分别走两个无锁 SPSC 环。
+//   生产端：acquire() 拿空槽 → 写入 → commit(n)，结束时 close()
+//   消费端：pop() 拿最早的已填槽 → 处理 → release()，中止时 cancel()
+class ChunkPipeline {
+public:
+    ChunkPipeline(std::size_t slots, std::size_t slot_bytes, PipelineStats* stats = nullptr);
+
+    ChunkPipeline(const ChunkPipeline&) = delete;
+    ChunkPipeline& operator=(const ChunkPipeline&) = delete;
+
+    // ---- 生产端 ----
+    // 阻塞直到有空槽；消费端 cancel() 后返回空 span
+    std::span<std::byte> acquire();
+    // n 可以为 0：空块按序交给消费端作标记，不计入 chunks
+    void commit(std::size_t n);
+    void close();
+
+    // ---- 消费端 ----
+    // 阻塞直到有数据；生产端 close() 且取空后返回 false
+    bool pop(std::span<const std::byte>& out);
+    void release();
+    void cancel();
+
+    [[nodiscard]] bool cancelled() const noexcept { return free_.closed(); }
+    [[nodiscard]] const PipelineStats& stats() const noexcept { return *stats_; }
+    [[nodiscard]] std::size_t slot_bytes() const noexcept { return slot_bytes_; }
+
+private:
+    struct Filled {
+        uint32_t    slot = 0;
+        std::size_t len  = 0;
+    };
+
+    std::size_t                         slot_bytes_;
+    std::vector<std::vector<std::byte>> slots_;
+    SpscRing<Filled>                    filled_;
+    SpscRing<uint32_t>                  free_;
+    uint32_t                            writing_ = 0; // 生产端当前持有的槽
+    uint32_t                            reading_ = 0; // 消费端当前持有的槽
+    PipelineStats                       own_stats_;
+    PipelineStats*                      stats_;
+};
+
+} // namespace bp
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bp {
+
+// 单生产者/单消费者无锁环形队列。容量向上取 2 的幂。
+// try_push/try_pop 不阻塞；wait_* 在没有进展时用 std::atomic::wait 挂起（Linux 上是 futex），
+// 对端每次 push/pop/close 都会递增序号并唤醒，不会丢失唤醒。
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity)
+        : buf_(std::bit_ceil(capacity ? capacity : 1)), mask_(buf_.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // ---- 生产端 ----
+    bool try_push(const T& v) {
+        const std::size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t - head_cache_ > mask_) return false;
+        }
+        buf_[t & mask_] = v;
+        tail_.store(t + 1, std::memory_order_release);
+        bump(prod_seq_);
+        return true;
+    }
+
+    // 队列满时挂起，直到消费端取走元素或 close()；返回 false 表示已关闭
+    bool wait_not_full() {
+        for (;;) {
+            const uint32_t seq = cons_seq_.load(std::memory_order_acquire);
+            if (closed()) return false;
+            if (tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) <= mask_) return true;
+            cons_seq_.wait(seq, std::memory_order_acquire);
+        }
+    }
+
+    // ---- 消费端 ----
+    bool try_pop(T& out) {
+        const std::size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h == tail_cache_) return false;
+        }
+        out = buf_[h & mask_];
+        head_.store(h + 1, std::memory_order_release);
+        bump(cons_seq_);
+        return true;
+    }
+
+    // 队列空时挂起，直到生产端放入元素或 close()；返回 false 表示已关闭且取空
+    bool wait_not_empty() {
+        for (;;) {
+            const uint32_t seq = prod_seq_.load(std::memory_order_acquire);
+            if (head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_acquire)) return true;
+            if (closed()) return false;
+            prod_seq_.wait(seq, std::memory_order_acquire);
+        }
+    }
+
+    // 任一端调用；唤醒两端所有等待者
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        bump(prod_seq_);
+        bump(cons_seq_);
+    }
+    [[nodiscard]] bool closed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] std::size_t size_approx() const noexcept {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    [[nodiscard]] std::size_t capacity() const noexcept { return buf_.size(); }
+
+private:
+    static void bump(std::atomic<uint32_t>& seq) {
+        seq.fetch_add(1, std::memory_order_release);
+        seq.notify_all();
+    }
+
+    std::vector<T>    buf_;
+    const std::size_t mask_;
+
+    alignas(64) std::atomic<std::size_t> head_{0};      // 消费端写
+    std::size_t                          tail_cache_ = 0;
+    alignas(64) std::atomic<std::size_t> tail_{0};      // 生产端写
+    std::size_t                          head_cache_ = 0;
+    alignas(64) std::atomic<uint32_t>    prod_seq_{0};
+    alignas(64) std::atomic<uint32_t>    cons_seq_{0};
+    std::atomic<bool>                    closed_{false};
+};
+
+} // namespace bp
@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace bp {
+
+// 合成 CRU 流的参数。默认值大致是一条典型的读出链：4 条 link、每 orbit 若干触发
+struct SynthOptions {
+    uint64_t    seed               = 1;
+    uint16_t    cru_id             = 1;
+    uint16_t    fee_id_base        = 0x100; // link i 的 fee_id = fee_id_base + i
+    std::size_t links              = 4;
+    uint32_t    first_orbit        = 0;
+    double      triggers_per_orbit = 8;     // 每条 link 每个 orbit 的平均触发数
+    double      data_per_trigger   = 12;    // 每个触发后的平均 Data 行数
+    std::size_t page_lines         = 255;   // 每页最多的 payload 行数（不含两行 RDH）；会被收紧到对齐后页长 <= 0xFFFF
+    std::size_t page_align         = 0;     // >0：offset_new_packet 向上取整到该字节数，空隙填 0；> 0xFFFF 时视为 0
+};
+
+// 确定性的合成流生成器：相同的 options 在任何平台上都生成逐字节相同的流
+// （自带 splitmix64，不依赖标准库分布的实现）。
+//   - 每个 orbit 为每条 link 生成一个 HB 帧：触发按 bx 升序，每个触发一行 TRG 加若干 Data 行，
+//     TRG/Data 的 bx_cnt、ob_cnt 与触发一致
+//   - 帧按 page_lines 切页，各 link 的页轮流交错输出
+//   - RDH_L0：packet_counter 按 link 递增，bc 取页内第一行 payload 的 bx（空页为 0）
+//   - RDH_L1：hb_packet_counter 是帧内页号，帧的最后一页 stop_bit=1
+class SynthStream {
+public:
+    explicit SynthStream(SynthOptions opt = {});
+
+    // 把下一个包追加到 out，返回追加的字节数（offset_new_packet）
+    std::size_t next_packet(std::vector<std::byte>& out);
+    // 追加整包，直到 out 至少增长 bytes 字节
+    void generate(std::vector<std::byte>& out, std::size_t bytes);
+    std::vector<std::byte> generate(std::size_t bytes);
+
+    const SynthOptions& options() const noexcept { return opt_; }
+    uint32_t orbit() const noexcept { return orbit_; }        // 正在输出的 orbit
+    uint64_t packets() const noexcept { return packets_; }
+
+private:
+    using Line = std::array<std::byte, 32>;
+    struct Link {
+        std::vector<Line>     lines; // 当前 orbit 的 payload 行
+        std::vector<uint16_t> bx;    // 每行的 bx
+        std::size_t           next = 0; // 下一页的起始行
+        uint16_t              page = 0; // 帧内页号
+        uint8_t               packet_counter = 0;
+        bool                  done = true;
+    };
+
+    uint64_t    rand() noexcept;
+    std::size_t draw(double mean) noexcept;
+    void        build_orbit();
+
+    SynthOptions      opt_;
+    uint64_t          state_;
+    uint32_t          orbit_;
+    std::vector<Link> links_;
+    std::size_t       cursor_ = 0; // 轮到的 link
+    uint64_t          packets_ = 0;
+};
+
+} // namespace bp
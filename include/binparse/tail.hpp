@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <cstddef>
 #include <functional>
 #include <span>
@@ -6,15 +7,68 @@
 
 namespace bp {
 
+struct PipelineStats;
+struct DecoderMetrics;
+class ChunkPool;
+class ChunkLease;
+
 struct TailOptions {
     std::size_t read_chunk = 1u << 20;
     int         poll_ms    = 50;
 
     int         inactivity_timeout_ms = 0;
+
+    // 无新数据时的等待方式。notify=true 时在 Linux 上用 inotify 事件唤醒
+    // （写入后微秒级到达解析），poll_ms 只作兜底；不支持时退回轮询。
+    // latency_target_us>0 时，轮询模式的每次 sleep 不超过该值。
+    bool        notify            = true;
+    int         latency_target_us = 0;
+
+    // 零拷贝模式（仅 POSIX）：mmap 文件并直接交出映射内的 span，不再 pread 到缓冲区。
+    // 映射按 mmap_window 大小预留到 EOF 之后，文件增长时在窗口内无需重映射。
+    // 每个窗口占一个映射（计入 vm.max_map_count），并让被删掉的旧文件的磁盘块保持占用，
+    // 所以保留是有限的：
+    //   - 同一文件除当前窗口外至多再保留 mmap_retain_windows 个旧窗口，更早的被 munmap；
+    //   - 轮转/截断后，旧文件的窗口在新文件的第一块回调返回后全部 munmap。
+    // 交出的 span 在其窗口被 munmap 前有效（文件被截断的部分除外）；需要更久持有时请拷贝。
+    // mmap_retain_windows = SIZE_MAX 时同一文件的窗口保留到 tail_growing_file 返回。
+    bool        use_mmap    = false;
+    std::size_t mmap_window = 64u << 20;
+    std::size_t mmap_retain_windows = 1;
+
+    // 预读缓冲数（仅 POSIX pread 模式）：>=2 时由后台线程把文件读进 read_ahead 个
+    // 轮转缓冲，on_bytes 在调用线程上处理当前块的同时，下一块已在读取。
+    // 交出的 span 在回调返回后即被复用。读/解析之间是无锁的 ChunkPipeline，
+    // pipeline_stats 非空时写入其占用率与双方等待次数。
+    std::size_t    read_ahead     = 0;
+    PipelineStats* pipeline_stats = nullptr;
+
+    // 外部停止标志：其他线程置位后，tail_growing_file 在当前块交出或当前等待
+    // （最多 poll_ms）结束后返回
+    const std::atomic<bool>* stop = nullptr;
+
+    // 非空时，每次读到当前文件末尾、开始等待新数据之前调用一次，再读到数据之前不重复。
+    // 与 on_bytes 在同一线程上按序调用（预读模式下在已读的块都交出之后），
+    // 可用来交出按块攒了一半的数据，不必从块长去猜是否已追上写入端
+    std::function<void()> on_idle;
+
+    // 非空时写入读取字节数、read 次数与耗时、on_bytes 回调耗时、轮转/截断次数
+    // （见 metrics.hpp；解析相关的量由 BasicStreamParser::set_metrics 写入同一对象）
+    DecoderMetrics* metrics = nullptr;
 };
 
 void tail_growing_file(const std::string& path,
                        TailOptions opt,
                        const std::function<void(std::span<const std::byte>)>& on_bytes);
 
+// 租约模式：每块直接 pread 进 pool 的一块缓冲，以引用计数的 ChunkLease 交出（见 chunk_pool.hpp）。
+// on_chunk 可以保留租约或把它交给其他线程，块在最后一个租约释放后才被复用，无需拷贝；
+// pool 的块都被占用时读取暂停（背压，每 poll_ms 检查一次 stop）。lease.offset() 是流内
+// 累计偏移（轮转/截断后不归零）。每块不超过 min(read_chunk, pool.chunk_bytes())；
+// use_mmap / read_ahead 在此模式下不起作用（非 POSIX 平台上从读缓冲拷入租约）。
+void tail_growing_file(const std::string& path,
+                       TailOptions opt,
+                       ChunkPool& pool,
+                       const std::function<void(ChunkLease)>& on_chunk);
+
 } // namespace bp
\ No newline at end of file
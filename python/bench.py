@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""pybinparse benchmarks on the same synthetic streams as bpx_bench.
+
+Prints one line per case and optionally writes JSON with the same result
+schema as `bpx_bench --json` (bench, mix, chunk, bytes, lines, seconds, gbps,
+ns_per_line), so both files can be compared with the same tooling.
+"""
+import argparse
+import json
+import os
+import platform
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "build", "python"))
+
+try:
+    import pybinparse as m
+except Exception as e:
+    raise SystemExit(f"Failed to import pybinparse: {e}")
+
+LINE_SIZE = 32
+
+# 与 bpx_bench 的 mix 一致
+MIXES = {
+    "default":    dict(),
+    "data_heavy": dict(triggers_per_orbit=4, data_per_trigger=60),
+    "rdh_heavy":  dict(triggers_per_orbit=2, data_per_trigger=2, page_lines=4),
+    "trg_heavy":  dict(triggers_per_orbit=64, data_per_trigger=1),
+    "padded_8k":  dict(page_align=8192),
+}
+
+
+def best_of(reps, fn):
+    best = float("inf")
+    for _ in range(reps):
+        t0 = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - t0)
+    return best
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--size", type=int, default=64, help="stream size in MiB (default: 64)")
+    ap.add_argument("--reps", type=int, default=3)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--filter", default="", help="only run cases whose bench/mix contains this")
+    ap.add_argument("--json", default="", help="write results to this file ('-' for stdout)")
+    args = ap.parse_args()
+
+    results = []
+
+    def record(bench, mix, nbytes, nlines, seconds, chunk=0):
+        r = dict(bench=bench, mix=mix, chunk=chunk, bytes=nbytes, lines=nlines, seconds=seconds,
+                 gbps=nbytes / seconds / 1e9, ns_per_line=seconds * 1e9 / max(nlines, 1))
+        results.append(r)
+        print(f"{bench:<22} {mix:<11} {r['gbps']:8.3f} GB/s  {r['ns_per_line']:9.2f} ns/line", flush=True)
+
+    def wanted(bench, mix):
+        return not args.filter or args.filter in f"{bench}/{mix}"
+
+    for mix, kw in MIXES.items():
+        buf = m.synth_stream(args.size << 20, seed=args.seed, **kw)
+        n = len(buf) // LINE_SIZE
+
+        if wanted("count_types_v3", mix):
+            record("count_types_v3", mix, len(buf), n, best_of(args.reps, lambda: m.count_types_v3(buf)))
+        if wanted("decode_arrays", mix):
+            record("decode_arrays", mix, len(buf), n, best_of(args.reps, lambda: m.decode_arrays(buf)))
+        if wanted("decode_arrays_2fields", mix):
+            f = ["L0.orbit", "L0.bc", "DATA.bx_cnt"]
+            record("decode_arrays_2fields", mix, len(buf), n,
+                   best_of(args.reps, lambda: m.decode_arrays(buf, fields=f)))
+
+        # 逐行 dict 的路径很慢，只取前 k 行
+        k = min(n, 20000)
+        head = buf[: k * LINE_SIZE]
+        if wanted("scan_first_n", mix):
+            record("scan_first_n", mix, len(head), k, best_of(args.reps, lambda: m.scan_first_n(head, k)))
+        if wanted("parse_line", mix):
+            lines = [head[i * LINE_SIZE:(i + 1) * LINE_SIZE] for i in range(k)]
+            record("parse_line", mix, len(head), k,
+                   best_of(args.reps, lambda: [m.parse_line(ln) for ln in lines]))
+
+        if wanted("tail", mix):
+            with tempfile.NamedTemporaryFile(prefix="bpx_bench_", suffix=".bin", delete=False) as tmp:
+                tmp.write(buf)
+                path = tmp.name
+            try:
+                def run_tail():
+                    seen = 0
+                    with m.tail(path, poll_ms=1, inactivity_timeout_ms=2000) as it:
+                        for batch in it:
+                            seen += batch["lines"]
+                            if seen >= n:
+                                break
+                record("tail", mix, len(buf), n, best_of(args.reps, run_tail), chunk=1 << 20)
+            finally:
+                os.unlink(path)
+
+    if args.json:
+        doc = dict(machine=dict(python=platform.python_version(), machine=platform.machine(),
+                                threads=os.cpu_count()),
+                   bytes=args.size << 20, results=results)
+        if args.json == "-":
+            json.dump(doc, sys.stdout, indent=2)
+        else:
+            with open(args.json, "w") as f:
+                json.dump(doc, f, indent=2)
+            print(f"wrote {args.json}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -21,7 +21,7 @@ LINE_SIZE = 32  # 32 bytes per line
 
 def main():
     parser = argparse.ArgumentParser(
-        description="Test pybinparse.count_types_v3 / parse_line on a binary log file."
+        description="Test pybinparse.count_types_v3 / decode_arrays / parse_line on a binary log file."
     )
     parser.add_argument(
         "path",
@@ -65,6 +65,21 @@ def main():
     print(f"Elapsed time    : {elapsed:.6f} s")
     print(f"Throughput      : {mibps:.2f} MiB/s")
 
+    # 整文件列式解码
+    t0 = time.perf_counter()
+    with open(path, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+        cols = m.decode_arrays(mm)
+    t1 = time.perf_counter()
+    elapsed = t1 - t0
+
+    print("\n=== Result (from pybinparse.decode_arrays) ===")
+    for key in ("L0", "L1", "TRG", "DATA", "UNDEFINED"):
+        print(f"{key:<10}: {len(cols[key]['offset'])} lines")
+    if len(cols["L0"]["orbit"]):
+        print(f"orbit range: {cols['L0']['orbit'].min()} .. {cols['L0']['orbit'].max()}")
+    print(f"Elapsed time    : {elapsed:.6f} s")
+    print(f"Throughput      : {mib_read / elapsed if elapsed > 0 else float('inf'):.2f} MiB/s")
+
     # 预览前 N 行的解析内容
     n_preview = max(0, min(args.preview, total_lines))
     if n_preview > 0:
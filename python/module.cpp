@@ -1,14 +1,26 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 
+#include <algorithm>
 #include <bit>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <vector>
 
+#include "binparse/batch_stream.hpp"
 #include "binparse/bytecursor.hpp"
+#include "binparse/columnar.hpp"
+#include "binparse/event.hpp"
+#include "binparse/integrity.hpp"
+#include "binparse/occupancy.hpp"
+#include "binparse/parser.hpp"
+#include "binparse/synth.hpp"
 
 namespace py = pybind11;
 
@@ -169,10 +181,239 @@ static py::dict parse_trg_dict(std::span<const std::byte> line) {
     return d;
 }
 
+// ---------- to-numpy (columnar) ----------
+// vector 整体搬到堆上，由 capsule 在数组释放时回收：不拷贝
+template <class T>
+static py::array_t<T> to_numpy(std::vector<T>&& v) {
+    auto* owner = new std::vector<T>(std::move(v));
+    py::capsule free_when_done(owner, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    return py::array_t<T>(static_cast<py::ssize_t>(owner->size()), owner->data(), free_when_done);
+}
+
+// LineType 的底层类型是 uint16_t，按 uint16 暴露
+static py::array_t<uint16_t> to_numpy(std::vector<bp::LineType>&& v) {
+    auto* owner = new std::vector<bp::LineType>(std::move(v));
+    py::capsule free_when_done(owner, [](void* p) { delete static_cast<std::vector<bp::LineType>*>(p); });
+    return py::array_t<uint16_t>(static_cast<py::ssize_t>(owner->size()),
+                                 reinterpret_cast<const uint16_t*>(owner->data()), free_when_done);
+}
+
+// 每行的文件偏移：decode_batch 按行连续追加，offset[i] = base_offset + i*32
+static std::vector<uint64_t> line_offsets(const bp::LineBatch& b) {
+    std::vector<uint64_t> off(b.lines());
+    for (std::size_t i = 0; i < off.size(); ++i) off[i] = b.base_offset + i * bp::ByteCursor::kLineSize;
+    return off;
+}
+
+// 快照里的一个直方图：capsule 持有 shared_ptr，数组直接引用快照内存
+static py::array_t<uint64_t> snapshot_array(const std::shared_ptr<const bp::OccupancySnapshot>& s,
+                                            const std::vector<uint64_t>& v, std::vector<py::ssize_t> shape) {
+    auto* owner = new std::shared_ptr<const bp::OccupancySnapshot>(s);
+    py::capsule keep(owner, [](void* p) { delete static_cast<std::shared_ptr<const bp::OccupancySnapshot>*>(p); });
+    return py::array_t<uint64_t>(std::move(shape), v.data(), keep);
+}
+
+static py::dict snapshot_to_dict(const std::shared_ptr<const bp::OccupancySnapshot>& s) {
+    const auto n = [](std::size_t k) { return static_cast<py::ssize_t>(k); };
+    py::dict d;
+    d["seq"]              = s->seq;
+    d["uptime_s"]         = s->uptime_s;
+    d["data_lines"]       = s->data_lines;
+    d["trg_lines"]        = s->trg_lines;
+    d["late_orbit_lines"] = s->late_orbit_lines;
+    d["vldb"]          = snapshot_array(s, s->vldb, {n(s->vldb.size())});
+    d["data_bx"]       = snapshot_array(s, s->data_bx, {n(s->data_bx.size())});
+    d["trg_bx"]        = snapshot_array(s, s->trg_bx, {n(s->trg_bx.size())});
+    d["orbit"]         = snapshot_array(s, s->orbit, {n(s->orbit.size())});
+    d["orbit_data"]    = snapshot_array(s, s->orbit_data, {n(s->orbit_data.size())});
+    d["word_bits"]     = snapshot_array(s, s->word_bits, {n(bp::kOccWords), n(bp::kOccWordBits)});
+    d["word_popcount"] = snapshot_array(s, s->word_popcount, {n(bp::kOccWords), n(bp::kOccWordBits + 1)});
+    return d;
+}
+
+// ---------- field projection ----------
+// fields 参数里的名字："L0.orbit"、"DATA.bx_cnt" 等；只写类型名（"L0"）表示该类型的全部字段
+struct FieldName {
+    const char* type;
+    const char* name;
+    uint32_t bp::FieldMask::* mask;
+    uint32_t bit;
+};
+static const FieldName kFieldNames[] = {
+    {"DATA", "header_vldb_id",    &bp::FieldMask::data,   bp::field::data::header_vldb_id},
+    {"DATA", "bx_cnt",            &bp::FieldMask::data,   bp::field::data::bx_cnt},
+    {"DATA", "ob_cnt",            &bp::FieldMask::data,   bp::field::data::ob_cnt},
+    {"DATA", "data_word0",        &bp::FieldMask::data,   bp::field::data::data_word0 << 0},
+    {"DATA", "data_word1",        &bp::FieldMask::data,   bp::field::data::data_word0 << 1},
+    {"DATA", "data_word2",        &bp::FieldMask::data,   bp::field::data::data_word0 << 2},
+    {"DATA", "data_word3",        &bp::FieldMask::data,   bp::field::data::data_word0 << 3},
+    {"DATA", "data_word4",        &bp::FieldMask::data,   bp::field::data::data_word0 << 4},
+    {"DATA", "data_word5",        &bp::FieldMask::data,   bp::field::data::data_word0 << 5},
+    {"TRG",  "bx_cnt",            &bp::FieldMask::trg,    bp::field::trg::bx_cnt},
+    {"TRG",  "ob_cnt",            &bp::FieldMask::trg,    bp::field::trg::ob_cnt},
+    {"L0",   "fee_id",            &bp::FieldMask::rdh_l0, bp::field::rdh_l0::fee_id},
+    {"L0",   "offset_new_packet", &bp::FieldMask::rdh_l0, bp::field::rdh_l0::offset_new_packet},
+    {"L0",   "memory_size",       &bp::FieldMask::rdh_l0, bp::field::rdh_l0::memory_size},
+    {"L0",   "link_id",           &bp::FieldMask::rdh_l0, bp::field::rdh_l0::link_id},
+    {"L0",   "packet_counter",    &bp::FieldMask::rdh_l0, bp::field::rdh_l0::packet_counter},
+    {"L0",   "cru_id",            &bp::FieldMask::rdh_l0, bp::field::rdh_l0::cru_id},
+    {"L0",   "bc",                &bp::FieldMask::rdh_l0, bp::field::rdh_l0::bc},
+    {"L0",   "orbit",             &bp::FieldMask::rdh_l0, bp::field::rdh_l0::orbit},
+    {"L1",   "trg_type",          &bp::FieldMask::rdh_l1, bp::field::rdh_l1::trg_type},
+    {"L1",   "hb_packet_counter", &bp::FieldMask::rdh_l1, bp::field::rdh_l1::hb_packet_counter},
+    {"L1",   "stop_bit",          &bp::FieldMask::rdh_l1, bp::field::rdh_l1::stop_bit},
+    {"L1",   "detector_field",    &bp::FieldMask::rdh_l1, bp::field::rdh_l1::detector_field},
+};
+
+// None → 全部字段
+static bp::FieldMask parse_fields(const std::optional<std::vector<std::string>>& fields) {
+    if (!fields) return bp::FieldMask::all();
+    bp::FieldMask m = bp::FieldMask::none();
+    for (const auto& f : *fields) {
+        const auto dot = f.find('.');
+        const std::string type = f.substr(0, dot);
+        const std::string name = (dot == std::string::npos) ? "" : f.substr(dot + 1);
+        bool found = false;
+        for (const auto& fn : kFieldNames) {
+            if (type != fn.type || (!name.empty() && name != fn.name)) continue;
+            m.*fn.mask |= fn.bit;
+            found = true;
+        }
+        if (!found) throw py::value_error("unknown field: " + f);
+    }
+    return m;
+}
+
+// 列文件里的一列：只有一块时直接引用映射（capsule 持有 reader），多块时拼接成一个数组
+template <class T>
+static py::array_t<T> column_to_numpy(const std::shared_ptr<const bp::ColumnFileReader>& reader,
+                                      const std::vector<std::span<const T>>& parts) {
+    if (parts.size() == 1) {
+        auto* owner = new std::shared_ptr<const bp::ColumnFileReader>(reader);
+        py::capsule keep(owner, [](void* p) { delete static_cast<std::shared_ptr<const bp::ColumnFileReader>*>(p); });
+        return py::array_t<T>(static_cast<py::ssize_t>(parts[0].size()), parts[0].data(), keep);
+    }
+    std::vector<T> v;
+    {
+        py::gil_scoped_release nogil;
+        std::size_t n = 0;
+        for (const auto& s : parts) n += s.size();
+        v.reserve(n);
+        for (const auto& s : parts) v.insert(v.end(), s.begin(), s.end());
+    }
+    return to_numpy(std::move(v));
+}
+
+// fields 是否选中列文件中的 table.name；offset 列总是选中
+static bool field_selected(std::string_view table, std::string_view name, const bp::FieldMask& m) {
+    if (name == "offset") return true;
+    for (const auto& fn : kFieldNames)
+        if (table == fn.type && name == fn.name) return (m.*fn.mask & fn.bit) != 0;
+    return false;
+}
+
+template <class T>
+static void put(py::dict& d, const char* name, std::vector<T>& col, uint32_t fields, uint32_t bit) {
+    if (fields & bit) d[name] = to_numpy(std::move(col));
+}
+
+// LineBatch → {"type", "offset", "DATA": {...}, "TRG": {...}, "L0": {...}, "L1": {...}, "UNDEFINED": {...}}
+// 各类型的 offset 总在；其余只包含 fields 选中的字段。列被移出，调用后 b 为空
+static py::dict batch_to_dict(bp::LineBatch&& b, std::vector<uint64_t>&& offsets, const bp::FieldMask& fields) {
+    namespace f = bp::field;
+    py::dict out;
+    out["lines"]  = py::int_(b.lines());
+    out["type"]   = to_numpy(std::move(b.type));
+    out["offset"] = to_numpy(std::move(offsets));
+
+    py::dict data;
+    data["offset"] = to_numpy(std::move(b.data.offset));
+    put(data, "header_vldb_id", b.data.header_vldb_id, fields.data, f::data::header_vldb_id);
+    put(data, "bx_cnt",         b.data.bx_cnt,         fields.data, f::data::bx_cnt);
+    put(data, "ob_cnt",         b.data.ob_cnt,         fields.data, f::data::ob_cnt);
+    put(data, "data_word0",     b.data.data_word0,     fields.data, f::data::data_word0 << 0);
+    put(data, "data_word1",     b.data.data_word1,     fields.data, f::data::data_word0 << 1);
+    put(data, "data_word2",     b.data.data_word2,     fields.data, f::data::data_word0 << 2);
+    put(data, "data_word3",     b.data.data_word3,     fields.data, f::data::data_word0 << 3);
+    put(data, "data_word4",     b.data.data_word4,     fields.data, f::data::data_word0 << 4);
+    put(data, "data_word5",     b.data.data_word5,     fields.data, f::data::data_word0 << 5);
+    out["DATA"] = data;
+
+    py::dict trg;
+    trg["offset"] = to_numpy(std::move(b.trg.offset));
+    put(trg, "bx_cnt", b.trg.bx_cnt, fields.trg, f::trg::bx_cnt);
+    put(trg, "ob_cnt", b.trg.ob_cnt, fields.trg, f::trg::ob_cnt);
+    out["TRG"] = trg;
+
+    py::dict l0;
+    l0["offset"] = to_numpy(std::move(b.rdh_l0.offset));
+    put(l0, "fee_id",            b.rdh_l0.fee_id,            fields.rdh_l0, f::rdh_l0::fee_id);
+    put(l0, "offset_new_packet", b.rdh_l0.offset_new_packet, fields.rdh_l0, f::rdh_l0::offset_new_packet);
+    put(l0, "memory_size",       b.rdh_l0.memory_size,       fields.rdh_l0, f::rdh_l0::memory_size);
+    put(l0, "link_id",           b.rdh_l0.link_id,           fields.rdh_l0, f::rdh_l0::link_id);
+    put(l0, "packet_counter",    b.rdh_l0.packet_counter,    fields.rdh_l0, f::rdh_l0::packet_counter);
+    put(l0, "cru_id",            b.rdh_l0.cru_id,            fields.rdh_l0, f::rdh_l0::cru_id);
+    put(l0, "bc",                b.rdh_l0.bc,                fields.rdh_l0, f::rdh_l0::bc);
+    put(l0, "orbit",             b.rdh_l0.orbit,             fields.rdh_l0, f::rdh_l0::orbit);
+    out["L0"] = l0;
+
+    py::dict l1;
+    l1["offset"] = to_numpy(std::move(b.rdh_l1.offset));
+    put(l1, "trg_type",          b.rdh_l1.trg_type,          fields.rdh_l1, f::rdh_l1::trg_type);
+    put(l1, "hb_packet_counter", b.rdh_l1.hb_packet_counter, fields.rdh_l1, f::rdh_l1::hb_packet_counter);
+    put(l1, "stop_bit",          b.rdh_l1.stop_bit,          fields.rdh_l1, f::rdh_l1::stop_bit);
+    put(l1, "detector_field",    b.rdh_l1.detector_field,    fields.rdh_l1, f::rdh_l1::detector_field);
+    out["L1"] = l1;
+
+    py::dict undef;
+    undef["offset"] = to_numpy(std::move(b.undefined_offset));
+    out["UNDEFINED"] = undef;
+    return out;
+}
+
+// ---------- streaming tail ----------
+// BatchStream 在后台线程 tail + 解码；这里只在等待时释放 GIL，并把批转成 dict
+class TailIterator {
+public:
+    TailIterator(std::string path, bp::TailOptions opt, std::size_t batch_lines, std::size_t queue_batches,
+                 bp::FieldMask fields)
+        : fields_(fields)
+        , stream_(std::make_unique<bp::BatchStream>(std::move(path), opt, batch_lines, queue_batches, fields)) {}
+
+    // 流结束时返回 false
+    bool next(py::dict& out) {
+        bp::LineBatch batch;
+        std::vector<uint64_t> offsets;
+        {
+            py::gil_scoped_release nogil;
+            if (!stream_->next(batch)) return false;
+            offsets = line_offsets(batch);
+        }
+        out = batch_to_dict(std::move(batch), std::move(offsets), fields_);
+        return true;
+    }
+
+    void close() {
+        py::gil_scoped_release nogil;
+        stream_->stop();
+    }
+
+private:
+    bp::FieldMask                    fields_;
+    std::unique_ptr<bp::BatchStream> stream_;
+};
+
 // ---------- module ----------
 PYBIND11_MODULE(pybinparse, m) {
     m.doc() = "Python bindings matching the latest line classification & offsets";
 
+    // type 数组里的取值
+    m.attr("TYPE_DATA")      = static_cast<int>(bp::LineType::Data);
+    m.attr("TYPE_TRG")       = static_cast<int>(bp::LineType::TRG);
+    m.attr("TYPE_L0")        = static_cast<int>(bp::LineType::RDH_L0);
+    m.attr("TYPE_L1")        = static_cast<int>(bp::LineType::RDH_L1);
+    m.attr("TYPE_UNDEFINED") = static_cast<int>(bp::LineType::Undefined);
+
     // v3: count all types
     m.def("count_types_v3", [](py::buffer b){
         py::buffer_info bi = b.request();
@@ -242,4 +483,269 @@ PYBIND11_MODULE(pybinparse, m) {
         }
         return out;
     });
-}
\ No newline at end of file
+
+    // 整个 buffer 解码成列：每种行类型每个字段一个 NumPy 数组，另有逐行的 type/offset。
+    // 解码在 C++ 里释放 GIL 完成，数组直接接管 vector 内存。
+    m.def("decode_arrays", [](py::buffer b, uint64_t base_offset,
+                              const std::optional<std::vector<std::string>>& fields) {
+        const bp::FieldMask mask = parse_fields(fields);
+        py::buffer_info bi = b.request();
+        std::span<const std::byte> sp(static_cast<const std::byte*>(bi.ptr),
+                                      static_cast<std::size_t>(bi.size * bi.itemsize));
+        bp::LineBatch batch;
+        std::vector<uint64_t> offsets;
+        {
+            py::gil_scoped_release nogil;
+            bp::decode_batch(sp, batch, base_offset, mask);
+            batch.base_offset = base_offset;
+            offsets = line_offsets(batch);
+        }
+        return batch_to_dict(std::move(batch), std::move(offsets), mask);
+    }, py::arg("buffer"), py::arg("base_offset") = 0, py::arg("fields") = py::none(),
+       "Decode all complete 32-byte lines into per-type NumPy column arrays; "
+       "fields (e.g. [\"L0.orbit\", \"DATA.bx_cnt\"]) limits decoding to those columns");
+
+    // 按 link 检查 RDH 计数器、orbit/bc 单调与 TRG/Data 一致性；异常按列返回，
+    // kind 是 ANOMALY_KINDS 中的下标
+    m.def("check_integrity", [](py::buffer b, uint64_t base_offset) {
+        py::buffer_info bi = b.request();
+        std::span<const std::byte> sp(static_cast<const std::byte*>(bi.ptr),
+                                      static_cast<std::size_t>(bi.size * bi.itemsize));
+        std::vector<bp::Anomaly> found;
+        {
+            py::gil_scoped_release nogil;
+            bp::LineBatch batch;
+            bp::decode_batch(sp, batch, base_offset, bp::IntegrityChecker::required_fields());
+            bp::IntegrityChecker().check(batch, found);
+        }
+        const std::size_t n = found.size();
+        std::vector<uint64_t> offset(n);
+        std::vector<uint8_t>  kind(n), link_id(n);
+        std::vector<uint32_t> expected(n), got(n), count(n);
+        std::vector<uint16_t> cru_id(n), fee_id(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto& a = found[i];
+            offset[i] = a.offset;
+            kind[i] = static_cast<uint8_t>(a.kind);
+            expected[i] = a.expected;
+            got[i] = a.got;
+            count[i] = a.count;
+            cru_id[i] = a.link.cru_id;
+            link_id[i] = a.link.link_id;
+            fee_id[i] = a.link.fee_id;
+        }
+        py::dict d;
+        d["offset"]   = to_numpy(std::move(offset));
+        d["kind"]     = to_numpy(std::move(kind));
+        d["expected"] = to_numpy(std::move(expected));
+        d["got"]      = to_numpy(std::move(got));
+        d["count"]    = to_numpy(std::move(count));
+        d["cru_id"]   = to_numpy(std::move(cru_id));
+        d["link_id"]  = to_numpy(std::move(link_id));
+        d["fee_id"]   = to_numpy(std::move(fee_id));
+        return d;
+    }, py::arg("buffer"), py::arg("base_offset") = 0,
+       "Check per-link RDH counter continuity, orbit/bc monotonicity and TRG/data bx/ob agreement; "
+       "returns anomaly columns (kind indexes pybinparse.ANOMALY_KINDS)");
+    {
+        py::list kinds;
+        for (std::size_t k = 0; k < bp::kAnomalyKinds; ++k)
+            kinds.append(bp::to_string(static_cast<bp::AnomalyKind>(k)));
+        m.attr("ANOMALY_KINDS") = kinds;
+    }
+
+    // 事件表 + 按事件顺序排列的 hit 表；events["first_hit"]/["hits"] 是 hit 表中的区间
+    m.def("build_events", [](py::buffer b, uint16_t window, uint32_t max_lag, uint64_t base_offset) {
+        py::buffer_info bi = b.request();
+        std::span<const std::byte> sp(static_cast<const std::byte*>(bi.ptr),
+                                      static_cast<std::size_t>(bi.size * bi.itemsize));
+        std::vector<uint32_t> orbit, trg_lines, n_hits;
+        std::vector<uint16_t> bx;
+        std::vector<uint64_t> trg_offset, first_hit, hit_offset;
+        std::vector<uint8_t>  vldb_id;
+        std::vector<int16_t>  dbx;
+        bp::EventBuilderStats st;
+        {
+            py::gil_scoped_release nogil;
+            bp::LineBatch batch;
+            bp::decode_batch(sp, batch, base_offset, bp::EventBuilder::required_fields());
+            bp::EventBuilderOptions opt;
+            opt.window = window;
+            opt.max_lag = max_lag;
+            bp::EventBuilder builder([&](const bp::Event& e) {
+                orbit.push_back(e.orbit);
+                bx.push_back(e.bx);
+                trg_lines.push_back(e.trg_lines);
+                trg_offset.push_back(e.trg_offset);
+                first_hit.push_back(hit_offset.size());
+                n_hits.push_back(static_cast<uint32_t>(e.hits.size()));
+                for (const auto& h : e.hits) {
+                    hit_offset.push_back(h.offset);
+                    vldb_id.push_back(h.vldb_id);
+                    dbx.push_back(h.dbx);
+                }
+            }, opt);
+            builder.add(batch);
+            builder.flush();
+            st = builder.stats();
+        }
+        py::dict ev, hits, stats;
+        ev["orbit"]      = to_numpy(std::move(orbit));
+        ev["bx"]         = to_numpy(std::move(bx));
+        ev["trg_lines"]  = to_numpy(std::move(trg_lines));
+        ev["trg_offset"] = to_numpy(std::move(trg_offset));
+        ev["first_hit"]  = to_numpy(std::move(first_hit));
+        ev["hits"]       = to_numpy(std::move(n_hits));
+        hits["offset"]   = to_numpy(std::move(hit_offset));
+        hits["vldb_id"]  = to_numpy(std::move(vldb_id));
+        hits["dbx"]      = to_numpy(std::move(dbx));
+        stats["matched"]     = st.matched;
+        stats["orphan_data"] = st.orphan_data;
+        stats["late_data"]   = st.late_data;
+        stats["late_trg"]    = st.late_trg;
+        py::dict d;
+        d["events"] = ev;
+        d["hits"]   = hits;
+        d["stats"]  = stats;
+        return d;
+    }, py::arg("buffer"), py::arg("window") = 0, py::arg("max_lag") = 2 * bp::kBxPerOrbit,
+       py::arg("base_offset") = 0,
+       "Group data lines with the TRG at the same (orbit, bx) +- window; returns event and hit columns");
+
+    // 在线占用率直方图：feed() 在调用线程上计数（释放 GIL，可由多个 Python 线程各持一个 Occupancy
+    // 并发调用——每个 feed 线程各取一个 Recorder），snapshot()/latest() 的数组零拷贝引用快照
+    py::class_<bp::OccupancyMonitor>(m, "Occupancy")
+        .def(py::init([](std::size_t orbit_window, std::size_t flush_lines) {
+            bp::OccupancyOptions o;
+            o.orbit_window = orbit_window;
+            o.flush_lines  = flush_lines;
+            return std::make_unique<bp::OccupancyMonitor>(o);
+        }), py::arg("orbit_window") = 1024, py::arg("flush_lines") = 16384)
+        .def("recorder", [](bp::OccupancyMonitor& mon) { return &mon.recorder(); },
+             py::return_value_policy::reference_internal,
+             "New per-thread recorder; feed it from one thread only")
+        .def("snapshot", [](const bp::OccupancyMonitor& mon) {
+            std::shared_ptr<const bp::OccupancySnapshot> s;
+            {
+                py::gil_scoped_release nogil;
+                s = std::make_shared<const bp::OccupancySnapshot>(mon.snapshot());
+            }
+            return snapshot_to_dict(s);
+        }, "Merge all recorders now (lock-free)")
+        .def("start", [](bp::OccupancyMonitor& mon, int interval_ms) {
+            mon.start(std::chrono::milliseconds(std::max(1, interval_ms)));
+        }, py::arg("interval_ms") = 1000, "Publish a merged snapshot every interval_ms on a background thread")
+        .def("stop", &bp::OccupancyMonitor::stop, py::call_guard<py::gil_scoped_release>())
+        .def("latest", [](const bp::OccupancyMonitor& mon) -> py::object {
+            auto s = mon.latest();
+            if (!s) return py::none();
+            return snapshot_to_dict(s);
+        }, "Most recently published snapshot, or None");
+
+    py::class_<bp::OccupancyMonitor::Recorder>(m, "OccupancyRecorder")
+        .def("feed", [](bp::OccupancyMonitor::Recorder& r, py::buffer b) {
+            py::buffer_info bi = b.request();
+            std::span<const std::byte> sp(static_cast<const std::byte*>(bi.ptr),
+                                          static_cast<std::size_t>(bi.size * bi.itemsize));
+            py::gil_scoped_release nogil;
+            r.feed(sp);
+        }, py::arg("buffer"), "Parse a chunk (partial lines carried over) and count it")
+        .def("flush", &bp::OccupancyMonitor::Recorder::flush, "Publish local counts immediately");
+
+    // 读取 bpx_tail --out / ColumnFileWriter 写出的列文件：{"DATA": {...}, "TRG": {...}, ...}，
+    // 不解码原始行；单块的列零拷贝引用 mmap
+    m.def("read_columns", [](const std::string& path, const std::optional<std::vector<std::string>>& fields) {
+        const bp::FieldMask mask = parse_fields(fields);
+        auto reader = std::make_shared<const bp::ColumnFileReader>(path);
+        py::dict out;
+        for (std::size_t ti = 0; ti < bp::kColumnTables; ++ti) {
+            const auto table = static_cast<bp::ColumnTable>(ti);
+            const char* tname = bp::to_string(table);
+            // 列名按第一次出现的顺序
+            std::vector<std::pair<std::string_view, bp::ColumnType>> names;
+            for (const auto& c : reader->chunks()) {
+                if (c.table != table) continue;
+                for (const auto& col : c.columns)
+                    if (field_selected(tname, col.name, mask) &&
+                        std::none_of(names.begin(), names.end(), [&](const auto& n) { return n.first == col.name; }))
+                        names.emplace_back(col.name, col.type);
+            }
+            py::dict t;
+            for (const auto& [name, type] : names) {
+                const std::string key(name);
+                switch (type) {
+                case bp::ColumnType::U8:  t[key.c_str()] = column_to_numpy(reader, reader->column<uint8_t>(table, name)); break;
+                case bp::ColumnType::U16: t[key.c_str()] = column_to_numpy(reader, reader->column<uint16_t>(table, name)); break;
+                case bp::ColumnType::U32: t[key.c_str()] = column_to_numpy(reader, reader->column<uint32_t>(table, name)); break;
+                case bp::ColumnType::U64: t[key.c_str()] = column_to_numpy(reader, reader->column<uint64_t>(table, name)); break;
+                }
+            }
+            out[tname] = t;
+        }
+        return out;
+    }, py::arg("path"), py::arg("fields") = py::none(),
+       "Read a column file written by bpx_tail --out; fields selects columns like decode_arrays");
+
+    // 实时 tail：for batch in tail(path) / async for batch in tail(path)。
+    // 每个 batch 与 decode_arrays 的返回结构相同，offset 是流内累计偏移。
+    py::class_<TailIterator>(m, "TailIterator")
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__", [](TailIterator& t) {
+            py::dict d;
+            if (!t.next(d)) throw py::stop_iteration();
+            return d;
+        })
+        .def("__aiter__", [](py::object self) { return self; })
+        // 阻塞的 next 交给默认 executor，事件循环不被卡住
+        .def("__anext__", [](py::object self) {
+            py::object loop = py::module_::import("asyncio").attr("get_running_loop")();
+            return loop.attr("run_in_executor")(py::none(), self.attr("_next_or_stop_async"));
+        })
+        .def("_next_or_stop_async", [](TailIterator& t) {
+            py::dict d;
+            if (!t.next(d)) {
+                PyErr_SetNone(PyExc_StopAsyncIteration);
+                throw py::error_already_set();
+            }
+            return d;
+        })
+        .def("close", &TailIterator::close)
+        .def("__enter__", [](py::object self) { return self; })
+        .def("__exit__", [](TailIterator& t, py::args) { t.close(); });
+
+    m.def("tail", [](std::string path, std::size_t batch_lines, int poll_ms, int inactivity_timeout_ms,
+                     std::size_t read_chunk, std::size_t queue_batches, bool notify,
+                     const std::optional<std::vector<std::string>>& fields) {
+        bp::TailOptions opt;
+        opt.poll_ms               = poll_ms;
+        opt.inactivity_timeout_ms = inactivity_timeout_ms;
+        opt.read_chunk            = read_chunk;
+        opt.notify                = notify;
+        return std::make_unique<TailIterator>(std::move(path), opt, batch_lines, queue_batches,
+                                              parse_fields(fields));
+    }, py::arg("path"), py::arg("batch_lines") = 65536, py::arg("poll_ms") = 50,
+       py::arg("inactivity_timeout_ms") = 0, py::arg("read_chunk") = std::size_t{1} << 20,
+       py::arg("queue_batches") = 4, py::arg("notify") = true, py::arg("fields") = py::none(),
+       "Follow a growing file in a background thread, yielding batches of NumPy column arrays");
+
+    // 与 bpx_bench 相同的确定性合成流，供 Python 端基准与测试使用
+    m.def("synth_stream", [](std::size_t bytes, uint64_t seed, std::size_t links, double triggers_per_orbit,
+                             double data_per_trigger, std::size_t page_lines, std::size_t page_align) {
+        bp::SynthOptions o;
+        o.seed               = seed;
+        o.links              = links;
+        o.triggers_per_orbit = triggers_per_orbit;
+        o.data_per_trigger   = data_per_trigger;
+        o.page_lines         = page_lines;
+        o.page_align         = page_align;
+        std::vector<std::byte> buf;
+        {
+            py::gil_scoped_release nogil;
+            bp::SynthStream(o).generate(buf, bytes);
+        }
+        return py::bytes(reinterpret_cast<const char*>(buf.data()), buf.size());
+    }, py::arg("bytes"), py::arg("seed") = 1, py::arg("links") = 4, py::arg("triggers_per_orbit") = 8.0,
+       py::arg("data_per_trigger") = 12.0, py::arg("page_lines") = 255, py::arg("page_align") = 0,
+       "Generate a deterministic synthetic CRU stream of at least `bytes` bytes (whole packets); "
+       "page_lines is clamped so that the page_align-rounded page length fits in 16 bits");
+}
@@ -0,0 +1,99 @@
+#include "binparse/batch_stream.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace bp {
+
+BatchStream::BatchStream(std::string path, TailOptions opt,
+                         std::size_t batch_lines, std::size_t queue_batches, FieldMask fields)
+    : path_(std::move(path))
+    , opt_(opt)
+    , batch_lines_(std::max<std::size_t>(batch_lines, 1))
+    , fields_(fields)
+    , queue_(queue_batches)
+    , free_(queue_batches + 1)
+{
+    opt_.stop = &stop_;
+    // 读到当前末尾时交出不满的批；调用方自己的 on_idle 照常调用
+    opt_.on_idle = [this, user = std::move(opt_.on_idle)] {
+        push();
+        if (user) user();
+    };
+    worker_ = std::thread([this] { run(); });
+}
+
+BatchStream::~BatchStream() {
+    stop();
+}
+
+void BatchStream::run() {
+    try {
+        tail_growing_file(path_, opt_, [this](std::span<const std::byte> chunk) { on_bytes(chunk); });
+        push(); // 文件末尾不足一批的行
+    } catch (...) {
+        err_ = std::current_exception();
+    }
+    queue_.close();
+}
+
+void BatchStream::on_bytes(std::span<const std::byte> chunk) {
+    carry_.feed(chunk, [this](std::span<const std::byte> lines) { append(lines); });
+}
+
+void BatchStream::append(std::span<const std::byte> lines) {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+    while (!lines.empty()) {
+        const std::size_t room  = batch_lines_ - cur_.lines();
+        const std::size_t bytes = std::min(room * kLine, lines.size());
+        decode_batch(lines.first(bytes), cur_, next_offset_, fields_);
+        next_offset_ += bytes;
+        lines = lines.subspan(bytes);
+        if (cur_.lines() >= batch_lines_) push();
+    }
+}
+
+void BatchStream::push() {
+    if (cur_.lines() == 0) return;
+    const std::size_t n_data = cur_.data.size(), n_trg = cur_.trg.size();
+    const std::size_t n_l0 = cur_.rdh_l0.size(), n_l1 = cur_.rdh_l1.size();
+    const std::size_t n_undef = cur_.undefined_offset.size();
+    // 队列已被 stop() 关闭时 push 失败，让 tail 尽快退出
+    if (!queue_.push(std::move(cur_))) stop_.store(true);
+    if (!free_.try_pop(cur_)) {
+        // 没有交还的批：按刚交出的这批一次性预留各列，不再每批从零逐次扩容
+        cur_ = LineBatch{};
+        cur_.type.reserve(batch_lines_);
+        cur_.data.resize(n_data, fields_.data);
+        cur_.trg.resize(n_trg, fields_.trg);
+        cur_.rdh_l0.resize(n_l0, fields_.rdh_l0);
+        cur_.rdh_l1.resize(n_l1, fields_.rdh_l1);
+        cur_.undefined_offset.reserve(n_undef);
+    }
+    cur_.clear(); // 保留容量
+}
+
+bool BatchStream::next(LineBatch& out) {
+    if (out.type.capacity()) {
+        out.clear();
+        free_.try_push(std::move(out));
+        out = LineBatch{};
+    }
+    if (queue_.pop(out)) return true;
+    join();
+    if (err_) std::rethrow_exception(std::exchange(err_, nullptr));
+    return false;
+}
+
+void BatchStream::stop() {
+    stop_.store(true);
+    queue_.close();
+    join();
+}
+
+void BatchStream::join() {
+    std::lock_guard lk(join_mu_);
+    if (worker_.joinable()) worker_.join();
+}
+
+} // namespace bp
@@ -0,0 +1,133 @@
+#include "binparse/chunk_pool.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace bp {
+
+namespace detail {
+
+struct ChunkPoolState {
+    std::size_t                            chunk_bytes = 0;
+    std::unique_ptr<ChunkSlot[]>           slots;
+    std::size_t                            n = 0;
+    mutable std::mutex                     mu;
+    std::condition_variable                cv;
+    std::vector<uint32_t>                  free; // 空闲块下标（栈：最近归还的块最可能还在缓存里）
+    bool                                   closed = false;
+    // ChunkPool 本身算一个，每个租出的块各算一个；归零时释放
+    std::atomic<std::size_t>               users{1};
+    ChunkPoolStats                         stats;
+
+    void unref() noexcept {
+        if (users.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+};
+
+void release_slot(ChunkSlot* s) noexcept {
+    ChunkPoolState* p = s->pool;
+    p->stats.in_use.fetch_sub(1, std::memory_order_relaxed);
+    {
+        std::lock_guard lk(p->mu);
+        p->free.push_back(s->index);
+    }
+    p->cv.notify_one();
+    p->unref();
+}
+
+} // namespace detail
+
+std::span<std::byte> ChunkLease::writable() const noexcept {
+    return {s_->buf.get(), s_->pool->chunk_bytes};
+}
+
+ChunkPool::ChunkPool(std::size_t chunks, std::size_t chunk_bytes)
+    : st_(new detail::ChunkPoolState)
+{
+    st_->chunk_bytes = std::max<std::size_t>(chunk_bytes, 1);
+    st_->n = std::max<std::size_t>(chunks, 1);
+    st_->slots = std::make_unique<detail::ChunkSlot[]>(st_->n);
+    st_->free.reserve(st_->n);
+    for (std::size_t i = st_->n; i-- > 0; ) {
+        auto& s = st_->slots[i];
+        s.pool = st_;
+        s.index = static_cast<uint32_t>(i);
+        s.buf = std::make_unique_for_overwrite<std::byte[]>(st_->chunk_bytes);
+        st_->free.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+ChunkPool::~ChunkPool() {
+    close();
+    st_->unref();
+}
+
+ChunkLease ChunkPool::lend(detail::ChunkSlot* s) noexcept {
+    auto& p = *st_;
+    s->len = 0;
+    s->offset = 0;
+    s->refs.store(1, std::memory_order_relaxed);
+    p.users.fetch_add(1, std::memory_order_relaxed);
+    p.stats.acquired.fetch_add(1, std::memory_order_relaxed);
+    const uint32_t occ = p.stats.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t prev = p.stats.max_in_use.load(std::memory_order_relaxed);
+    while (occ > prev && !p.stats.max_in_use.compare_exchange_weak(prev, occ, std::memory_order_relaxed)) {}
+    return ChunkLease(s);
+}
+
+ChunkLease ChunkPool::acquire_for(std::chrono::milliseconds timeout) {
+    auto& p = *st_;
+    std::unique_lock lk(p.mu);
+    if (p.free.empty() && !p.closed) {
+        p.stats.stalls.fetch_add(1, std::memory_order_relaxed);
+        p.cv.wait_for(lk, timeout, [&] { return !p.free.empty() || p.closed; });
+    }
+    if (p.closed || p.free.empty()) return {};
+    detail::ChunkSlot* s = &p.slots[p.free.back()];
+    p.free.pop_back();
+    lk.unlock();
+    return lend(s);
+}
+
+ChunkLease ChunkPool::acquire() {
+    for (;;) {
+        if (ChunkLease l = acquire_for(std::chrono::hours(1)); l || closed()) return l;
+    }
+}
+
+ChunkLease ChunkPool::try_acquire() {
+    auto& p = *st_;
+    std::unique_lock lk(p.mu);
+    if (p.closed || p.free.empty()) return {};
+    detail::ChunkSlot* s = &p.slots[p.free.back()];
+    p.free.pop_back();
+    lk.unlock();
+    return lend(s);
+}
+
+void ChunkPool::close() noexcept {
+    {
+        std::lock_guard lk(st_->mu);
+        st_->closed = true;
+    }
+    st_->cv.notify_all();
+}
+
+bool ChunkPool::closed() const noexcept {
+    std::lock_guard lk(st_->mu);
+    return st_->closed;
+}
+
+std::size_t ChunkPool::chunks() const noexcept { return st_->n; }
+std::size_t ChunkPool::chunk_bytes() const noexcept { return st_->chunk_bytes; }
+
+std::size_t ChunkPool::available() const noexcept {
+    std::lock_guard lk(st_->mu);
+    return st_->free.size();
+}
+
+const ChunkPoolStats& ChunkPool::stats() const noexcept { return st_->stats; }
+
+} // namespace bp
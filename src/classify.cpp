@@ -0,0 +1,144 @@
+#include "binparse/parser.hpp"
+#include "binparse/bytecursor.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  #include <immintrin.h>
+  #define BP_HAVE_X86_DISPATCH 1
+#endif
+
+namespace bp {
+namespace {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+
+    // 只看每行第 0 字节（小端 header 的低字节）
+    inline LineType classify_byte(uint8_t low) {
+        if (low == 0xac) return LineType::Data;
+        if (low == 0xbb) return LineType::TRG;
+        if (low == 0x07) return LineType::RDH_L0;
+        if (low == 0x03) return LineType::RDH_L1;
+        return LineType::Undefined;
+    }
+
+    std::size_t classify_scalar(const std::byte* p, std::size_t n, LineType* out) {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = classify_byte(static_cast<uint8_t>(p[i * kLine]));
+        return n;
+    }
+
+#ifdef BP_HAVE_X86_DISPATCH
+    // 8 行一组：gather 每行的首个 dword，取低字节后与四个 header 值比较，
+    // 再把 32 位结果压成 8 个 uint16 (LineType) 直接写出。
+    __attribute__((target("avx2")))
+    std::size_t classify_avx2(const std::byte* p, std::size_t n, LineType* out) {
+        const __m256i idx   = _mm256_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56); // dword stride = 32B
+        const __m256i low   = _mm256_set1_epi32(0xff);
+        const __m256i h_dat = _mm256_set1_epi32(0xac);
+        const __m256i h_trg = _mm256_set1_epi32(0xbb);
+        const __m256i h_l0  = _mm256_set1_epi32(0x07);
+        const __m256i h_l1  = _mm256_set1_epi32(0x03);
+        const __m256i v_trg = _mm256_set1_epi32(static_cast<int>(LineType::TRG));
+        const __m256i v_l0  = _mm256_set1_epi32(static_cast<int>(LineType::RDH_L0));
+        const __m256i v_l1  = _mm256_set1_epi32(static_cast<int>(LineType::RDH_L1));
+        const __m256i v_und = _mm256_set1_epi32(static_cast<int>(LineType::Undefined));
+
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const auto* base = reinterpret_cast<const int*>(p + i * kLine);
+            __m256i h = _mm256_and_si256(_mm256_i32gather_epi32(base, idx, 4), low);
+
+            __m256i m_dat = _mm256_cmpeq_epi32(h, h_dat);
+            __m256i m_trg = _mm256_cmpeq_epi32(h, h_trg);
+            __m256i m_l0  = _mm256_cmpeq_epi32(h, h_l0);
+            __m256i m_l1  = _mm256_cmpeq_epi32(h, h_l1);
+            __m256i known = _mm256_or_si256(_mm256_or_si256(m_dat, m_trg), _mm256_or_si256(m_l0, m_l1));
+
+            // Data == 0，所以只需 OR 上其余类型
+            __m256i t = _mm256_andnot_si256(known, v_und);
+            t = _mm256_or_si256(t, _mm256_and_si256(m_trg, v_trg));
+            t = _mm256_or_si256(t, _mm256_and_si256(m_l0,  v_l0));
+            t = _mm256_or_si256(t, _mm256_and_si256(m_l1,  v_l1));
+
+            // 32→16 位：packus 在每个 128 位 lane 内交错，再用 permute 取 qword 0/2
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(t, t), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(packed));
+        }
+        classify_scalar(p + i * kLine, n - i, out + i);
+        return n;
+    }
+
+    // 16 行一组，同上但用 mask 寄存器和 vpmovdw 截断
+    __attribute__((target("avx512f")))
+    std::size_t classify_avx512(const std::byte* p, std::size_t n, LineType* out) {
+        const __m512i idx   = _mm512_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56,
+                                                64, 72, 80, 88, 96, 104, 112, 120);
+        const __m512i low   = _mm512_set1_epi32(0xff);
+        const __m512i v_trg = _mm512_set1_epi32(static_cast<int>(LineType::TRG));
+        const __m512i v_l0  = _mm512_set1_epi32(static_cast<int>(LineType::RDH_L0));
+        const __m512i v_l1  = _mm512_set1_epi32(static_cast<int>(LineType::RDH_L1));
+        const __m512i v_und = _mm512_set1_epi32(static_cast<int>(LineType::Undefined));
+
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const auto* base = reinterpret_cast<const int*>(p + i * kLine);
+            // 带掩码的形式显式给出源操作数；非掩码版本在 GCC 12 下会报 -Wmaybe-uninitialized
+            __m512i h = _mm512_and_si512(_mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, idx, base, 4), low);
+
+            __mmask16 m_dat = _mm512_cmpeq_epi32_mask(h, _mm512_set1_epi32(0xac));
+            __mmask16 m_trg = _mm512_cmpeq_epi32_mask(h, _mm512_set1_epi32(0xbb));
+            __mmask16 m_l0  = _mm512_cmpeq_epi32_mask(h, _mm512_set1_epi32(0x07));
+            __mmask16 m_l1  = _mm512_cmpeq_epi32_mask(h, _mm512_set1_epi32(0x03));
+
+            __m512i t = _mm512_maskz_mov_epi32(static_cast<__mmask16>(~(m_dat | m_trg | m_l0 | m_l1)), v_und);
+            t = _mm512_mask_mov_epi32(t, m_trg, v_trg);
+            t = _mm512_mask_mov_epi32(t, m_l0,  v_l0);
+            t = _mm512_mask_mov_epi32(t, m_l1,  v_l1);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm512_mask_cvtepi32_epi16(_mm256_setzero_si256(), 0xFFFF, t));
+        }
+        classify_scalar(p + i * kLine, n - i, out + i);
+        return n;
+    }
+#endif
+
+    using ClassifyFn = std::size_t (*)(const std::byte*, std::size_t, LineType*);
+
+    struct Kernel {
+        ClassifyFn  fn;
+        const char* name;
+    };
+
+    // 运行时选一次；BINPARSE_ISA=scalar|avx2|avx512 可强制降级（基准/排查用）
+    Kernel pick_kernel() {
+        std::string_view want;
+        if (const char* env = std::getenv("BINPARSE_ISA")) want = env;
+#ifdef BP_HAVE_X86_DISPATCH
+        __builtin_cpu_init();
+        if ((want.empty() || want == "avx512") && __builtin_cpu_supports("avx512f"))
+            return {classify_avx512, "avx512"};
+        if ((want.empty() || want == "avx512" || want == "avx2") && __builtin_cpu_supports("avx2"))
+            return {classify_avx2, "avx2"};
+#endif
+        return {classify_scalar, "scalar"};
+    }
+
+    const Kernel& kernel() {
+        static const Kernel k = pick_kernel();
+        return k;
+    }
+}
+
+std::size_t classify_lines(std::span<const std::byte> chunk, LineType* out) {
+    const std::size_t n = chunk.size() / kLine;
+    if (n == 0) return 0;
+    return kernel().fn(chunk.data(), n, out);
+}
+
+const char* classify_isa() noexcept {
+    return kernel().name;
+}
+
+} // namespace bp
@@ -0,0 +1,535 @@
+#include "binparse/codec.hpp"
+#include "binparse/bytecursor.hpp"
+#include "binparse/lines.hpp"
+#include "binparse/parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace bp {
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "codec reads and writes fields in host (little-endian) layout");
+
+constexpr std::size_t kLine        = ByteCursor::kLineSize;
+constexpr char        kMagic[8]    = {'B', 'P', 'X', 'Z', '0', '0', '0', '1'};
+constexpr std::size_t kHeader      = 16;
+constexpr std::size_t kBlockHeader = 8;
+constexpr std::size_t kRefs        = 8;
+constexpr int         kRawAbove    = 26; // 与参考行不同的字节超过这个数就整行原样存
+
+using Line = std::array<std::byte, kLine>;
+
+// 操作码：低 5 位是参数
+enum Op : uint8_t {
+    kZeroRun = 0x00, // varint n：n 个全零行
+    kRaw     = 0x01, // 32 字节原样
+    kRepeat  = 0x02, // varint n：n 行与上一行相同
+    kData    = 0x20, // | flags
+    kTrg     = 0x40, // | flags
+    kDiff    = 0x60, // | cls << 3 | ref
+};
+enum Cls : uint8_t { kClsL0 = 0, kClsL1 = 1, kClsOther = 2, kClasses = 3 };
+
+template <class T>
+T ld(const std::byte* p) noexcept {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <class T>
+void st(std::byte* p, T v) noexcept { std::memcpy(p, &v, sizeof(T)); }
+
+uint64_t zigzag(int64_t v) noexcept { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+int64_t  unzigzag(uint64_t u) noexcept { return static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1); }
+
+void put_u8(std::vector<std::byte>& out, uint8_t v) { out.push_back(static_cast<std::byte>(v)); }
+
+void put_varint(std::vector<std::byte>& out, uint64_t v) {
+    while (v >= 0x80) {
+        put_u8(out, static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    put_u8(out, static_cast<uint8_t>(v));
+}
+
+void put_bytes(std::vector<std::byte>& out, const std::byte* p, std::size_t n) { out.insert(out.end(), p, p + n); }
+
+// 编码数据的游标；越界即视为数据损坏
+struct Reader {
+    const std::byte* p;
+    const std::byte* end;
+
+    [[noreturn]] static void corrupt() { throw ParseError{"corrupt compressed block"}; }
+
+    uint8_t u8() {
+        if (p == end) corrupt();
+        return static_cast<uint8_t>(*p++);
+    }
+    const std::byte* take(std::size_t n) {
+        if (static_cast<std::size_t>(end - p) < n) corrupt();
+        const std::byte* q = p;
+        p += n;
+        return q;
+    }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t b = u8();
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        corrupt();
+    }
+};
+
+Cls cls_of(std::byte b0) noexcept {
+    switch (static_cast<uint8_t>(b0)) {
+    case 0x07: return kClsL0;
+    case 0x03: return kClsL1;
+    default:   return kClsOther;
+    }
+}
+
+constexpr Line kZeroLine{};
+
+// 编码端与解码端各持一份，按同样的顺序更新；"上一行"直接取自 raw / out，不单独保存
+struct State {
+    uint8_t  d_vldb = 0;
+    uint16_t d_bx   = 0;
+    uint32_t d_ob   = 0;
+    uint32_t t_hdr  = 0xBBBB;
+    uint64_t t_bx   = 0;
+    uint64_t t_ob   = 0;
+    uint64_t t_r1   = 0;
+    std::array<std::array<Line, kRefs>, kClasses> refs{};
+
+    // 把第 r 个参考换成 line 并移到最前
+    void touch(Cls c, std::size_t r, const std::byte* line) noexcept {
+        auto& R = refs[c];
+        for (std::size_t i = r; i > 0; --i) R[i] = R[i - 1];
+        std::memcpy(R[0].data(), line, kLine);
+    }
+};
+
+// RDH 的计数器按 +1 预测
+Line predict(Cls c, const Line& ref) noexcept {
+    Line p = ref;
+    if (c == kClsL0) {
+        constexpr auto off = detail::off_L0::packet_counter;
+        p[off] = static_cast<std::byte>(static_cast<uint8_t>(ref[off]) + 1);
+    } else if (c == kClsL1) {
+        constexpr auto off = detail::off_L1::hb_packet_counter;
+        st<uint16_t>(p.data() + off, static_cast<uint16_t>(ld<uint16_t>(ref.data() + off) + 1));
+    }
+    return p;
+}
+
+uint32_t diff_mask(const std::byte* a, const std::byte* b) noexcept {
+    uint32_t m = 0;
+    for (std::size_t i = 0; i < kLine; ++i) m |= static_cast<uint32_t>(a[i] != b[i]) << i;
+    return m;
+}
+
+bool is_zero(const std::byte* l) noexcept {
+    uint64_t acc = 0;
+    for (std::size_t i = 0; i < kLine; i += 8) acc |= ld<uint64_t>(l + i);
+    return acc == 0;
+}
+
+// ---- Data：byte0 = 0xac, vldb u8 @1, bx u16 @2, ob u32 @4, 6 个 u32 word @8 ----
+void encode_data(State& s, const std::byte* l, std::vector<std::byte>& out) {
+    namespace o = detail::off_data;
+    const uint8_t  vldb = ld<uint8_t>(l + o::header_vldb_id);
+    const uint16_t bx   = ld<uint16_t>(l + o::bx_cnt);
+    const uint32_t ob   = ld<uint32_t>(l + o::ob_cnt);
+    const uint8_t flags = static_cast<uint8_t>((vldb == s.d_vldb) | (bx == s.d_bx) << 1 | (ob == s.d_ob) << 2);
+    put_u8(out, kData | flags);
+    if (!(flags & 1)) put_u8(out, vldb);
+    if (!(flags & 2)) put_varint(out, zigzag(static_cast<int16_t>(bx - s.d_bx)));
+    if (!(flags & 4)) put_varint(out, zigzag(static_cast<int32_t>(ob - s.d_ob)));
+    s.d_vldb = vldb;
+    s.d_bx = bx;
+    s.d_ob = ob;
+
+    // 6 个 word 按最大位宽 bit-pack
+    std::array<uint32_t, 6> w;
+    uint32_t any = 0;
+    for (std::size_t k = 0; k < 6; ++k) any |= w[k] = ld<uint32_t>(l + o::data_word0 + 4 * k);
+    const int width = std::bit_width(any);
+    put_u8(out, static_cast<uint8_t>(width));
+    if (width == 32) return put_bytes(out, l + o::data_word0, 24);
+    uint64_t acc = 0;
+    int bits = 0;
+    for (uint32_t v : w) {
+        acc |= static_cast<uint64_t>(v) << bits;
+        bits += width;
+        for (; bits >= 8; bits -= 8, acc >>= 8) put_u8(out, static_cast<uint8_t>(acc));
+    }
+    if (bits > 0) put_u8(out, static_cast<uint8_t>(acc));
+}
+
+void decode_data(State& s, uint8_t flags, Reader& r, std::byte* l) {
+    namespace o = detail::off_data;
+    if (!(flags & 1)) s.d_vldb = r.u8();
+    if (!(flags & 2)) s.d_bx = static_cast<uint16_t>(s.d_bx + unzigzag(r.varint()));
+    if (!(flags & 4)) s.d_ob = static_cast<uint32_t>(s.d_ob + unzigzag(r.varint()));
+    l[o::header_type] = std::byte{0xac};
+    l[o::header_vldb_id] = static_cast<std::byte>(s.d_vldb);
+    st<uint16_t>(l + o::bx_cnt, s.d_bx);
+    st<uint32_t>(l + o::ob_cnt, s.d_ob);
+
+    const int width = r.u8();
+    if (width == 32) {
+        std::memcpy(l + o::data_word0, r.take(24), 24);
+        return;
+    }
+    if (width > 32) Reader::corrupt();
+    const std::byte* p = r.take(static_cast<std::size_t>(6 * width + 7) / 8);
+    const uint64_t mask = (uint64_t{1} << width) - 1;
+    uint64_t acc = 0;
+    int bits = 0;
+    for (std::size_t k = 0; k < 6; ++k) {
+        for (; bits < width; bits += 8) acc |= static_cast<uint64_t>(*p++) << bits;
+        st<uint32_t>(l + o::data_word0 + 4 * k, static_cast<uint32_t>(acc & mask));
+        acc >>= width;
+        bits -= width;
+    }
+}
+
+// ---- TRG：header u32 @0, bx u64 @4, ob u64 @12, reserved0 u32 @20, reserved1 u64 @24 ----
+void encode_trg(State& s, const std::byte* l, std::vector<std::byte>& out) {
+    namespace o = detail::off_trg;
+    const uint32_t hdr = ld<uint32_t>(l + o::header_type);
+    const uint64_t bx  = ld<uint64_t>(l + o::bx_cnt);
+    const uint64_t ob  = ld<uint64_t>(l + o::ob_cnt);
+    const uint32_t r0  = ld<uint32_t>(l + o::reserved0);
+    const uint64_t r1  = ld<uint64_t>(l + o::reserved1);
+    const uint8_t flags = static_cast<uint8_t>((hdr == s.t_hdr) | (r0 == 0) << 1 | (r1 == 0) << 2);
+    put_u8(out, kTrg | flags);
+    if (!(flags & 1)) put_bytes(out, l + o::header_type, 4);
+    put_varint(out, zigzag(static_cast<int64_t>(bx - s.t_bx)));
+    put_varint(out, zigzag(static_cast<int64_t>(ob - s.t_ob)));
+    if (!(flags & 2)) put_bytes(out, l + o::reserved0, 4);
+    if (!(flags & 4)) put_varint(out, zigzag(static_cast<int64_t>(r1 - s.t_r1)));
+    s.t_hdr = hdr;
+    s.t_bx = bx;
+    s.t_ob = ob;
+    if (r1) s.t_r1 = r1; // 时间戳（bpx_dmasim）相对上一个非零值做差
+}
+
+void decode_trg(State& s, uint8_t flags, Reader& r, std::byte* l) {
+    namespace o = detail::off_trg;
+    if (!(flags & 1)) s.t_hdr = ld<uint32_t>(r.take(4));
+    s.t_bx += static_cast<uint64_t>(unzigzag(r.varint()));
+    s.t_ob += static_cast<uint64_t>(unzigzag(r.varint()));
+    const uint32_t r0 = (flags & 2) ? 0 : ld<uint32_t>(r.take(4));
+    uint64_t r1 = 0;
+    if (!(flags & 4)) s.t_r1 = r1 = s.t_r1 + static_cast<uint64_t>(unzigzag(r.varint()));
+    st<uint32_t>(l + o::header_type, s.t_hdr);
+    st<uint64_t>(l + o::bx_cnt, s.t_bx);
+    st<uint64_t>(l + o::ob_cnt, s.t_ob);
+    st<uint32_t>(l + o::reserved0, r0);
+    st<uint64_t>(l + o::reserved1, r1);
+}
+
+// ---- RDH 与其它行：对最近 kRefs 个同类行中最接近的一个存差异字节 ----
+void encode_diff(State& s, const std::byte* l, std::vector<std::byte>& out) {
+    const Cls c = cls_of(l[0]);
+    std::size_t best = 0;
+    uint32_t    best_mask = ~0u;
+    for (std::size_t r = 0; r < kRefs; ++r) {
+        const Line p = predict(c, s.refs[c][r]);
+        const uint32_t m = diff_mask(l, p.data());
+        if (std::popcount(m) < std::popcount(best_mask)) {
+            best = r;
+            best_mask = m;
+            if (m == 0) break;
+        }
+    }
+    if (std::popcount(best_mask) > kRawAbove) {
+        put_u8(out, kRaw);
+        put_bytes(out, l, kLine);
+        s.touch(c, kRefs - 1, l);
+        return;
+    }
+    put_u8(out, static_cast<uint8_t>(kDiff | c << 3 | best));
+    put_varint(out, best_mask);
+    for (uint32_t m = best_mask; m; m &= m - 1) out.push_back(l[std::countr_zero(m)]);
+    s.touch(c, best, l);
+}
+
+void decode_diff(State& s, uint8_t arg, Reader& r, std::byte* l) {
+    const auto c = static_cast<Cls>(arg >> 3);
+    const std::size_t ref = arg & 7;
+    if (c >= kClasses) Reader::corrupt();
+    Line p = predict(c, s.refs[c][ref]);
+    const uint64_t mask = r.varint();
+    if (mask > std::numeric_limits<uint32_t>::max()) Reader::corrupt();
+    for (auto m = static_cast<uint32_t>(mask); m; m &= m - 1) p[std::countr_zero(m)] = static_cast<std::byte>(r.u8());
+    std::memcpy(l, p.data(), kLine);
+    s.touch(c, ref, l);
+}
+
+// 容器中的一块
+struct BlockRef {
+    uint64_t comp_off = 0;
+    uint32_t comp_len = 0;
+    uint64_t raw_off  = 0;
+    uint32_t raw_len  = 0;
+};
+
+std::vector<BlockRef> scan_blocks(std::span<const std::byte> packed) {
+    if (packed.size() < kHeader || std::memcmp(packed.data(), kMagic, sizeof(kMagic)) != 0)
+        throw ParseError{"not a bpx compressed stream"};
+    std::vector<BlockRef> out;
+    uint64_t raw = 0;
+    for (std::size_t off = kHeader; off < packed.size(); ) {
+        if (packed.size() - off < kBlockHeader) throw ParseError{"truncated block header", off, kBlockHeader, packed.size() - off};
+        BlockRef b;
+        b.raw_len  = ld<uint32_t>(packed.data() + off);
+        b.comp_len = ld<uint32_t>(packed.data() + off + 4);
+        b.comp_off = off + kBlockHeader;
+        b.raw_off  = raw;
+        if (packed.size() - b.comp_off < b.comp_len)
+            throw ParseError{"truncated block", static_cast<std::size_t>(b.comp_off), b.comp_len,
+                             static_cast<std::size_t>(packed.size() - b.comp_off)};
+        raw += b.raw_len;
+        off = static_cast<std::size_t>(b.comp_off) + b.comp_len;
+        out.push_back(b);
+    }
+    return out;
+}
+
+std::vector<Shard> comp_shards(std::span<const BlockRef> blocks) {
+    std::vector<Shard> s;
+    s.reserve(blocks.size());
+    for (const auto& b : blocks) s.push_back(Shard{b.comp_off, b.comp_len});
+    return s;
+}
+
+} // namespace
+
+std::size_t compress_block(std::span<const std::byte> raw, std::vector<std::byte>& out) {
+    const std::size_t start = out.size();
+    const std::size_t n = raw.size() / kLine;
+    State s;
+
+    for (std::size_t i = 0; i < n; ) {
+        const std::byte* l = raw.data() + i * kLine;
+        const std::byte* prev = i ? l - kLine : kZeroLine.data();
+
+        // 全零 / 重复行按游程
+        if (is_zero(l)) {
+            std::size_t j = i + 1;
+            while (j < n && is_zero(raw.data() + j * kLine)) ++j;
+            put_u8(out, kZeroRun);
+            put_varint(out, j - i);
+            i = j;
+            continue;
+        }
+        if (std::memcmp(l, prev, kLine) == 0) {
+            std::size_t j = i + 1;
+            while (j < n && std::memcmp(raw.data() + j * kLine, prev, kLine) == 0) ++j;
+            put_u8(out, kRepeat);
+            put_varint(out, j - i);
+            i = j;
+            continue;
+        }
+
+        switch (static_cast<uint8_t>(l[0])) {
+        case 0xac: encode_data(s, l, out); break;
+        case 0xbb: encode_trg(s, l, out); break;
+        default:   encode_diff(s, l, out); break;
+        }
+        ++i;
+    }
+    put_bytes(out, raw.data() + n * kLine, raw.size() - n * kLine); // 不足一行的尾部
+    return out.size() - start;
+}
+
+void decompress_block(std::span<const std::byte> comp, std::span<std::byte> out) {
+    const std::size_t n = out.size() / kLine;
+    Reader r{comp.data(), comp.data() + comp.size()};
+    State s;
+
+    for (std::size_t i = 0; i < n; ) {
+        std::byte* l = out.data() + i * kLine;
+        const uint8_t op = r.u8();
+
+        if (op == kZeroRun || op == kRepeat) {
+            const uint64_t k = r.varint();
+            if (k == 0 || k > n - i) Reader::corrupt();
+            if (op == kZeroRun) {
+                std::memset(l, 0, k * kLine);
+            } else {
+                const std::byte* prev = i ? l - kLine : kZeroLine.data();
+                for (uint64_t j = 0; j < k; ++j) std::memcpy(l + j * kLine, prev, kLine);
+            }
+            i += k;
+            continue;
+        }
+
+        switch (op & 0xE0) {
+        case kData: decode_data(s, op & 0x1F, r, l); break;
+        case kTrg:  decode_trg(s, op & 0x1F, r, l); break;
+        case kDiff: decode_diff(s, op & 0x1F, r, l); break;
+        default:
+            if (op != kRaw) Reader::corrupt();
+            std::memcpy(l, r.take(kLine), kLine);
+            s.touch(cls_of(l[0]), kRefs - 1, l);
+            break;
+        }
+        ++i;
+    }
+
+    const std::size_t tail = out.size() - n * kLine;
+    std::memcpy(out.data() + n * kLine, r.take(tail), tail);
+    if (r.p != r.end) Reader::corrupt();
+}
+
+std::vector<std::byte> compress(std::span<const std::byte> raw, const CodecOptions& opt) {
+    const std::size_t bs = std::clamp<std::size_t>(opt.block_bytes / kLine * kLine, kLine,
+                                                   std::size_t{1} << 30);
+    std::vector<Shard> shards;
+    for (std::size_t off = 0; off < raw.size(); off += bs)
+        shards.push_back(Shard{off, std::min(bs, raw.size() - off)});
+
+    std::vector<std::vector<std::byte>> parts(shards.size());
+    run_shards_parallel(raw, shards, opt.threads, [&](std::size_t idx, std::span<const std::byte> bytes) {
+        parts[idx].reserve(bytes.size() / 2);
+        compress_block(bytes, parts[idx]);
+    });
+
+    std::size_t total = kHeader;
+    for (const auto& p : parts) total += kBlockHeader + p.size();
+    std::vector<std::byte> out(kHeader);
+    out.reserve(total);
+    std::memcpy(out.data(), kMagic, sizeof(kMagic));
+    st<uint32_t>(out.data() + 8, static_cast<uint32_t>(bs));
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        std::byte hdr[kBlockHeader];
+        st<uint32_t>(hdr, static_cast<uint32_t>(shards[i].size));
+        st<uint32_t>(hdr + 4, static_cast<uint32_t>(parts[i].size()));
+        put_bytes(out, hdr, kBlockHeader);
+        put_bytes(out, parts[i].data(), parts[i].size());
+    }
+    return out;
+}
+
+uint64_t decompressed_size(std::span<const std::byte> packed) {
+    uint64_t n = 0;
+    for (const auto& b : scan_blocks(packed)) n += b.raw_len;
+    return n;
+}
+
+std::vector<std::byte> decompress(std::span<const std::byte> packed, unsigned threads) {
+    const auto blocks = scan_blocks(packed);
+    std::vector<std::byte> out(blocks.empty() ? 0 : blocks.back().raw_off + blocks.back().raw_len);
+    run_shards_parallel(packed, comp_shards(blocks), threads, [&](std::size_t idx, std::span<const std::byte> comp) {
+        const auto& b = blocks[idx];
+        decompress_block(comp, std::span<std::byte>(out).subspan(static_cast<std::size_t>(b.raw_off), b.raw_len));
+    });
+    return out;
+}
+
+void decompress_stream(std::span<const std::byte> packed,
+                       const std::function<void(std::span<const std::byte>)>& on_bytes,
+                       unsigned threads) {
+    const auto blocks = scan_blocks(packed);
+    if (blocks.empty()) return;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t max_raw = 0;
+    for (const auto& b : blocks) max_raw = std::max<std::size_t>(max_raw, b.raw_len);
+
+    auto comp_of = [&](std::size_t k) {
+        return packed.subspan(static_cast<std::size_t>(blocks[k].comp_off), blocks[k].comp_len);
+    };
+
+    if (threads == 1 || blocks.size() == 1) {
+        std::vector<std::byte> buf(max_raw);
+        for (std::size_t k = 0; k < blocks.size(); ++k) {
+            const auto raw = std::span<std::byte>(buf).first(blocks[k].raw_len);
+            decompress_block(comp_of(k), raw);
+            on_bytes(raw);
+        }
+        return;
+    }
+
+    // 常驻解码线程按块序号领活，解到 workers+1 个缓冲组成的环里（块 k 用 k % ring），
+    // 调用线程按序交出；环满时解码线程等回调还回最早的缓冲，所以最多领先 ring 块
+    const std::size_t workers = std::min<std::size_t>(threads, blocks.size());
+    const std::size_t ring = workers + 1;
+    std::vector<std::vector<std::byte>> bufs(ring, std::vector<std::byte>(max_raw));
+    std::vector<std::size_t> ready(ring, 0); // 缓冲里已解好的块序号 + 1
+    std::mutex mu;
+    std::condition_variable can_claim, can_consume;
+    std::size_t next = 0, consumed = 0;
+    bool quit = false;
+    std::exception_ptr err;
+
+    auto work = [&] {
+        std::unique_lock lk(mu);
+        for (;;) {
+            can_claim.wait(lk, [&] { return quit || (next < blocks.size() && next < consumed + ring); });
+            if (quit) return;
+            const std::size_t k = next++;
+            lk.unlock();
+            try {
+                decompress_block(comp_of(k), std::span<std::byte>(bufs[k % ring]).first(blocks[k].raw_len));
+            } catch (...) {
+                lk.lock();
+                if (!err) err = std::current_exception();
+                quit = true;
+                can_claim.notify_all();
+                can_consume.notify_one();
+                return;
+            }
+            lk.lock();
+            ready[k % ring] = k + 1;
+            can_consume.notify_one();
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    auto finish = [&] {
+        {
+            std::lock_guard lk(mu);
+            quit = true;
+        }
+        can_claim.notify_all();
+        for (auto& t : pool) t.join();
+    };
+
+    try {
+        for (std::size_t w = 0; w < workers; ++w) pool.emplace_back(work);
+        for (std::size_t k = 0; k < blocks.size(); ++k) {
+            {
+                std::unique_lock lk(mu);
+                can_consume.wait(lk, [&] { return err || ready[k % ring] == k + 1; });
+                if (err) break;
+            }
+            on_bytes(std::span<const std::byte>(bufs[k % ring]).first(blocks[k].raw_len));
+            {
+                std::lock_guard lk(mu);
+                consumed = k + 1;
+            }
+            can_claim.notify_one();
+        }
+    } catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+    if (err) std::rethrow_exception(err);
+}
+
+} // namespace bp
@@ -0,0 +1,273 @@
+#include "binparse/columnar.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace bp {
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "column files are written in host (little-endian) layout");
+
+constexpr char        kMagic[8]      = {'B', 'P', 'X', 'C', 'O', 'L', '0', '1'};
+constexpr uint32_t    kVersion       = 1;
+constexpr std::size_t kFileHeader    = 64;
+constexpr uint32_t    kChunkMagic    = 0x43585042; // "BPXC"
+constexpr std::size_t kChunkHeader   = 32;
+constexpr std::size_t kColumnDesc    = 48;
+constexpr std::size_t kNameBytes     = 24;
+constexpr std::size_t kAlign         = 64;
+constexpr std::size_t kLine          = ByteCursor::kLineSize;
+
+constexpr std::size_t align_up(std::size_t v) noexcept { return (v + kAlign - 1) / kAlign * kAlign; }
+
+template <class T>
+T load(const std::byte* p) noexcept {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <class T>
+void store(std::byte* p, T v) noexcept { std::memcpy(p, &v, sizeof(T)); }
+
+} // namespace
+
+const char* to_string(ColumnTable t) noexcept {
+    switch (t) {
+    case ColumnTable::Data:      return "DATA";
+    case ColumnTable::Trg:       return "TRG";
+    case ColumnTable::RdhL0:     return "L0";
+    case ColumnTable::RdhL1:     return "L1";
+    case ColumnTable::Undefined: return "UNDEFINED";
+    }
+    return "?";
+}
+
+// ---------- writer ----------
+
+ColumnFileWriter::ColumnFileWriter(const std::string& path, FieldMask fields, std::size_t chunk_lines)
+    : path_(path)
+    , out_(path, std::ios::binary | std::ios::trunc)
+    , fields_(fields)
+    , chunk_lines_(std::max<std::size_t>(chunk_lines, 1))
+{
+    if (!out_) throw std::runtime_error("open failed: " + path);
+    std::array<std::byte, kFileHeader> hdr{};
+    std::memcpy(hdr.data(), kMagic, sizeof(kMagic));
+    store<uint32_t>(hdr.data() + 8, kVersion);
+    store<uint32_t>(hdr.data() + 12, kFileHeader);
+    out_.write(reinterpret_cast<const char*>(hdr.data()), hdr.size());
+    bytes_ = kFileHeader;
+}
+
+ColumnFileWriter::~ColumnFileWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void ColumnFileWriter::feed(std::span<const std::byte> bytes) {
+    if (carry_len_ > 0) {
+        const std::size_t take = std::min(kLine - carry_len_, bytes.size());
+        std::memcpy(carry_.data() + carry_len_, bytes.data(), take);
+        carry_len_ += take;
+        bytes = bytes.subspan(take);
+        if (carry_len_ < kLine) return;
+        carry_len_ = 0;
+        decode_batch(carry_, cur_, next_offset_, fields_);
+        next_offset_ += kLine;
+    }
+
+    const std::size_t n = bytes.size() / kLine;
+    // 按 chunk_lines 切片，块的行数不超过 chunk_lines
+    for (std::size_t i = 0; i < n; ) {
+        const std::size_t m = std::min(n - i, chunk_lines_ - std::min(cur_.lines(), chunk_lines_));
+        decode_batch(bytes.subspan(i * kLine, m * kLine), cur_, next_offset_, fields_);
+        next_offset_ += m * kLine;
+        i += m;
+        if (cur_.lines() >= chunk_lines_) {
+            write(cur_);
+            cur_.clear();
+        }
+    }
+
+    const std::size_t rem = bytes.size() - n * kLine;
+    if (rem) {
+        std::memcpy(carry_.data(), bytes.data() + n * kLine, rem);
+        carry_len_ = rem;
+    }
+}
+
+void ColumnFileWriter::write(const LineBatch& b) {
+    auto add = [](std::vector<Column>& cols, const char* name, const auto& v, std::size_t rows) {
+        using T = typename std::decay_t<decltype(v)>::value_type;
+        if (v.size() == rows) cols.push_back({name, column_type_of<T>(), std::as_bytes(std::span(v))});
+    };
+    std::vector<Column> cols;
+
+    if (const std::size_t n = b.data.size()) {
+        const auto& c = b.data;
+        cols.clear();
+        add(cols, "offset", c.offset, n);
+        add(cols, "header_vldb_id", c.header_vldb_id, n);
+        add(cols, "bx_cnt", c.bx_cnt, n);
+        add(cols, "ob_cnt", c.ob_cnt, n);
+        add(cols, "data_word0", c.data_word0, n);
+        add(cols, "data_word1", c.data_word1, n);
+        add(cols, "data_word2", c.data_word2, n);
+        add(cols, "data_word3", c.data_word3, n);
+        add(cols, "data_word4", c.data_word4, n);
+        add(cols, "data_word5", c.data_word5, n);
+        write_chunk(ColumnTable::Data, n, cols);
+    }
+    if (const std::size_t n = b.trg.size()) {
+        const auto& c = b.trg;
+        cols.clear();
+        add(cols, "offset", c.offset, n);
+        add(cols, "bx_cnt", c.bx_cnt, n);
+        add(cols, "ob_cnt", c.ob_cnt, n);
+        write_chunk(ColumnTable::Trg, n, cols);
+    }
+    if (const std::size_t n = b.rdh_l0.size()) {
+        const auto& c = b.rdh_l0;
+        cols.clear();
+        add(cols, "offset", c.offset, n);
+        add(cols, "fee_id", c.fee_id, n);
+        add(cols, "offset_new_packet", c.offset_new_packet, n);
+        add(cols, "memory_size", c.memory_size, n);
+        add(cols, "link_id", c.link_id, n);
+        add(cols, "packet_counter", c.packet_counter, n);
+        add(cols, "cru_id", c.cru_id, n);
+        add(cols, "bc", c.bc, n);
+        add(cols, "orbit", c.orbit, n);
+        write_chunk(ColumnTable::RdhL0, n, cols);
+    }
+    if (const std::size_t n = b.rdh_l1.size()) {
+        const auto& c = b.rdh_l1;
+        cols.clear();
+        add(cols, "offset", c.offset, n);
+        add(cols, "trg_type", c.trg_type, n);
+        add(cols, "hb_packet_counter", c.hb_packet_counter, n);
+        add(cols, "stop_bit", c.stop_bit, n);
+        add(cols, "detector_field", c.detector_field, n);
+        write_chunk(ColumnTable::RdhL1, n, cols);
+    }
+    if (const std::size_t n = b.undefined_offset.size()) {
+        cols.clear();
+        add(cols, "offset", b.undefined_offset, n);
+        write_chunk(ColumnTable::Undefined, n, cols);
+    }
+    lines_ += b.lines();
+}
+
+void ColumnFileWriter::write_chunk(ColumnTable t, uint64_t rows, const std::vector<Column>& cols) {
+    // 块头与列描述一次写出，列数据逐列写并补齐到 64 字节
+    std::vector<std::byte> head(align_up(kChunkHeader + cols.size() * kColumnDesc));
+    std::size_t data_off = head.size();
+    for (std::size_t i = 0; i < cols.size(); ++i) {
+        std::byte* d = head.data() + kChunkHeader + i * kColumnDesc;
+        std::strncpy(reinterpret_cast<char*>(d), cols[i].name, kNameBytes - 1);
+        store<uint8_t>(d + kNameBytes, static_cast<uint8_t>(cols[i].type));
+        store<uint64_t>(d + 32, data_off);
+        store<uint64_t>(d + 40, cols[i].bytes.size());
+        data_off += align_up(cols[i].bytes.size());
+    }
+    store<uint32_t>(head.data(), kChunkMagic);
+    store<uint16_t>(head.data() + 4, static_cast<uint16_t>(t));
+    store<uint16_t>(head.data() + 6, static_cast<uint16_t>(cols.size()));
+    store<uint64_t>(head.data() + 8, rows);
+    store<uint64_t>(head.data() + 16, data_off);
+
+    static constexpr char kZeros[kAlign] = {};
+    out_.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+    for (const auto& c : cols) {
+        out_.write(reinterpret_cast<const char*>(c.bytes.data()), static_cast<std::streamsize>(c.bytes.size()));
+        out_.write(kZeros, static_cast<std::streamsize>(align_up(c.bytes.size()) - c.bytes.size()));
+    }
+    if (!out_) throw std::runtime_error("write failed: " + path_);
+    bytes_ += data_off;
+    ++chunks_;
+}
+
+void ColumnFileWriter::flush() {
+    if (cur_.lines()) {
+        write(cur_);
+        cur_.clear();
+    }
+    out_.flush();
+    if (!out_) throw std::runtime_error("write failed: " + path_);
+}
+
+void ColumnFileWriter::close() {
+    if (closed_) return;
+    closed_ = true;
+    flush(); // 末尾不足一行的 carry 字节被丢弃
+    out_.close();
+}
+
+// ---------- reader ----------
+
+const ColumnFileReader::ColumnChunk* ColumnFileReader::Chunk::find(std::string_view name) const noexcept {
+    for (const auto& c : columns)
+        if (c.name == name) return &c;
+    return nullptr;
+}
+
+ColumnFileReader::ColumnFileReader(const std::string& path) : file_(path) {
+    const auto bytes = file_.bytes();
+    if (bytes.size() < kFileHeader || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0)
+        throw ParseError{"not a bpx column file: " + path};
+    if (const auto v = load<uint32_t>(bytes.data() + 8); v != kVersion)
+        throw ParseError{"unsupported column file version", 8, kVersion, v};
+    const std::size_t header = load<uint32_t>(bytes.data() + 12);
+    file_.advise(MappedFile::Advice::Random); // 通常只读部分列
+
+    std::size_t off = std::max(header, kFileHeader);
+    while (off < bytes.size()) {
+        const std::size_t avail = bytes.size() - off;
+        const std::byte* p = bytes.data() + off;
+        if (avail < kChunkHeader) { truncated_ = avail; break; }
+        if (load<uint32_t>(p) != kChunkMagic) throw ParseError{"bad chunk magic in " + path, off};
+
+        Chunk ch;
+        ch.table = static_cast<ColumnTable>(load<uint16_t>(p + 4));
+        const std::size_t ncols = load<uint16_t>(p + 6);
+        ch.rows = load<uint64_t>(p + 8);
+        ch.file_offset = off;
+        const uint64_t len = load<uint64_t>(p + 16);
+        if (len > avail) { truncated_ = avail; break; }
+        if (len < kChunkHeader + ncols * kColumnDesc || len % kAlign != 0 ||
+            static_cast<std::size_t>(ch.table) >= kColumnTables)
+            throw ParseError{"corrupt chunk header in " + path, off};
+
+        for (std::size_t i = 0; i < ncols; ++i) {
+            const std::byte* d = p + kChunkHeader + i * kColumnDesc;
+            const auto* name = reinterpret_cast<const char*>(d);
+            ColumnChunk col;
+            col.name  = std::string_view(name, static_cast<std::size_t>(std::find(name, name + kNameBytes, '\0') - name));
+            col.type  = static_cast<ColumnType>(load<uint8_t>(d + kNameBytes));
+            col.rows  = ch.rows;
+            const uint64_t doff = load<uint64_t>(d + 32);
+            const uint64_t dlen = load<uint64_t>(d + 40);
+            const auto width = static_cast<uint64_t>(col.type);
+            if (!std::has_single_bit(width) || width > 8 || dlen != ch.rows * width ||
+                doff % kAlign != 0 || doff > len || dlen > len - doff)
+                throw ParseError{"corrupt column descriptor in " + path, off + kChunkHeader + i * kColumnDesc};
+            col.bytes = bytes.subspan(off + doff, dlen);
+            ch.columns.push_back(col);
+        }
+        chunks_.push_back(std::move(ch));
+        off += len;
+    }
+}
+
+uint64_t ColumnFileReader::rows(ColumnTable t) const noexcept {
+    uint64_t n = 0;
+    for (const auto& c : chunks_)
+        if (c.table == t) n += c.rows;
+    return n;
+}
+
+} // namespace bp
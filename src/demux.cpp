@@ -0,0 +1,106 @@
+#include "binparse/demux.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+namespace bp {
+
+LinkDemux::LinkDemux(DemuxOptions opt, Consumer consumer)
+    : opt_(opt)
+    , consumer_(std::move(consumer))
+    , free_(std::max<std::size_t>(opt.consumers, 1) * std::max<std::size_t>(opt.queue_batches, 1))
+{
+    const std::size_t n = std::max<std::size_t>(opt_.consumers, 1);
+    groups_.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        groups_.push_back(std::make_unique<Group>(opt_.queue_batches));
+    for (std::size_t i = 0; i < n; ++i)
+        groups_[i]->worker = std::thread([this, i] { run_group(i); });
+}
+
+LinkDemux::~LinkDemux() {
+    try { close(); } catch (...) {}
+}
+
+void LinkDemux::feed(std::span<const std::byte> chunk) {
+    parser_.feed(chunk);
+}
+
+void LinkDemux::switch_link(const RDH_L0& r) {
+    const LinkKey k{r.cru_id, r.link_id, r.fee_id};
+    if (cur_ && cur_->key == k) return;
+    auto [it, inserted] = pending_.try_emplace(k);
+    if (inserted) it->second.key = k;
+    cur_ = &it->second;
+}
+
+void LinkDemux::route(std::span<const std::byte> line) {
+    if (!cur_) { ++orphans_; return; }
+    auto& b = cur_->bytes;
+    if (b.capacity() == 0) b = take_buffer();
+    b.insert(b.end(), line.begin(), line.end());
+    if (b.size() >= opt_.batch_bytes) dispatch(*cur_);
+}
+
+std::vector<std::byte> LinkDemux::take_buffer() {
+    std::vector<std::byte> v;
+    if (!free_.try_pop(v)) v.reserve(opt_.batch_bytes + ByteCursor::kLineSize);
+    v.clear();
+    return v;
+}
+
+void LinkDemux::dispatch(Batch& b) {
+    if (b.bytes.empty()) return;
+    Batch out{b.key, std::move(b.bytes)};
+    b.bytes = {};
+    groups_[group_of(out.key)]->queue.push(std::move(out)); // 队列满时在此阻塞
+}
+
+void LinkDemux::flush() {
+    for (auto& [k, b] : pending_) dispatch(b);
+}
+
+void LinkDemux::close() {
+    if (closed_) return;
+    closed_ = true;
+    flush();
+    for (auto& g : groups_) g->queue.close();
+    for (auto& g : groups_)
+        if (g->worker.joinable()) g->worker.join();
+    if (err_) std::rethrow_exception(err_);
+}
+
+void LinkDemux::run_group(std::size_t gi) {
+#ifdef __linux__
+    if (opt_.pin_threads) {
+        const unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((static_cast<unsigned>(opt_.first_cpu) + gi) % ncpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+    auto& q = groups_[gi]->queue;
+    Batch b;
+    bool failed = false;
+    while (q.pop(b)) {
+        // 出错后继续取空队列，避免生产端在满队列上永久阻塞
+        if (!failed) {
+            try {
+                consumer_(b.key, b.bytes);
+            } catch (...) {
+                std::lock_guard lk(err_mu_);
+                if (!err_) err_ = std::current_exception();
+                failed = true;
+            }
+        }
+        free_.try_push(std::move(b.bytes));
+    }
+}
+
+} // namespace bp
@@ -0,0 +1,133 @@
+#include "binparse/dmasim.hpp"
+#include "binparse/bytecursor.hpp"
+#include "binparse/lines.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace bp {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr std::size_t kLine = ByteCursor::kLineSize;
+
+// 在块内每个 TRG 行的 reserved1 写入 ts，返回写入的行数
+uint64_t stamp_trg_lines(std::span<std::byte> buf, uint64_t ts) {
+    if constexpr (std::endian::native == std::endian::big) ts = std::byteswap(ts);
+    uint64_t n = 0;
+    for (std::size_t off = 0; off + kLine <= buf.size(); off += kLine) {
+        if (classify_line(buf.subspan(off, kLine)) != LineType::TRG) continue;
+        std::memcpy(buf.data() + off + detail::off_trg::reserved1, &ts, sizeof(ts));
+        ++n;
+    }
+    return n;
+}
+
+std::ofstream open_out(const std::string& path, bool append) {
+    std::ofstream out(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    if (!out) throw std::runtime_error("open failed: " + path);
+    return out;
+}
+
+} // namespace
+
+DmaSource synth_source(SynthOptions opt) {
+    auto gen = std::make_shared<SynthStream>(opt);
+    return [gen](std::vector<std::byte>& out) {
+        gen->next_packet(out);
+        return true;
+    };
+}
+
+DmaSource file_source(std::string path, bool loop, std::size_t block_bytes) {
+    auto in = std::make_shared<std::ifstream>(path, std::ios::binary);
+    if (!*in) throw std::runtime_error("open failed: " + path);
+    block_bytes = std::max(block_bytes / kLine, std::size_t{1}) * kLine;
+    return [in, path = std::move(path), loop, block_bytes](std::vector<std::byte>& out) {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            const std::size_t old = out.size();
+            out.resize(old + block_bytes);
+            in->read(reinterpret_cast<char*>(out.data() + old), static_cast<std::streamsize>(block_bytes));
+            const auto got = static_cast<std::size_t>(in->gcount()) / kLine * kLine; // 末尾不足一行的部分丢弃
+            out.resize(old + got);
+            if (got > 0) return true;
+            if (!loop) return false;
+            in->clear();
+            in->seekg(0);
+        }
+        return false; // 空文件
+    };
+}
+
+DmaSimStats run_dma_sim(const std::string& path, const DmaSimOptions& opt, const DmaSource& src) {
+    DmaSimStats st;
+    const std::size_t write_bytes = std::max(opt.write_bytes, kLine);
+    const std::size_t burst = std::max<std::size_t>(opt.burst_writes, 1);
+    const double bytes_per_ns = opt.rate_mbps > 0 ? opt.rate_mbps * 1e6 / 1e9 : 0;
+
+    std::ofstream out = open_out(path, opt.append);
+    uint64_t file_bytes = opt.append ? static_cast<uint64_t>(out.tellp()) : 0;
+
+    std::vector<std::byte> buf;
+    buf.reserve(write_bytes + (64u << 10));
+    bool eof = false;
+
+    const auto t0 = Clock::now();
+    const auto deadline = opt.duration_s > 0
+        ? t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration_s))
+        : Clock::time_point::max();
+
+    for (;;) {
+        if (opt.stop && opt.stop->load(std::memory_order_relaxed)) break;
+        if (opt.total_bytes && st.bytes >= opt.total_bytes) break;
+        if (Clock::now() >= deadline) break;
+
+        // 攒够一次写入；记录不拆开，所以块可能略大于 write_bytes
+        buf.clear();
+        while (!eof && buf.size() < write_bytes) eof = !src(buf);
+        if (buf.empty()) break;
+
+        // 轮转/截断只发生在两次写入之间，新文件总是从记录边界开始
+        if (opt.rotate_bytes && file_bytes >= opt.rotate_bytes) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::rename(path, path + ".1", ec);
+            if (ec) throw std::runtime_error("rename failed: " + path + ": " + ec.message());
+            out = open_out(path, false);
+            file_bytes = 0;
+            ++st.rotations;
+        } else if (opt.truncate_bytes && file_bytes >= opt.truncate_bytes) {
+            out.close();
+            out = open_out(path, false);
+            file_bytes = 0;
+            ++st.truncations;
+        }
+
+        if (opt.timestamp) st.stamped += stamp_trg_lines(buf, monotonic_ns());
+        out.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+        out.flush();
+        if (!out) throw std::runtime_error("write failed: " + path);
+
+        file_bytes += buf.size();
+        st.bytes += buf.size();
+        ++st.writes;
+
+        // 令牌桶：按累计字节数算出下一次写入的时刻，sleep 的误差不会累积
+        if (bytes_per_ns > 0 && st.writes % burst == 0) {
+            const auto due = t0 + std::chrono::nanoseconds(
+                static_cast<int64_t>(static_cast<double>(st.bytes) / bytes_per_ns));
+            std::this_thread::sleep_until(std::min(due, deadline));
+        }
+    }
+
+    st.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    return st;
+}
+
+} // namespace bp
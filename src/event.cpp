@@ -0,0 +1,259 @@
+#include "binparse/event.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace bp {
+
+EventBuilder::EventBuilder(Sink sink, EventBuilderOptions opt)
+    : sink_(std::move(sink))
+    , opt_(opt)
+{
+    opt_.max_open = std::max<std::size_t>(opt_.max_open, 1);
+    // 打开的时间都在 (newest - window - max_lag - 1 - kAdvanceStep, newest] 内，
+    // 环比这段长即不会有两个时间共用一槽
+    const std::size_t span = std::size_t{opt_.window} + opt_.max_lag + 2 + kAdvanceStep;
+    ring_.resize(std::max<std::size_t>(std::bit_ceil(span), 64));
+    mask_ = ring_.size() - 1;
+    occupied_.resize(ring_.size() / 64);
+}
+
+FieldMask EventBuilder::required_fields() noexcept {
+    FieldMask f = FieldMask::none();
+    f.data = field::data::header_vldb_id | field::data::bx_cnt | field::data::ob_cnt | field::data::data_words;
+    f.trg  = field::trg::bx_cnt | field::trg::ob_cnt;
+    return f;
+}
+
+void EventBuilder::observe(int64_t t) {
+    const int64_t lag = static_cast<int64_t>(opt_.window) + opt_.max_lag;
+    if (!started_) {
+        started_ = true;
+        newest_ = t;
+        horizon_ = t - lag - 1;
+        return;
+    }
+    if (t <= newest_) return;
+    // 攒够 kAdvanceStep 个 bx 再收尾一次，不必每来一个更新的时间就扫一遍
+    if (t - lag - 1 >= horizon_ + kAdvanceStep) advance_to(t - lag - 1);
+    newest_ = t;
+}
+
+// [from, end] 中第一个被占用的时间，没有则返回 end + 1。按位图每次跳过 64 个空槽
+int64_t EventBuilder::next_occupied(int64_t from, int64_t end) const noexcept {
+    for (int64_t t = from; t <= end; ) {
+        const std::size_t i = static_cast<std::size_t>(t) & mask_;
+        const uint64_t bits = occupied_[i >> 6] >> (i & 63);
+        if (bits) return std::min(t + std::countr_zero(bits), end + 1);
+        t += static_cast<int64_t>(64 - (i & 63));
+    }
+    return end + 1;
+}
+
+void EventBuilder::advance_to(int64_t horizon) {
+    const int64_t end = std::min(horizon, newest_);
+    for (int64_t t = next_occupied(horizon_ + 1, end); t <= end; t = next_occupied(t + 1, end)) finalize(t);
+    horizon_ = std::max(horizon_, horizon);
+}
+
+void EventBuilder::occupy(Slot& s, int64_t t) noexcept {
+    if (s.t == t) return;
+    s.t = t;
+    const std::size_t i = static_cast<std::size_t>(t) & mask_;
+    occupied_[i >> 6] |= uint64_t{1} << (i & 63);
+}
+
+void EventBuilder::release(Slot& s) noexcept {
+    const std::size_t i = static_cast<std::size_t>(&s - ring_.data());
+    occupied_[i >> 6] &= ~(uint64_t{1} << (i & 63));
+    s = Slot{};
+}
+
+void EventBuilder::finalize(int64_t t) {
+    Slot& s = slot(t);
+    if (s.t != t) return;
+    if (s.event != kNone) emit(s.event, false);
+    if (s.early != kNone) {
+        auto& hits = early_[s.early];
+        stats_.orphan_data += hits.size();
+        early_hits_ -= hits.size();
+        hits.clear();
+        free_early_.push_back(s.early);
+    }
+    release(s);
+}
+
+void EventBuilder::emit(uint32_t ev, bool forced) {
+    Event& e = events_[ev];
+    e.forced = forced;
+    ++stats_.events;
+    stats_.forced += forced;
+    if (sink_) sink_(e);
+
+    e.hits.clear(); // 保留容量
+    e.vldb_mask = {};
+    e.truncated = false;
+    free_events_.push_back(ev);
+    --open_;
+}
+
+uint32_t EventBuilder::alloc_event() {
+    // 事件数到上限：把最早的时间提前收尾
+    while (open_ >= opt_.max_open && horizon_ < newest_) {
+        horizon_ = std::min(next_occupied(horizon_ + 1, newest_), newest_);
+        Slot& s = slot(horizon_);
+        if (s.t == horizon_ && s.event != kNone) {
+            emit(s.event, true);
+            s.event = kNone;
+        }
+        finalize(horizon_);
+    }
+    if (!free_events_.empty()) {
+        const uint32_t ev = free_events_.back();
+        free_events_.pop_back();
+        return ev;
+    }
+    events_.emplace_back();
+    return static_cast<uint32_t>(events_.size() - 1);
+}
+
+uint32_t EventBuilder::alloc_early() {
+    if (!free_early_.empty()) {
+        const uint32_t i = free_early_.back();
+        free_early_.pop_back();
+        return i;
+    }
+    early_.emplace_back();
+    return static_cast<uint32_t>(early_.size() - 1);
+}
+
+void EventBuilder::attach(Event& e, int64_t dbx, uint8_t vldb_id,
+                          std::span<const uint32_t, 6> words, uint64_t offset) {
+    if (e.hits.size() >= opt_.max_hits) {
+        e.truncated = true;
+        ++stats_.dropped_hits;
+        return;
+    }
+    EventHit& x = e.hits.emplace_back();
+    x.offset = offset;
+    std::copy(words.begin(), words.end(), x.words.begin());
+    x.dbx = static_cast<int16_t>(dbx);
+    x.vldb_id = vldb_id;
+    e.vldb_mask[vldb_id >> 6] |= uint64_t{1} << (vldb_id & 63);
+    ++stats_.matched;
+}
+
+void EventBuilder::add_trigger(uint64_t ob_cnt, uint64_t bx_cnt, uint64_t offset) {
+    ++stats_.trg_lines;
+    const uint32_t orbit = static_cast<uint32_t>(ob_cnt);
+    const uint16_t bx = static_cast<uint16_t>(bx_cnt & 0xFFF);
+    const int64_t t = time_of(orbit, bx);
+    observe(t);
+    if (t <= horizon_) {
+        ++stats_.late_trg;
+        return;
+    }
+
+    // 同一 (orbit, bx) 的 TRG 合并为一个事件
+    if (const Slot& s = slot(t); s.t == t && s.event != kNone) {
+        ++events_[s.event].trg_lines;
+        return;
+    }
+
+    const uint32_t ev = alloc_event(); // 可能提前发出更早的事件，horizon_ 随之前移
+    if (t <= horizon_) {
+        free_events_.push_back(ev);
+        ++stats_.late_trg;
+        return;
+    }
+    Slot& s = slot(t);
+    occupy(s, t);
+    s.event = ev;
+    ++open_;
+    stats_.max_open_seen = std::max(stats_.max_open_seen, open_);
+
+    Event& e = events_[ev];
+    e.orbit = orbit;
+    e.bx = bx;
+    e.trg_lines = 1;
+    e.trg_offset = offset;
+
+    // 认领窗口内先到的 Data 行：它们到达时窗口内没有打开的触发
+    const int64_t w = opt_.window;
+    for (int64_t t2 = std::max(t - w, horizon_ + 1); t2 <= t + w; ++t2) {
+        Slot& s2 = slot(t2);
+        if (s2.t != t2 || s2.early == kNone) continue;
+        auto& hits = early_[s2.early];
+        for (const auto& h : hits) attach(e, t2 - t, h.vldb_id, h.words, h.offset);
+        stats_.early_matched += hits.size();
+        early_hits_ -= hits.size();
+        hits.clear();
+        free_early_.push_back(s2.early);
+        s2.early = kNone;
+        if (s2.event == kNone) release(s2);
+    }
+}
+
+void EventBuilder::add_data(uint32_t ob_cnt, uint16_t bx_cnt, uint8_t vldb_id,
+                            std::span<const uint32_t, 6> words, uint64_t offset) {
+    ++stats_.data_lines;
+    const int64_t t = time_of(ob_cnt, bx_cnt & 0xFFF);
+    observe(t);
+
+    // 由近及远找窗口内打开的触发；相同距离取较早的
+    for (int64_t d = 0; d <= opt_.window; ++d) {
+        for (const int64_t te : {t - d, t + d}) {
+            if (te <= horizon_) continue;
+            const Slot& s = slot(te);
+            if (s.t == te && s.event != kNone) return attach(events_[s.event], t - te, vldb_id, words, offset);
+            if (d == 0) break;
+        }
+    }
+
+    if (t <= horizon_) {
+        ++stats_.late_data;
+        return;
+    }
+    if (early_hits_ >= opt_.max_early) {
+        ++stats_.dropped_hits;
+        return;
+    }
+    Slot& s = slot(t);
+    occupy(s, t);
+    if (s.early == kNone) s.early = alloc_early();
+    EventHit& h = early_[s.early].emplace_back();
+    h.offset = offset;
+    std::copy(words.begin(), words.end(), h.words.begin());
+    h.vldb_id = vldb_id;
+    ++early_hits_;
+}
+
+void EventBuilder::add(const LineBatch& b) {
+    const auto& d = b.data;
+    const std::size_t nd = d.size();
+    if (d.header_vldb_id.size() != nd || d.bx_cnt.size() != nd || d.ob_cnt.size() != nd ||
+        d.data_word0.size() != nd || d.data_word1.size() != nd || d.data_word2.size() != nd ||
+        d.data_word3.size() != nd || d.data_word4.size() != nd || d.data_word5.size() != nd ||
+        b.trg.bx_cnt.size() != b.trg.size() || b.trg.ob_cnt.size() != b.trg.size())
+        throw std::invalid_argument("EventBuilder: batch lacks required columns (see required_fields())");
+
+    std::size_t i_data = 0, i_trg = 0;
+    std::array<uint32_t, 6> w;
+    for (const LineType t : b.type) {
+        if (t == LineType::Data) {
+            const std::size_t k = i_data++;
+            w = {d.data_word0[k], d.data_word1[k], d.data_word2[k], d.data_word3[k], d.data_word4[k], d.data_word5[k]};
+            add_data(d.ob_cnt[k], d.bx_cnt[k], d.header_vldb_id[k], w, d.offset[k]);
+        } else if (t == LineType::TRG) {
+            const std::size_t k = i_trg++;
+            add_trigger(b.trg.ob_cnt[k], b.trg.bx_cnt[k], b.trg.offset[k]);
+        }
+    }
+}
+
+void EventBuilder::flush() {
+    if (started_) advance_to(newest_);
+}
+
+} // namespace bp
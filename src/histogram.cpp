@@ -0,0 +1,85 @@
+#include "binparse/histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace bp {
+
+std::size_t LatencyHistogram::bucket_of(uint64_t v) noexcept {
+    constexpr uint64_t kSub = uint64_t{1} << kSubBits;
+    if (v < kSub) return static_cast<std::size_t>(v);
+    const int e = std::bit_width(v) - 1; // >= kSubBits
+    const uint64_t sub = (v >> (e - kSubBits)) & (kSub - 1);
+    return (static_cast<std::size_t>(e - kSubBits + 1) << kSubBits) + static_cast<std::size_t>(sub);
+}
+
+uint64_t LatencyHistogram::bucket_upper(std::size_t idx) noexcept {
+    constexpr std::size_t kSub = std::size_t{1} << kSubBits;
+    if (idx < kSub) return idx;
+    const int e = static_cast<int>(idx >> kSubBits) + kSubBits - 1;
+    const uint64_t sub = idx & (kSub - 1);
+    const uint64_t width = uint64_t{1} << (e - kSubBits);
+    return ((kSub + sub) << (e - kSubBits)) + (width - 1);
+}
+
+void LatencyHistogram::add(uint64_t v) noexcept {
+    ++counts_[bucket_of(v)];
+    ++n_;
+    sum_ += v;
+    min_ = std::min(min_, v);
+    max_ = std::max(max_, v);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& o) noexcept {
+    for (std::size_t i = 0; i < kBuckets; ++i) counts_[i] += o.counts_[i];
+    n_ += o.n_;
+    sum_ += o.sum_;
+    min_ = std::min(min_, o.min_);
+    max_ = std::max(max_, o.max_);
+}
+
+uint64_t LatencyHistogram::percentile(double q) const noexcept {
+    if (n_ == 0) return 0;
+    q = std::clamp(q, 0.0, 1.0);
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(n_))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) return std::min(bucket_upper(i), max_);
+    }
+    return max_;
+}
+
+void AtomicLatencyHistogram::record(uint64_t v) noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    counts_[LatencyHistogram::bucket_of(v)].fetch_add(1, relaxed);
+    n_.fetch_add(1, relaxed);
+    sum_.fetch_add(v, relaxed);
+    uint64_t lo = min_.load(relaxed);
+    while (v < lo && !min_.compare_exchange_weak(lo, v, relaxed)) {}
+    uint64_t hi = max_.load(relaxed);
+    while (v > hi && !max_.compare_exchange_weak(hi, v, relaxed)) {}
+}
+
+LatencyHistogram AtomicLatencyHistogram::snapshot() const noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    LatencyHistogram h;
+    for (std::size_t i = 0; i < LatencyHistogram::kBuckets; ++i) h.counts_[i] = counts_[i].load(relaxed);
+    h.n_   = n_.load(relaxed);
+    h.sum_ = sum_.load(relaxed);
+    h.min_ = min_.load(relaxed);
+    h.max_ = max_.load(relaxed);
+    return h;
+}
+
+void AtomicLatencyHistogram::reset() noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (auto& c : counts_) c.store(0, relaxed);
+    n_.store(0, relaxed);
+    sum_.store(0, relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), relaxed);
+    max_.store(0, relaxed);
+}
+
+} // namespace bp
@@ -0,0 +1,183 @@
+#include "binparse/index.hpp"
+#include "binparse/bytecursor.hpp"
+#include "binparse/mapped_file.hpp"
+#include "binparse/parallel.hpp"
+#include "binparse/parser.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace bp {
+namespace {
+    constexpr char        kMagic[8] = {'B', 'P', 'X', 'I', 'D', 'X', '0', '1'};
+    constexpr std::size_t kHeaderSize = 32;
+
+    // 收集一段数据中所有 RDH_L0 的位置（文件顺序）
+    struct CollectHandler {
+        const std::byte*         base;
+        std::vector<IndexEntry>* out;
+
+        void on_rdh_l0(const RDH_L0& r, std::span<const std::byte> line) {
+            IndexEntry e{};
+            e.orbit   = r.orbit;
+            e.bc      = r.bc;
+            e.cru_id  = r.cru_id;
+            e.fee_id  = r.fee_id;
+            e.link_id = r.link_id;
+            e.size    = r.offset_new_packet;
+            e.offset  = static_cast<uint64_t>(line.data() - base);
+            out->push_back(e);
+        }
+    };
+
+    // 数据开头至多 kFingerprintBytes 字节的 FNV-1a；0 留给“未记录”（旧索引）
+    constexpr std::size_t kFingerprintBytes = 4096;
+    uint32_t fingerprint_of(std::span<const std::byte> data) noexcept {
+        uint32_t h = 2166136261u;
+        for (const std::byte b : data.first(std::min(data.size(), kFingerprintBytes)))
+            h = (h ^ std::to_integer<uint32_t>(b)) * 16777619u;
+        return h ? h : 1;
+    }
+
+    bool entry_less(const IndexEntry& a, const IndexEntry& b) {
+        return std::tie(a.orbit, a.bc, a.offset) < std::tie(b.orbit, b.bc, b.offset);
+    }
+}
+
+RdhIndex RdhIndex::build(std::span<const std::byte> data, unsigned nthreads) {
+    RdhIndex idx;
+    idx.data_size_ = data.size();
+    idx.fingerprint_ = fingerprint_of(data);
+
+    const auto shards = plan_shards(data, std::size_t{std::max(1u, nthreads)} * kShardsPerThread);
+    std::vector<std::vector<IndexEntry>> parts(shards.size());
+    run_shards_parallel(data, shards, nthreads,
+        [&](std::size_t i, std::span<const std::byte> bytes) {
+            BasicStreamParser<CollectHandler> parser(CollectHandler{data.data(), &parts[i]});
+            parser.feed(bytes);
+        });
+
+    for (auto& p : parts) idx.entries_.insert(idx.entries_.end(), p.begin(), p.end());
+
+    // 此时仍是文件顺序：offset_new_packet 不可信（为 0 或越过下一个 RDH）时，用实际距离
+    auto& es = idx.entries_;
+    for (std::size_t i = 0; i < es.size(); ++i) {
+        const uint64_t next = (i + 1 < es.size()) ? es[i + 1].offset : data.size();
+        if (es[i].size == 0 || es[i].offset + es[i].size > next)
+            es[i].size = static_cast<uint32_t>(next - es[i].offset);
+    }
+
+    std::stable_sort(es.begin(), es.end(), entry_less);
+    return idx;
+}
+
+RdhIndex RdhIndex::build_file(const std::string& data_path, unsigned nthreads) {
+    MappedFile file(data_path);
+    file.advise(MappedFile::Advice::Sequential);
+    return build(file.bytes(), nthreads);
+}
+
+void RdhIndex::save(const std::string& idx_path) const {
+    static_assert(std::endian::native == std::endian::little, "sidecar index is written in host (little-endian) layout");
+
+    std::ofstream out(idx_path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("open failed: " + idx_path);
+
+    char hdr[kHeaderSize] = {};
+    const uint32_t entry_size = sizeof(IndexEntry);
+    const uint64_t count = entries_.size();
+    std::memcpy(hdr, kMagic, sizeof(kMagic));
+    std::memcpy(hdr + 8, &entry_size, 4);
+    std::memcpy(hdr + 12, &fingerprint_, 4);
+    std::memcpy(hdr + 16, &count, 8);
+    std::memcpy(hdr + 24, &data_size_, 8);
+    out.write(hdr, kHeaderSize);
+    out.write(reinterpret_cast<const char*>(entries_.data()),
+              static_cast<std::streamsize>(entries_.size() * sizeof(IndexEntry)));
+    if (!out) throw std::runtime_error("write failed: " + idx_path);
+}
+
+RdhIndex RdhIndex::load(const std::string& idx_path) {
+    std::ifstream in(idx_path, std::ios::binary);
+    if (!in) throw std::runtime_error("open failed: " + idx_path);
+
+    char hdr[kHeaderSize] = {};
+    in.read(hdr, kHeaderSize);
+    if (!in || std::memcmp(hdr, kMagic, sizeof(kMagic)) != 0)
+        throw ParseError{"not a bpx index: " + idx_path};
+
+    uint32_t entry_size = 0;
+    uint64_t count = 0;
+    RdhIndex idx;
+    std::memcpy(&entry_size, hdr + 8, 4);
+    std::memcpy(&idx.fingerprint_, hdr + 12, 4);
+    std::memcpy(&count, hdr + 16, 8);
+    std::memcpy(&idx.data_size_, hdr + 24, 8);
+    if (entry_size != sizeof(IndexEntry))
+        throw ParseError{"unsupported index entry size", 8, sizeof(IndexEntry), entry_size};
+
+    idx.entries_.resize(static_cast<std::size_t>(count));
+    in.read(reinterpret_cast<char*>(idx.entries_.data()),
+            static_cast<std::streamsize>(count * sizeof(IndexEntry)));
+    if (static_cast<uint64_t>(in.gcount()) != count * sizeof(IndexEntry))
+        throw ParseError{"truncated index", kHeaderSize, static_cast<std::size_t>(count * sizeof(IndexEntry)),
+                         static_cast<std::size_t>(in.gcount())};
+    return idx;
+}
+
+RdhIndex RdhIndex::load(const std::string& idx_path, const std::string& data_path) {
+    RdhIndex idx = load(idx_path);
+
+    std::ifstream in(data_path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("open failed: " + data_path);
+    const auto size = static_cast<uint64_t>(in.tellg());
+    if (size < idx.data_size_)
+        throw ParseError{"stale index (data file shrank): " + idx_path, 0, static_cast<std::size_t>(idx.data_size_),
+                         static_cast<std::size_t>(size)};
+
+    if (idx.fingerprint_ != 0) {
+        std::vector<std::byte> head(static_cast<std::size_t>(std::min<uint64_t>(idx.data_size_, kFingerprintBytes)));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(head.data()), static_cast<std::streamsize>(head.size()));
+        if (!in || fingerprint_of(head) != idx.fingerprint_)
+            throw ParseError{"stale index (data file was rewritten): " + idx_path};
+    }
+    return idx;
+}
+
+std::span<const IndexEntry> RdhIndex::orbit_window(uint32_t orbit_lo, uint32_t orbit_hi) const {
+    auto lo = std::lower_bound(entries_.begin(), entries_.end(), orbit_lo,
+                               [](const IndexEntry& e, uint32_t o) { return e.orbit < o; });
+    auto hi = std::upper_bound(lo, entries_.end(), orbit_hi,
+                               [](uint32_t o, const IndexEntry& e) { return o < e.orbit; });
+    return {lo, hi};
+}
+
+std::vector<ByteRange> RdhIndex::query(const IndexQuery& q) const {
+    std::vector<ByteRange> out;
+    if (q.orbit_lo > q.orbit_hi) return out;
+
+    for (const auto& e : orbit_window(q.orbit_lo, q.orbit_hi)) {
+        if (q.cru_id  && e.cru_id  != *q.cru_id)  continue;
+        if (q.link_id && e.link_id != *q.link_id) continue;
+        if (q.fee_id  && e.fee_id  != *q.fee_id)  continue;
+        out.push_back(ByteRange{e.offset, e.offset + e.size});
+    }
+
+    std::sort(out.begin(), out.end(), [](const ByteRange& a, const ByteRange& b) { return a.begin < b.begin; });
+    std::size_t w = 0;
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        if (w > 0 && out[i].begin <= out[w - 1].end)
+            out[w - 1].end = std::max(out[w - 1].end, out[i].end);
+        else
+            out[w++] = out[i];
+    }
+    out.resize(w);
+    return out;
+}
+
+} // namespace bp
@@ -0,0 +1,177 @@
+#include "binparse/integrity.hpp"
+
+#include <stdexcept>
+
+namespace bp {
+
+const char* to_string(AnomalyKind k) noexcept {
+    switch (k) {
+    case AnomalyKind::PacketCounterGap:  return "packet_counter_gap";
+    case AnomalyKind::HbCounterGap:      return "hb_packet_counter_gap";
+    case AnomalyKind::OrbitRegress:      return "orbit_regress";
+    case AnomalyKind::BcRegress:         return "bc_regress";
+    case AnomalyKind::MissingRdhL1:      return "missing_rdh_l1";
+    case AnomalyKind::TrgDataBxMismatch: return "trg_data_bx_mismatch";
+    case AnomalyKind::TrgDataObMismatch: return "trg_data_ob_mismatch";
+    }
+    return "unknown";
+}
+
+FieldMask IntegrityChecker::required_fields() noexcept {
+    FieldMask f = FieldMask::none();
+    f.data   = field::data::bx_cnt | field::data::ob_cnt;
+    f.trg    = field::trg::bx_cnt | field::trg::ob_cnt;
+    f.rdh_l0 = field::rdh_l0::fee_id | field::rdh_l0::link_id | field::rdh_l0::cru_id |
+               field::rdh_l0::packet_counter | field::rdh_l0::bc | field::rdh_l0::orbit;
+    f.rdh_l1 = field::rdh_l1::hb_packet_counter | field::rdh_l1::stop_bit;
+    return f;
+}
+
+void IntegrityChecker::reset() {
+    links_.clear();
+    cur_ = nullptr;
+    pending_l1_ = false;
+    stats_ = {};
+}
+
+void IntegrityChecker::emit(std::vector<Anomaly>& out, AnomalyKind kind, uint64_t offset,
+                            uint32_t expected, uint32_t got, uint32_t count) {
+    out.push_back(Anomaly{offset, expected, got, count, cur_ ? cur_->key : LinkKey{}, kind});
+    ++stats_.anomalies[static_cast<std::size_t>(kind)];
+}
+
+void IntegrityChecker::on_rdh_l0(const LineBatch& b, std::size_t k, std::vector<Anomaly>& out) {
+    const auto& c = b.rdh_l0;
+    const LinkKey key{c.cru_id[k], c.link_id[k], c.fee_id[k]};
+    const uint64_t off = c.offset[k];
+    ++stats_.packets;
+
+    auto [it, fresh] = links_.try_emplace(key);
+    cur_ = &it->second;
+    auto& L = *cur_;
+    const uint8_t  pc    = c.packet_counter[k];
+    const uint32_t orbit = c.orbit[k];
+    const uint16_t bc    = c.bc[k];
+
+    if (fresh) {
+        L.key = key;
+        L.new_orbit = true;
+    } else {
+        const auto want = static_cast<uint8_t>(L.packet_counter + 1);
+        if (pc != want) emit(out, AnomalyKind::PacketCounterGap, off, want, pc, static_cast<uint8_t>(pc - want));
+        if (orbit < L.orbit)                    emit(out, AnomalyKind::OrbitRegress, off, L.orbit, orbit);
+        else if (orbit == L.orbit && bc < L.bc) emit(out, AnomalyKind::BcRegress, off, L.bc, bc);
+        L.new_orbit = orbit != L.orbit;
+    }
+    L.packet_counter = pc;
+    L.orbit = orbit;
+    L.bc = bc;
+
+    pending_l1_ = true;
+    pending_l1_offset_ = off;
+}
+
+void IntegrityChecker::on_rdh_l1(const LineBatch& b, std::size_t k, std::vector<Anomaly>& out) {
+    pending_l1_ = false;
+    if (!cur_) return;
+    auto& L = *cur_;
+    const uint16_t hb = b.rdh_l1.hb_packet_counter[k];
+    const uint16_t want = (L.stop || L.new_orbit) ? 0 : static_cast<uint16_t>(L.hb_packet_counter + 1);
+    if (hb != want) emit(out, AnomalyKind::HbCounterGap, b.rdh_l1.offset[k], want, hb);
+    L.hb_packet_counter = hb;
+    L.stop = b.rdh_l1.stop_bit[k] != 0;
+    L.new_orbit = false;
+}
+
+void IntegrityChecker::check_data_run(const LineBatch& b, std::size_t k0, std::size_t n,
+                                      std::vector<Anomaly>& out) {
+    if (!cur_ || !cur_->has_trg) return;
+    stats_.data_lines += n;
+
+    const uint16_t bx = cur_->trg_bx;
+    const uint32_t ob = cur_->trg_ob;
+    const uint16_t* dbx = b.data.bx_cnt.data() + k0;
+    const uint32_t* dob = b.data.ob_cnt.data() + k0;
+
+    // 整段比较计数，无分支
+    uint32_t bad_bx = 0, bad_ob = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+        bad_bx += dbx[k] != bx;
+        bad_ob += dob[k] != ob;
+    }
+    if (bad_bx == 0 && bad_ob == 0) return;
+
+    // 只为第一条不一致的行记录偏移与取值，count 是整段的不一致行数
+    if (bad_bx) {
+        std::size_t k = 0;
+        while (dbx[k] == bx) ++k;
+        emit(out, AnomalyKind::TrgDataBxMismatch, b.data.offset[k0 + k], bx, dbx[k], bad_bx);
+    }
+    if (bad_ob) {
+        std::size_t k = 0;
+        while (dob[k] == ob) ++k;
+        emit(out, AnomalyKind::TrgDataObMismatch, b.data.offset[k0 + k], ob, dob[k], bad_ob);
+    }
+}
+
+std::size_t IntegrityChecker::check(const LineBatch& b, std::vector<Anomaly>& out) {
+    const auto& l0 = b.rdh_l0;
+    const auto& l1 = b.rdh_l1;
+    if (l0.cru_id.size() != l0.size() || l0.link_id.size() != l0.size() || l0.fee_id.size() != l0.size() ||
+        l0.packet_counter.size() != l0.size() || l0.orbit.size() != l0.size() || l0.bc.size() != l0.size() ||
+        l1.hb_packet_counter.size() != l1.size() || l1.stop_bit.size() != l1.size() ||
+        b.trg.bx_cnt.size() != b.trg.size() || b.trg.ob_cnt.size() != b.trg.size() ||
+        b.data.bx_cnt.size() != b.data.size() || b.data.ob_cnt.size() != b.data.size())
+        throw std::invalid_argument("IntegrityChecker: batch lacks required columns (see required_fields())");
+
+    const std::size_t before = out.size();
+    const auto& T = b.type;
+    std::size_t i_l0 = 0, i_l1 = 0, i_data = 0, i_trg = 0;
+
+    for (std::size_t i = 0; i < T.size(); ) {
+        const LineType t = T[i];
+        std::size_t j = i + 1;
+        while (j < T.size() && T[j] == t) ++j;
+        const std::size_t n = j - i;
+
+        if (pending_l1_ && t != LineType::RDH_L1) {
+            pending_l1_ = false;
+            emit(out, AnomalyKind::MissingRdhL1, pending_l1_offset_, 0, 0);
+        }
+
+        switch (t) {
+        case LineType::RDH_L0:
+            for (std::size_t k = i_l0; k < i_l0 + n; ++k) {
+                if (pending_l1_) emit(out, AnomalyKind::MissingRdhL1, pending_l1_offset_, 0, 0);
+                on_rdh_l0(b, k, out);
+            }
+            i_l0 += n;
+            break;
+        case LineType::RDH_L1:
+            // 连续多行 RDH_L1 时只有第一行是页头
+            on_rdh_l1(b, i_l1, out);
+            i_l1 += n;
+            break;
+        case LineType::TRG:
+            stats_.trg_lines += n;
+            // 连续的 TRG 只有最后一个对后面的 Data 生效
+            if (cur_) {
+                cur_->has_trg = true;
+                cur_->trg_bx = static_cast<uint16_t>(b.trg.bx_cnt[i_trg + n - 1] & 0xFFF);
+                cur_->trg_ob = static_cast<uint32_t>(b.trg.ob_cnt[i_trg + n - 1]);
+            }
+            i_trg += n;
+            break;
+        case LineType::Data:
+            check_data_run(b, i_data, n, out);
+            i_data += n;
+            break;
+        default:
+            break;
+        }
+        i = j;
+    }
+    return out.size() - before;
+}
+
+} // namespace bp
@@ -0,0 +1,328 @@
+#include "binparse/bounded_queue.hpp"
+#include "binparse/chunk_pool.hpp"
+#include "binparse/parser.hpp"
+#include "binparse/synth.hpp"
+#include "binparse/tail.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void usage() {
+    std::cerr << "Usage: bpx_bench [--size MiB] [--reps N] [--seed N] [--filter SUBSTR]\n"
+              << "                 [--tmpdir DIR] [--json FILE|-]\n";
+}
+
+struct Mix {
+    const char*       name;
+    bp::SynthOptions  opt;
+};
+
+std::vector<Mix> mixes(uint64_t seed) {
+    bp::SynthOptions base;
+    base.seed = seed;
+
+    Mix def{"default", base};
+    Mix data{"data_heavy", base};
+    data.opt.triggers_per_orbit = 4;
+    data.opt.data_per_trigger = 60;
+    Mix rdh{"rdh_heavy", base};
+    rdh.opt.triggers_per_orbit = 2;
+    rdh.opt.data_per_trigger = 2;
+    rdh.opt.page_lines = 4;
+    Mix trg{"trg_heavy", base};
+    trg.opt.triggers_per_orbit = 64;
+    trg.opt.data_per_trigger = 1;
+    Mix padded{"padded_8k", base};
+    padded.opt.page_align = 8192;
+    return {def, data, rdh, trg, padded};
+}
+
+struct Result {
+    std::string bench;
+    std::string mix;
+    std::size_t chunk = 0;
+    std::size_t bytes = 0;
+    std::size_t lines = 0;
+    double      seconds = 0;
+};
+
+// 计数 handler：只碰行类型，测的是分类 + 分派的开销
+struct CountingHandler {
+    std::size_t n = 0;
+    void on_rdh_l0(bp::RdhL0View) { ++n; }
+    void on_rdh_l1(bp::RdhL1View) { ++n; }
+    void on_data_line(bp::DataLineView) { ++n; }
+    void on_trg_line(bp::TrgLineView) { ++n; }
+    void on_packet(const bp::Packet&) { ++n; }
+};
+
+// 读两三个字段的 handler，接近监控任务
+struct FieldsHandler {
+    uint64_t acc = 0;
+    void on_rdh_l0(bp::RdhL0View v) { acc += v.orbit() + v.bc(); }
+    void on_data_line(bp::DataLineView v) { acc += v.bx_cnt(); }
+    void on_trg_line(bp::TrgLineView v) { acc += v.bx_cnt(); }
+};
+
+template <class T>
+void do_not_optimize(const T& v) {
+    asm volatile("" : : "g"(&v) : "memory");
+}
+
+// 按 chunk 切片喂给 f
+template <class F>
+void feed_chunks(std::span<const std::byte> buf, std::size_t chunk, F&& f) {
+    for (std::size_t off = 0; off < buf.size(); off += chunk)
+        f(buf.subspan(off, std::min(chunk, buf.size() - off)));
+}
+
+class Runner {
+public:
+    // 表格写到 table；--json - 时 stdout 只留给 JSON
+    Runner(int reps, std::string filter, std::FILE* table)
+        : reps_(reps), filter_(std::move(filter)), table_(table) {}
+
+    // 取 reps 次中最快的一次
+    template <class F>
+    void run(std::string bench, const std::string& mix, std::size_t chunk,
+             std::span<const std::byte> buf, F&& f) {
+        const std::string id = bench + "/" + mix + "/" + std::to_string(chunk);
+        if (!filter_.empty() && id.find(filter_) == std::string::npos) return;
+
+        double best = 1e30;
+        for (int r = 0; r < reps_; ++r) {
+            const auto t0 = Clock::now();
+            f();
+            best = std::min(best, std::chrono::duration<double>(Clock::now() - t0).count());
+        }
+        Result res{std::move(bench), mix, chunk, buf.size(), buf.size() / bp::ByteCursor::kLineSize, best};
+        print(res);
+        results_.push_back(std::move(res));
+    }
+
+    const std::vector<Result>& results() const noexcept { return results_; }
+
+private:
+    void print(const Result& r) const {
+        std::fprintf(table_, "%-22s %-11s %9zu  %8.3f GB/s  %7.2f ns/line\n",
+                     r.bench.c_str(), r.mix.c_str(), r.chunk,
+                     r.bytes / r.seconds / 1e9, r.seconds * 1e9 / std::max<std::size_t>(r.lines, 1));
+        std::fflush(table_);
+    }
+
+    int                 reps_;
+    std::string         filter_;
+    std::FILE*          table_;
+    std::vector<Result> results_;
+};
+
+void write_json(std::ostream& os, const std::vector<Result>& rs, std::size_t size) {
+    os << "{\n  \"machine\": {\"isa\": \"" << bp::classify_isa() << "\", \"threads\": "
+       << std::thread::hardware_concurrency() << ", \"compiler\": \"" << __VERSION__ << "\"},\n"
+       << "  \"bytes\": " << size << ",\n  \"results\": [\n";
+    for (std::size_t i = 0; i < rs.size(); ++i) {
+        const auto& r = rs[i];
+        char buf[512];
+        std::snprintf(buf, sizeof(buf),
+                      "    {\"bench\": \"%s\", \"mix\": \"%s\", \"chunk\": %zu, \"bytes\": %zu, \"lines\": %zu, "
+                      "\"seconds\": %.6f, \"gbps\": %.4f, \"ns_per_line\": %.3f}%s\n",
+                      r.bench.c_str(), r.mix.c_str(), r.chunk, r.bytes, r.lines, r.seconds,
+                      r.bytes / r.seconds / 1e9, r.seconds * 1e9 / std::max<std::size_t>(r.lines, 1),
+                      i + 1 < rs.size() ? "," : "");
+        os << buf;
+    }
+    os << "  ]\n}\n";
+}
+
+// 文件已写好，tail 读完全部字节即停（不等 inactivity 超时）。
+// 停止要等读线程当前的等待结束，poll_ms=1 让这段收尾时间不计入吞吐
+void bench_tail(Runner& R, const std::string& mix, const std::filesystem::path& file,
+                std::span<const std::byte> buf, std::size_t chunk, const char* name,
+                bp::TailOptions opt) {
+    opt.read_chunk = chunk;
+    opt.poll_ms = 1;
+    opt.inactivity_timeout_ms = 2000;
+    R.run(name, mix, chunk, buf, [&] {
+        std::atomic<bool> stop{false};
+        opt.stop = &stop;
+        bp::BasicStreamParser<CountingHandler> p;
+        std::size_t seen = 0;
+        bp::tail_growing_file(file.string(), opt, [&](std::span<const std::byte> b) {
+            p.feed(b);
+            seen += b.size();
+            if (seen >= buf.size()) stop.store(true);
+        });
+        do_not_optimize(p.handler().n);
+    });
+}
+
+// 租约模式的两级流水线：读线程把池中的块直接交给解析线程，不拷贝
+void bench_tail_lease(Runner& R, const std::string& mix, const std::filesystem::path& file,
+                      std::span<const std::byte> buf, std::size_t chunk) {
+    bp::TailOptions opt;
+    opt.read_chunk = chunk;
+    opt.poll_ms = 1;
+    opt.inactivity_timeout_ms = 2000;
+    R.run("tail_lease", mix, chunk, buf, [&] {
+        std::atomic<bool> stop{false};
+        opt.stop = &stop;
+        bp::ChunkPool pool(4, chunk);
+        bp::BoundedQueue<bp::ChunkLease> q(pool.chunks());
+        bp::BasicStreamParser<CountingHandler> p;
+        std::thread parse([&] {
+            bp::ChunkLease l;
+            while (q.pop(l)) {
+                p.feed(l.bytes());
+                l.reset();
+            }
+        });
+        std::size_t seen = 0;
+        bp::tail_growing_file(file.string(), opt, pool, [&](bp::ChunkLease l) {
+            seen += l.size();
+            q.push(std::move(l));
+            if (seen >= buf.size()) stop.store(true);
+        });
+        q.close();
+        parse.join();
+        do_not_optimize(p.handler().n);
+    });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t size_mib = 64;
+    int reps = 3;
+    uint64_t seed = 1;
+    std::string filter, json;
+    std::filesystem::path tmpdir = std::filesystem::temp_directory_path();
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view a = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(a) + " needs a value");
+                return argv[++i];
+            };
+            if (a == "--size")        size_mib = std::stoul(next());
+            else if (a == "--reps")   reps = std::max(1, std::stoi(next()));
+            else if (a == "--seed")   seed = std::stoull(next());
+            else if (a == "--filter") filter = next();
+            else if (a == "--tmpdir") tmpdir = next();
+            else if (a == "--json")   json = next();
+            else { usage(); return 1; }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "bpx_bench: " << e.what() << "\n";
+        usage();
+        return 1;
+    }
+
+    const std::size_t size = size_mib << 20;
+    const std::size_t chunks[] = {4u << 10, 64u << 10, 1u << 20, 16u << 20};
+    std::FILE* table = json == "-" ? stderr : stdout;
+    Runner R(reps, filter, table);
+
+    std::fprintf(table, "isa=%s size=%zu MiB reps=%d\n", bp::classify_isa(), size_mib, reps);
+    std::fprintf(table, "%-22s %-11s %9s  %13s  %15s\n", "bench", "mix", "chunk", "throughput", "per line");
+
+    for (const auto& m : mixes(seed)) {
+        bp::SynthStream gen(m.opt);
+        const std::vector<std::byte> data = gen.generate(size);
+        const std::span<const std::byte> buf(data);
+
+        R.run("classify_lines", m.name, buf.size(), buf, [&] {
+            std::vector<bp::LineType> types(buf.size() / bp::ByteCursor::kLineSize);
+            bp::classify_lines(buf, types.data());
+            do_not_optimize(types.back());
+        });
+
+        for (const std::size_t chunk : chunks) {
+            R.run("stream_parser", m.name, chunk, buf, [&] {
+                std::size_t n = 0;
+                bp::StreamParser p(
+                    [&](const bp::Packet&) { ++n; }, {}, {},
+                    [&](const bp::RDH_L0&, std::span<const std::byte>) { ++n; },
+                    [&](const bp::RDH_L1&, std::span<const std::byte>) { ++n; },
+                    [&](const bp::DataLine&, std::span<const std::byte>) { ++n; },
+                    [&](const bp::TrgLine&, std::span<const std::byte>) { ++n; });
+                feed_chunks(buf, chunk, [&](auto c) { p.feed(c); });
+                do_not_optimize(n);
+            });
+            R.run("basic_parser_count", m.name, chunk, buf, [&] {
+                bp::BasicStreamParser<CountingHandler> p;
+                feed_chunks(buf, chunk, [&](auto c) { p.feed(c); });
+                do_not_optimize(p.handler().n);
+            });
+            R.run("basic_parser_fields", m.name, chunk, buf, [&] {
+                bp::BasicStreamParser<FieldsHandler> p;
+                feed_chunks(buf, chunk, [&](auto c) { p.feed(c); });
+                do_not_optimize(p.handler().acc);
+            });
+            R.run("basic_parser_packets", m.name, chunk, buf, [&] {
+                bp::BasicStreamParser<FieldsHandler> p;
+                p.set_framing(bp::Framing::Packets);
+                feed_chunks(buf, chunk, [&](auto c) { p.feed(c); });
+                do_not_optimize(p.handler().acc);
+            });
+            R.run("decode_batch", m.name, chunk, buf, [&] {
+                bp::BatchDecoder d;
+                feed_chunks(buf, chunk, [&](auto c) { d.decode_batch(c); });
+                do_not_optimize(d.next_offset());
+            });
+            bp::FieldMask proj = bp::FieldMask::none();
+            proj.rdh_l0 = bp::field::rdh_l0::orbit | bp::field::rdh_l0::bc;
+            proj.data = bp::field::data::bx_cnt;
+            R.run("decode_batch_2fields", m.name, chunk, buf, [&] {
+                bp::BatchDecoder d(0, proj);
+                feed_chunks(buf, chunk, [&](auto c) { d.decode_batch(c); });
+                do_not_optimize(d.next_offset());
+            });
+        }
+
+        // tail：先把流写进临时文件，再从头 tail 到末尾
+        if (filter.empty() || filter.find("tail") != std::string::npos) {
+            const auto file = tmpdir / ("bpx_bench_" + std::string(m.name) + ".bin");
+            {
+                std::ofstream out(file, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            }
+            for (const std::size_t chunk : chunks) {
+                bp::TailOptions opt;
+                bench_tail(R, m.name, file, buf, chunk, "tail_pread", opt);
+                opt.read_ahead = 4;
+                bench_tail(R, m.name, file, buf, chunk, "tail_read_ahead", opt);
+                opt.read_ahead = 0;
+                opt.use_mmap = true;
+                bench_tail(R, m.name, file, buf, chunk, "tail_mmap", opt);
+                bench_tail_lease(R, m.name, file, buf, chunk);
+            }
+            std::error_code ec;
+            std::filesystem::remove(file, ec);
+        }
+    }
+
+    if (!json.empty()) {
+        if (json == "-") {
+            write_json(std::cout, R.results(), size);
+        } else {
+            std::ofstream out(json);
+            write_json(out, R.results(), size);
+            std::cerr << "wrote " << json << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "binparse/integrity.hpp"
+#include "binparse/mapped_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage: bpx_check <data> [--max N] [--chunk MiB]\n"
+              << "Exit status: 0 clean, 2 anomalies found, 1 error\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    const std::string path = argv[1];
+    std::size_t max_print = 100;
+    std::size_t chunk = 4u << 20;
+
+    try {
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view a = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(a) + " needs a value");
+                return argv[++i];
+            };
+            if (a == "--max")        max_print = std::stoul(next());
+            else if (a == "--chunk") chunk = std::max<std::size_t>(std::stoul(next()), 1) << 20;
+            else { usage(); return 1; }
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        bp::MappedFile file(path);
+        file.advise(bp::MappedFile::Advice::Sequential);
+        const auto bytes = file.bytes();
+
+        bp::BatchDecoder dec(0, bp::IntegrityChecker::required_fields());
+        bp::IntegrityChecker checker;
+        std::vector<bp::Anomaly> found;
+        std::size_t printed = 0;
+
+        for (std::size_t off = 0; off < bytes.size(); off += chunk) {
+            const auto& batch = dec.decode_batch(bytes.subspan(off, std::min(chunk, bytes.size() - off)));
+            found.clear();
+            checker.check(batch, found);
+            for (const auto& a : found) {
+                if (printed++ >= max_print) break;
+                std::printf("%12llu  %-22s cru=%u link=%u fee=0x%x  expected=%u got=%u count=%u\n",
+                            static_cast<unsigned long long>(a.offset), bp::to_string(a.kind),
+                            a.link.cru_id, a.link.link_id, a.link.fee_id, a.expected, a.got, a.count);
+            }
+        }
+
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        const auto& st = checker.stats();
+        std::cout << "\n=== Integrity summary ===\n"
+                  << "Bytes checked      : " << bytes.size() << "\n"
+                  << "Links              : " << checker.links() << "\n"
+                  << "Packets            : " << st.packets << "\n"
+                  << "TRG lines          : " << st.trg_lines << "\n"
+                  << "Data lines matched : " << st.data_lines << "\n";
+        for (std::size_t k = 0; k < bp::kAnomalyKinds; ++k)
+            if (st.anomalies[k])
+                std::cout << "  " << bp::to_string(static_cast<bp::AnomalyKind>(k)) << ": " << st.anomalies[k] << "\n";
+        std::cout << "Anomalies          : " << st.total_anomalies() << "\n"
+                  << "Elapsed time       : " << static_cast<long long>(secs * 1e3) << " ms ("
+                  << bytes.size() / std::max(secs, 1e-9) / 1e9 << " GB/s)\n"
+                  << "=========================\n";
+        return st.total_anomalies() ? 2 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bpx_check: " << e.what() << "\n";
+        return 1;
+    }
+}
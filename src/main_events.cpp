@@ -0,0 +1,93 @@
+#include "binparse/event.hpp"
+#include "binparse/mapped_file.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage: bpx_events <data> [--window BX] [--lag BX] [--max-open N] [--print N] [--chunk MiB]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    const std::string path = argv[1];
+    bp::EventBuilderOptions opt;
+    std::size_t max_print = 0;
+    std::size_t chunk = 4u << 20;
+
+    try {
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view a = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(a) + " needs a value");
+                return argv[++i];
+            };
+            if (a == "--window")        opt.window = static_cast<uint16_t>(std::stoul(next()));
+            else if (a == "--lag")      opt.max_lag = static_cast<uint32_t>(std::stoul(next()));
+            else if (a == "--max-open") opt.max_open = std::stoul(next());
+            else if (a == "--print")    max_print = std::stoul(next());
+            else if (a == "--chunk")    chunk = std::max<std::size_t>(std::stoul(next()), 1) << 20;
+            else { usage(); return 1; }
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        bp::MappedFile file(path);
+        file.advise(bp::MappedFile::Advice::Sequential);
+        const auto bytes = file.bytes();
+
+        // 每个事件的 Data 行数分布：0, 1, 2-3, 4-7, ...
+        uint64_t size_hist[18] = {};
+        std::size_t printed = 0;
+        bp::EventBuilder builder([&](const bp::Event& e) {
+            ++size_hist[std::min<std::size_t>(std::bit_width(e.hits.size()), 17)];
+            if (printed++ >= max_print) return;
+            std::size_t vldbs = 0;
+            for (auto m : e.vldb_mask) vldbs += std::popcount(m);
+            std::printf("%12llu  orbit=%u bx=%4u  trg=%u hits=%zu vldbs=%zu%s%s\n",
+                        static_cast<unsigned long long>(e.trg_offset), e.orbit, e.bx, e.trg_lines,
+                        e.hits.size(), vldbs, e.forced ? " forced" : "", e.truncated ? " truncated" : "");
+        }, opt);
+
+        bp::BatchDecoder dec(0, bp::EventBuilder::required_fields());
+        for (std::size_t off = 0; off < bytes.size(); off += chunk)
+            builder.add(dec.decode_batch(bytes.subspan(off, std::min(chunk, bytes.size() - off))));
+        builder.flush();
+
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        const auto& st = builder.stats();
+        std::cout << "\n=== Event building summary ===\n"
+                  << "Window / lag (bx)  : " << opt.window << " / " << opt.max_lag << "\n"
+                  << "TRG lines          : " << st.trg_lines << "\n"
+                  << "Events             : " << st.events << " (forced " << st.forced << ", max open "
+                  << st.max_open_seen << ")\n"
+                  << "Data lines         : " << st.data_lines << "\n"
+                  << "  matched          : " << st.matched << " (arrived before TRG: " << st.early_matched << ")\n"
+                  << "  orphan / late    : " << st.orphan_data << " / " << st.late_data << "\n"
+                  << "  dropped          : " << st.dropped_hits << "\n"
+                  << "Late TRG lines     : " << st.late_trg << "\n"
+                  << "Hits per event     :";
+        for (std::size_t k = 0; k < 18; ++k)
+            if (size_hist[k])
+                std::cout << " [" << (k ? (1ull << (k - 1)) : 0) << "," << (1ull << k) << "):" << size_hist[k];
+        std::cout << "\nElapsed time       : " << static_cast<long long>(secs * 1e3) << " ms ("
+                  << st.events / std::max(secs, 1e-9) / 1e6 << " M events/s)\n"
+                  << "==============================\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bpx_events: " << e.what() << "\n";
+        return 1;
+    }
+}
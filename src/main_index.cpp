@@ -0,0 +1,105 @@
+#include "binparse/index.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage:\n"
+              << "  bpx_index build <data> [-o <index>] [-j <threads>]\n"
+              << "  bpx_index query <data> [-i <index>] [--orbit LO[:HI]] [--cru N] [--link N] [--fee N]\n"
+              << "  bpx_index stats <data> [-i <index>]\n";
+}
+
+unsigned long parse_num(std::string_view s) {
+    return std::stoul(std::string(s), nullptr, 0);
+}
+
+// 索引与数据文件对不上时 load 抛异常；数据只是变长时提示索引没覆盖新写入的部分
+bp::RdhIndex load_checked(const std::string& idx_path, const std::string& data) {
+    auto idx = bp::RdhIndex::load(idx_path, data);
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(data, ec);
+    if (!ec && size > idx.data_size())
+        std::cerr << "bpx_index: warning: " << idx_path << " covers the first " << idx.data_size() << " of " << size
+                  << " bytes; rebuild to index the rest\n";
+    return idx;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    const std::string_view cmd = argv[1];
+    const std::string data = argv[2];
+    std::string idx_path = bp::index_path_for(data);
+    unsigned nthreads = 1;
+    bp::IndexQuery q;
+
+    try {
+        for (int i = 3; i < argc; ++i) {
+            const std::string_view a = argv[i];
+            auto next = [&]() -> std::string_view {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(a) + " needs a value");
+                return argv[++i];
+            };
+            if (a == "-o" || a == "-i") idx_path = next();
+            else if (a == "-j")         nthreads = static_cast<unsigned>(parse_num(next()));
+            else if (a == "--cru")      q.cru_id  = static_cast<uint16_t>(parse_num(next()));
+            else if (a == "--link")     q.link_id = static_cast<uint8_t>(parse_num(next()));
+            else if (a == "--fee")      q.fee_id  = static_cast<uint16_t>(parse_num(next()));
+            else if (a == "--orbit") {
+                const auto v = next();
+                const auto colon = v.find(':');
+                q.orbit_lo = static_cast<uint32_t>(parse_num(v.substr(0, colon)));
+                q.orbit_hi = (colon == std::string_view::npos) ? q.orbit_lo
+                                                               : static_cast<uint32_t>(parse_num(v.substr(colon + 1)));
+            } else {
+                usage();
+                return 1;
+            }
+        }
+
+        if (cmd == "build") {
+            auto t0 = std::chrono::steady_clock::now();
+            auto idx = bp::RdhIndex::build_file(data, nthreads);
+            idx.save(idx_path);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+            std::cout << "Indexed " << idx.entries().size() << " RDH_L0 in "
+                      << idx.data_size() << " bytes -> " << idx_path
+                      << " (" << ms << " ms)\n";
+        } else if (cmd == "query") {
+            auto idx = load_checked(idx_path, data);
+            std::uint64_t total = 0;
+            for (const auto& r : idx.query(q)) {
+                std::cout << r.begin << " " << r.end << "\n";
+                total += r.end - r.begin;
+            }
+            std::cerr << total << " bytes selected\n";
+        } else if (cmd == "stats") {
+            auto idx = load_checked(idx_path, data);
+            const auto es = idx.entries();
+            std::cout << "Entries  : " << es.size() << "\n"
+                      << "Data size: " << idx.data_size() << " bytes\n";
+            if (!es.empty())
+                std::cout << "Orbits   : " << es.front().orbit << " .. " << es.back().orbit << "\n";
+        } else {
+            usage();
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "bpx_index: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
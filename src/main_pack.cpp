@@ -0,0 +1,107 @@
+#include "binparse/codec.hpp"
+#include "binparse/mapped_file.hpp"
+#include "binparse/parser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage: bpx_pack c <raw> <packed> [-j N] [--block KiB]   compress\n"
+              << "       bpx_pack d <packed> <raw> [-j N]                  decompress\n"
+              << "       bpx_pack t <packed> [-j N]                        decompress into the parser, count lines\n";
+}
+
+struct CountingHandler {
+    std::size_t n[4] = {};
+    void on_rdh_l0(bp::RdhL0View) { ++n[0]; }
+    void on_rdh_l1(bp::RdhL1View) { ++n[1]; }
+    void on_data_line(bp::DataLineView) { ++n[2]; }
+    void on_trg_line(bp::TrgLineView) { ++n[3]; }
+};
+
+void write_file(const std::string& path, std::span<const std::byte> bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("open failed: " + path);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!out) throw std::runtime_error("write failed: " + path);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    const std::string_view mode = argv[1];
+    const std::string in_path = argv[2];
+    std::string out_path;
+    bp::CodecOptions opt;
+
+    try {
+        for (int i = 3; i < argc; ++i) {
+            const std::string_view a = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(a) + " needs a value");
+                return argv[++i];
+            };
+            if (a == "-j")                              opt.threads = static_cast<unsigned>(std::stoul(next()));
+            else if (a == "--block")                    opt.block_bytes = std::max<std::size_t>(std::stoul(next()), 1) << 10;
+            else if (out_path.empty() && a[0] != '-')   out_path = a;
+            else { usage(); return 1; }
+        }
+        if ((mode == "c" || mode == "d") == out_path.empty() || (mode != "c" && mode != "d" && mode != "t")) {
+            usage();
+            return 1;
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        bp::MappedFile file(in_path);
+        file.advise(bp::MappedFile::Advice::Sequential);
+        const auto in = file.bytes();
+        const auto secs = [&] {
+            return std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(), 1e-9);
+        };
+
+        if (mode == "c") {
+            const auto packed = bp::compress(in, opt);
+            const double s = secs();
+            write_file(out_path, packed);
+            std::cout << in.size() << " -> " << packed.size() << " bytes (ratio "
+                      << static_cast<double>(in.size()) / std::max<std::size_t>(packed.size(), 1) << "), "
+                      << in.size() / s / 1e9 << " GB/s\n";
+        } else if (mode == "d") {
+            const auto raw = bp::decompress(in, opt.threads);
+            const double s = secs();
+            write_file(out_path, raw);
+            std::cout << in.size() << " -> " << raw.size() << " bytes, " << raw.size() / s / 1e9 << " GB/s\n";
+        } else {
+            // 解出的块直接喂给 parser，不落盘也不生成完整副本
+            bp::BasicStreamParser<CountingHandler> parser;
+            uint64_t raw = 0;
+            bp::decompress_stream(in, [&](std::span<const std::byte> b) {
+                parser.feed(b);
+                raw += b.size();
+            }, opt.threads);
+            const double s = secs();
+            const auto& n = parser.handler().n;
+            std::cout << "Raw bytes          : " << raw << " (ratio "
+                      << static_cast<double>(raw) / std::max<std::size_t>(in.size(), 1) << ")\n"
+                      << "RDH L0 / L1 lines  : " << n[0] << " / " << n[1] << "\n"
+                      << "Data / TRG lines   : " << n[2] << " / " << n[3] << "\n"
+                      << "Decompress + parse : " << static_cast<long long>(s * 1e3) << " ms ("
+                      << raw / s / 1e9 << " GB/s raw)\n";
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bpx_pack: " << e.what() << "\n";
+        return 1;
+    }
+}
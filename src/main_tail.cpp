@@ -1,125 +1,210 @@
 #include "binparse/tail.hpp"
+#include "binparse/pipeline.hpp"
 #include "binparse/parser.hpp"
-#include "binparse/bytecursor.hpp"
-#include <iostream>
-#include <vector>
+#include "binparse/metrics.hpp"
+#include "binparse/columnar.hpp"
+#include "binparse/dmasim.hpp"
+#include "binparse/histogram.hpp"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+// 行计数（含未识别行）由 DecoderMetrics 负责，摘要里的包数即 RDH L0 行数；handler 只处理 TRG 行（--latency）
+struct TailHandler {
+    // --latency：TRG 行 reserved1 里是 bpx_dmasim 写入时的 monotonic_ns()
+    bp::LatencyHistogram* latency = nullptr;
+
+    bool wants(bp::LineType t) const noexcept { return t != bp::LineType::TRG || latency; }
+    void on_trg_line(bp::TrgLineView t) {
+        const uint64_t ts = t.reserved1();
+        if (!ts) return;
+        const uint64_t now = bp::monotonic_ns();
+        if (now >= ts) latency->add(now - ts);
+    }
+};
+
+void usage() {
+    std::cerr << "Usage: bpx_tail <path> [--latency] [--metrics-json FILE|-] [--interval ms] [--out COLFILE]\n";
+}
+
+// 每 interval 从另一线程读一次快照：打印进度行，并按需追加一行 JSON
+class Reporter {
+public:
+    Reporter(const bp::DecoderMetrics& m, const bp::PipelineStats& p, std::size_t slots,
+             std::ostream* json, std::chrono::milliseconds interval)
+        : m_(m), p_(p), slots_(slots), json_(json), interval_(interval), th_([this] { run(); }) {}
+
+    ~Reporter() { stop(); }
+
+    void stop() {
+        {
+            std::lock_guard lk(mu_);
+            if (done_) return;
+            done_ = true;
+        }
+        cv_.notify_all();
+        th_.join();
+        report(); // 最后一份快照
+    }
+
+private:
+    void run() {
+        std::unique_lock lk(mu_);
+        while (!cv_.wait_for(lk, interval_, [this] { return done_; })) report();
+    }
+
+    void report() {
+        const auto s = m_.snapshot();
+        if (json_) *json_ << bp::to_json(s) << std::endl;
+        if (json_ == &std::cout) return; // JSON 占用 stdout 时不打印进度行
+        std::cout << "[Progress] "
+                  << s.bytes_read / 1e6 << " MB read, "
+                  << s.lines() << " lines parsed, "
+                  << "ring " << p_.occupancy.load(std::memory_order_relaxed) << "/" << slots_ << ", "
+                  << "parse p99 " << s.parse_ns.percentile(0.99) / 1e3 << " us, "
+                  << "time elapsed: " << static_cast<long long>(s.uptime_s * 1e3) << " ms\r"
+                  << std::flush;
+    }
+
+    const bp::DecoderMetrics& m_;
+    const bp::PipelineStats&  p_;
+    std::size_t               slots_;
+    std::ostream*             json_;
+    std::chrono::milliseconds interval_;
+    std::mutex                mu_;
+    std::condition_variable   cv_;
+    bool                      done_ = false;
+    std::thread               th_;
+};
+
+} // namespace
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        std::cerr << "Usage: bpx_tail <path>\n";
+        usage();
         return 1;
     }
 
     const std::string path = argv[1];
+    bool measure_latency = false;
+    std::string json_path;
+    std::string out_path;
+    std::chrono::milliseconds interval{1000};
+    try {
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view a = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(a) + " needs a value");
+                return argv[++i];
+            };
+            if (a == "--latency")           measure_latency = true;
+            else if (a == "--metrics-json") json_path = next();
+            else if (a == "--out")          out_path = next();
+            else if (a == "--interval")     interval = std::chrono::milliseconds(std::max(1, std::stoi(next())));
+            else { usage(); return 1; }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "bpx_tail: " << e.what() << "\n";
+        usage();
+        return 1;
+    }
 
-    std::vector<std::byte> stash;
-    std::size_t total_bytes = 0;
-    std::size_t total_lines = 0;
-    std::size_t n_packets = 0;
-    std::size_t n_heartbeats = 0;
-    std::size_t n_syncs = 0;
-    std::size_t n_rdh_l0 = 0;
-    std::size_t n_rdh_l1 = 0;
-    std::size_t n_data_lines = 0;
-    std::size_t n_trg_lines = 0;
-
-    auto t_start = std::chrono::steady_clock::now();
-
-    bp::StreamParser parser(
-        /* on_packet */
-        [&](const bp::Packet& pkt) {
-            (void)pkt;
-            n_packets++;
-        },
-        /* on_heartbeat */
-        [&](const bp::Heartbeat&) {
-            n_heartbeats++;
-        },
-        /* on_sync */
-        [&](std::span<const std::byte>) {
-        },
-        /* on_rdh_l0 */
-        [&](const bp::RDH_L0& rdh, std::span<const std::byte> raw){
-            // use rdh / raw if needed
-            (void)rdh; (void)raw;
-            n_rdh_l0++;
-        },
-        /* on_rdh_l1 */
-        [&](const bp::RDH_L1& rdh, std::span<const std::byte> raw){
-            (void)rdh; (void)raw;
-            n_rdh_l1++;
-        },
-        /* on_data_line */
-        [&](const bp::DataLine& line, std::span<const std::byte> raw){
-            (void)line; (void)raw;
-            n_data_lines++;
-        },
-        /* on_trg_line */
-        [&](const bp::TrgLine& line, std::span<const std::byte> raw){
-            (void)line; (void)raw;
-            n_trg_lines++;
+    std::ofstream json_file;
+    std::ostream* json = nullptr;
+    if (json_path == "-") {
+        json = &std::cout;
+    } else if (!json_path.empty()) {
+        json_file.open(json_path, std::ios::app);
+        if (!json_file) {
+            std::cerr << "bpx_tail: cannot open " << json_path << "\n";
+            return 1;
         }
-    );
+        json = &json_file;
+    }
+
+    bp::DecoderMetrics metrics;
+    bp::BasicStreamParser<TailHandler> parser;
+    parser.set_metrics(&metrics);
+    bp::LatencyHistogram latency;
+    if (measure_latency) parser.handler().latency = &latency;
+
+    // --out：解码结果同时写成列文件（见 columnar.hpp）
+    std::unique_ptr<bp::ColumnFileWriter> writer;
+    try {
+        if (!out_path.empty()) writer = std::make_unique<bp::ColumnFileWriter>(out_path);
+    } catch (const std::exception& e) {
+        std::cerr << "bpx_tail: " << e.what() << "\n";
+        return 1;
+    }
 
-    std::cout << "Reading and parsing file: " << path << std::endl;
+    if (json != &std::cout) std::cout << "Reading and parsing file: " << path << std::endl;
 
     bp::TailOptions opts;
     opts.poll_ms = 50;                 // check for new data every 50 ms
     opts.read_chunk = 1u << 20;        // 1 MB read chunk
     opts.inactivity_timeout_ms = 5000; // exit if no new data for 5 seconds
-    bp::tail_growing_file(path, opts, [&](std::span<const std::byte> chunk) {
-        total_bytes += chunk.size();
-
-        // merge with stash to ensure full 40-byte lines
-        if (!stash.empty()) {
-            const std::size_t need = bp::ByteCursor::kLineSize - stash.size();
-            if (chunk.size() >= need) {
-                std::vector<std::byte> one(stash.begin(), stash.end());
-                one.insert(one.end(), chunk.begin(), chunk.begin() + need);
-                parser.feed(one);
-                chunk = chunk.subspan(need);
-                stash.clear();
-            } else {
-                stash.insert(stash.end(), chunk.begin(), chunk.end());
-                return;
-            }
-        }
-
-        const std::size_t remainder = chunk.size() % bp::ByteCursor::kLineSize;
-        const auto main_part = chunk.first(chunk.size() - remainder);
-        if (!main_part.empty()) parser.feed(main_part);
-        if (remainder) {
-            stash.assign(chunk.end() - remainder, chunk.end());
-        }
+    opts.read_ahead = 8;               // 读线程与解析线程之间的 8 个槽位
+    opts.metrics = &metrics;
 
-        // show simple progress every ~1 MB
-        if (total_bytes % (1 << 20) < bp::ByteCursor::kLineSize) {
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::steady_clock::now() - t_start);
-            std::cout << "[Progress] "
-                      << total_bytes / 1e6 << " MB read, "
-                      << total_lines << " lines parsed, "
-                      << "time elapsed: " << elapsed.count() << " ms\r"
-                      << std::flush;
-        }
-    });
+    bp::PipelineStats pstats;
+    opts.pipeline_stats = &pstats;
+    {
+        Reporter reporter(metrics, pstats, opts.read_ahead, json, interval);
+        bp::tail_growing_file(path, opts, [&](std::span<const std::byte> chunk) {
+            parser.feed(chunk); // 半行由 parser 内部的 carry 处理
+            if (writer) writer->feed(chunk);
+        });
+    }
+    if (writer) writer->close();
 
-    auto t_end = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start);
+    if (json == &std::cout) return 0;
 
+    const auto s = metrics.snapshot();
+    const auto us = [](uint64_t ns) { return ns / 1e3; };
     std::cout << "\n\n=== Parsing summary ===\n"
-              << "Total bytes read   : " << total_bytes << " bytes\n"
-              << "Total lines parsed : " << total_lines << "\n"
-              << "RDH L0 lines detected: " << n_rdh_l0 << "\n"
-              << "RDH L1 lines detected: " << n_rdh_l1 << "\n"
-              << "Data lines detected  : " << n_data_lines << "\n"
-              << "TRG lines detected   : " << n_trg_lines << "\n"
-              << "Packets detected   : " << n_packets << "\n"
-              << "Heartbeats detected: " << n_heartbeats << "\n"
-              << "Sync lines detected: " << n_syncs << "\n"
-              << "Elapsed time       : " << elapsed.count() << " ms\n"
-              << "=======================\n";
+              << "Total bytes read   : " << s.bytes_read << " bytes\n"
+              << "Total lines parsed : " << s.lines() << "\n"
+              << "RDH L0 lines detected: " << s.rdh_l0_lines << "\n"
+              << "RDH L1 lines detected: " << s.rdh_l1_lines << "\n"
+              << "Data lines detected  : " << s.data_lines << "\n"
+              << "TRG lines detected   : " << s.trg_lines << "\n"
+              << "Undefined lines      : " << s.undefined_lines << "\n"
+              << "Carry events       : " << s.carry_events << " (" << s.carried_bytes << " bytes)\n"
+              << "Rotations / truncations: " << s.rotations << " / " << s.truncations << "\n"
+              << "Read syscalls      : " << s.reads << " (p50 " << us(s.read_ns.percentile(0.5))
+              << " us, p99 " << us(s.read_ns.percentile(0.99)) << " us)\n"
+              << "Parse per chunk    : p50 " << us(s.parse_ns.percentile(0.5))
+              << " us, p99 " << us(s.parse_ns.percentile(0.99)) << " us, max " << us(s.parse_ns.max()) << " us\n"
+              << "Callback           : p50 " << us(s.callback_ns.percentile(0.5))
+              << " us, p99 " << us(s.callback_ns.percentile(0.99)) << " us\n"
+              << "Pipeline chunks    : " << pstats.chunks.load() << "\n"
+              << "Pipeline max occupancy: " << pstats.max_occupancy.load() << "/" << opts.read_ahead << "\n"
+              << "Reader stalls (ring full)  : " << pstats.producer_stalls.load() << "\n"
+              << "Parser stalls (ring empty) : " << pstats.consumer_stalls.load() << "\n"
+              << "Elapsed time       : " << static_cast<long long>(s.uptime_s * 1e3) << " ms\n";
+    if (writer)
+        std::cout << "Column file        : " << out_path << " (" << writer->chunks() << " chunks, "
+                  << writer->bytes_written() << " bytes)\n";
+    std::cout << "=======================\n";
+
+    if (measure_latency) {
+        const auto q = [&](double p) { return latency.percentile(p) / 1e3; };
+        std::printf("Write->callback latency (us, %llu TRG lines): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                    static_cast<unsigned long long>(latency.count()),
+                    q(0.50), q(0.90), q(0.99), q(0.999), latency.max() / 1e3);
+    }
 
     return 0;
-}
\ No newline at end of file
+}
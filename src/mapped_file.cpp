@@ -0,0 +1,98 @@
+#include "binparse/mapped_file.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+namespace bp {
+
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("open failed: " + path);
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("fstat failed: " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("mmap failed: " + path);
+        }
+        data_ = static_cast<const std::byte*>(p);
+        mapped_ = true;
+    }
+    ::close(fd); // 映射建立后 fd 可以关闭
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("open failed: " + path);
+    fallback_.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0, std::ios::beg);
+    in.read(reinterpret_cast<char*>(fallback_.data()), static_cast<std::streamsize>(fallback_.size()));
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+#endif
+}
+
+MappedFile::~MappedFile() { reset(); }
+
+MappedFile::MappedFile(MappedFile&& o) noexcept
+    : data_(std::exchange(o.data_, nullptr))
+    , size_(std::exchange(o.size_, 0))
+    , mapped_(std::exchange(o.mapped_, false))
+    , fallback_(std::move(o.fallback_)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if (this != &o) {
+        reset();
+        data_     = std::exchange(o.data_, nullptr);
+        size_     = std::exchange(o.size_, 0);
+        mapped_   = std::exchange(o.mapped_, false);
+        fallback_ = std::move(o.fallback_);
+    }
+    return *this;
+}
+
+void MappedFile::reset() noexcept {
+#ifndef _WIN32
+    if (mapped_) ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    fallback_.clear();
+}
+
+void MappedFile::advise(Advice a, std::size_t off, std::size_t len) const noexcept {
+#ifndef _WIN32
+    if (!mapped_ || off >= size_) return;
+    if (len == 0 || len > size_ - off) len = size_ - off;
+
+    // madvise 要求页对齐起点
+    const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t aligned = off - off % page;
+    int adv = MADV_NORMAL;
+    switch (a) {
+    case Advice::Normal:     adv = MADV_NORMAL;     break;
+    case Advice::Sequential: adv = MADV_SEQUENTIAL; break;
+    case Advice::Random:     adv = MADV_RANDOM;     break;
+    case Advice::WillNeed:   adv = MADV_WILLNEED;   break;
+    }
+    ::madvise(const_cast<std::byte*>(data_) + aligned, len + (off - aligned), adv);
+#else
+    (void)a; (void)off; (void)len;
+#endif
+}
+
+} // namespace bp
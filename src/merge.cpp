@@ -0,0 +1,323 @@
+#include "binparse/merge.hpp"
+#include "binparse/bytecursor.hpp"
+#include "binparse/lines.hpp"
+#include "binparse/mapped_file.hpp"
+#include "binparse/parser.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace bp {
+
+namespace {
+constexpr std::size_t kLine = ByteCursor::kLineSize;
+
+// 以 line 开头的分帧单元长度：合法 RDH_L0 为 offset_new_packet，否则一行
+std::size_t unit_size(std::span<const std::byte> line, bool& framed) noexcept {
+    framed = false;
+    if (classify_line(line) != LineType::RDH_L0) return kLine;
+    const RdhL0View l0(line);
+    const std::size_t mem = l0.memory_size(), next = l0.offset_new_packet();
+    if (mem < 2 * kLine || next < mem) return kLine;
+    framed = true;
+    return next;
+}
+
+uint64_t time_key(std::span<const std::byte> line) noexcept {
+    const RdhL0View l0(line);
+    return (uint64_t{l0.orbit()} << 12) | l0.bc();
+}
+} // namespace
+
+SourceMerger::SourceMerger(std::vector<std::string> paths, MergeOptions opt)
+    : opt_(opt)
+{
+    opt_.queue_batches = std::max<std::size_t>(opt_.queue_batches, 1);
+    opt_.read_chunk = std::max<std::size_t>(opt_.read_chunk, kLine);
+    sources_.reserve(paths.size());
+    for (auto& p : paths) {
+        auto s = std::make_unique<Source>(opt_.queue_batches);
+        s->path = std::move(p);
+        sources_.push_back(std::move(s));
+    }
+}
+
+SourceMerger::~SourceMerger() {
+    stop();
+    for (auto& s : sources_)
+        if (s->worker.joinable()) s->worker.join();
+}
+
+void SourceMerger::stop() noexcept {
+    stop_.store(true, std::memory_order_relaxed);
+    for (auto& s : sources_) {
+        s->queue.close();
+        s->free.close();
+    }
+}
+
+void SourceMerger::fail(std::exception_ptr e) noexcept {
+    {
+        std::lock_guard lk(err_mu_);
+        if (!err_) err_ = e;
+    }
+    stop();
+}
+
+// ---------- 解码线程 ----------
+
+void SourceMerger::run_source(std::size_t i) {
+    Source& s = *sources_[i];
+    try {
+        if (opt_.follow) {
+            TailOptions t = opt_.tail;
+            t.stop = &stop_;
+            tail_growing_file(s.path, t, [&](std::span<const std::byte> chunk) { feed(s, chunk); });
+        } else {
+            MappedFile file(s.path);
+            file.advise(MappedFile::Advice::Sequential);
+            const auto bytes = file.bytes();
+            for (std::size_t off = 0; off < bytes.size() && !stop_.load(std::memory_order_relaxed); off += opt_.read_chunk)
+                feed(s, bytes.subspan(off, std::min(opt_.read_chunk, bytes.size() - off)));
+        }
+        frame(s, s.pend, true);
+        s.pend.clear();
+        dispatch(s);
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    s.queue.close();
+}
+
+void SourceMerger::feed(Source& s, std::span<const std::byte> chunk) {
+    // 先把上次残留的不完整包补齐：只拷贝补齐所需的字节
+    while (!s.pend.empty() && !chunk.empty()) {
+        bool framed = false;
+        const std::size_t need = s.pend.size() < kLine ? kLine : unit_size(std::span(s.pend).first(kLine), framed);
+        const std::size_t take = std::min(need - s.pend.size(), chunk.size());
+        s.pend.insert(s.pend.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(take));
+        chunk = chunk.subspan(take);
+        if (s.pend.size() < need) return;
+        if (need == kLine && unit_size(s.pend, framed) > kLine) continue; // 刚收齐包头
+        frame(s, s.pend, false);
+        s.pend.clear();
+    }
+    if (!s.pend.empty()) return;
+
+    const std::size_t used = frame(s, chunk, false);
+    s.pend.assign(chunk.begin() + static_cast<std::ptrdiff_t>(used), chunk.end());
+}
+
+// 把 bytes 中完整的分帧单元追加到当前批，返回消耗的字节数；eof 时不完整的末包也交出
+std::size_t SourceMerger::frame(Source& s, std::span<const std::byte> bytes, bool eof) {
+    std::size_t pos = 0;
+    while (pos < bytes.size()) {
+        const std::size_t rem = bytes.size() - pos;
+        if (rem < kLine) {
+            if (eof) s.stats.truncated_bytes += rem; // 交出去会让下游按行解析错位
+            return eof ? bytes.size() : pos;
+        }
+        const auto line = bytes.subspan(pos, kLine);
+        bool framed = false;
+        std::size_t n = unit_size(line, framed);
+        if (rem < n) {
+            if (!eof) break;
+            n = rem - rem % kLine; // 不完整的末包：交出其中的整行
+        }
+        if (framed) {
+            const RdhL0View l0(line);
+            append(s, bytes.subspan(pos, n), time_key(line), LinkKey{l0.cru_id(), l0.link_id(), l0.fee_id()}, true);
+        } else {
+            append(s, bytes.subspan(pos, n), 0, s.last_link, false);
+        }
+        pos += n;
+    }
+    return pos;
+}
+
+void SourceMerger::append(Source& s, std::span<const std::byte> unit, uint64_t key, const LinkKey& link, bool framed) {
+    uint32_t lane = s.last_lane;
+    if (s.lane_key.empty() || !(link == s.last_link)) {
+        const auto [it, added] = s.lane_ids.try_emplace(link, static_cast<uint32_t>(s.lane_key.size()));
+        if (added) s.lane_key.push_back(0);
+        lane = it->second;
+        s.last_link = link;
+        s.last_lane = lane;
+    }
+    if (!framed) key = s.lane_key[lane]; // 游离行沿用所在 link 上一个包的时间
+
+    auto& b = s.cur;
+    const auto begin = static_cast<uint32_t>(b.bytes.size());
+    // 相邻的游离行并成一块
+    if (!framed && !b.records.empty() && !b.records.back().framed && b.records.back().lane == lane)
+        b.records.back().len += static_cast<uint32_t>(unit.size());
+    else
+        b.records.push_back(Record{key, s.offset, begin, static_cast<uint32_t>(unit.size()), lane, link, framed});
+    b.bytes.insert(b.bytes.end(), unit.begin(), unit.end());
+    s.offset += unit.size();
+
+    s.stats.bytes += unit.size();
+    if (framed) {
+        ++s.stats.packets;
+        if (key < s.lane_key[lane]) ++s.stats.regressions;
+        s.lane_key[lane] = key;
+    } else {
+        s.stats.stray_lines += (unit.size() + kLine - 1) / kLine;
+    }
+    if (b.bytes.size() >= opt_.batch_bytes) dispatch(s);
+}
+
+void SourceMerger::dispatch(Source& s) {
+    if (s.cur.records.empty()) return;
+    s.queue.push(std::move(s.cur)); // 队列满时在此阻塞；stop() 后直接丢弃
+    if (!s.free.try_pop(s.cur)) {
+        s.cur = Batch{};
+        s.cur.bytes.reserve(opt_.batch_bytes + (64u << 10));
+    }
+    s.cur.bytes.clear();
+    s.cur.records.clear();
+}
+
+// ---------- 合并 ----------
+
+void SourceMerger::run(const Sink& sink) {
+    if (ran_) throw std::logic_error("SourceMerger::run called twice");
+    ran_ = true;
+
+    const std::size_t n = sources_.size();
+    for (std::size_t i = 0; i < n; ++i)
+        sources_[i]->worker = std::thread([this, i] { run_source(i); });
+
+    // 合并线程这一侧每个源的状态：取到的批按顺序暂存，记录按 lane 分进子队列
+    struct Ref {
+        uint64_t seq; // 所在批的序号
+        uint32_t rec; // 在批内的下标
+    };
+    struct Held {
+        Batch    batch;
+        uint32_t left; // 还没交出的记录数
+    };
+    struct Head {
+        std::deque<Held>            held;
+        uint64_t                    base = 0; // held.front() 的序号
+        std::size_t                 held_bytes = 0;
+        std::size_t                 pending = 0; // 暂存中还没交出的记录数
+        std::vector<std::deque<Ref>> lanes;
+        std::size_t                 empty_lanes = 0;
+        bool                        warm = false; // 已有 link 出现第二个单元，即各 link 至少轮过一遍
+        bool                        live = true;
+    };
+    std::vector<Head> heads(n);
+
+    // 小顶堆：(时间, 源下标, lane)，每个非空子队列的队首一项
+    using Item = std::tuple<uint64_t, std::size_t, uint32_t>;
+    std::vector<Item> heap;
+    const auto later = std::greater<Item>{};
+    auto push = [&](uint64_t key, std::size_t i, uint32_t lane) {
+        heap.emplace_back(key, i, lane);
+        std::push_heap(heap.begin(), heap.end(), later);
+    };
+
+    // 从源 i 再取一批分进子队列；源已结束时返回 false
+    auto pull = [&](std::size_t i) {
+        Source& s = *sources_[i];
+        Head& h = heads[i];
+        Batch b;
+        if (!s.queue.try_pop(b)) {
+            if (!s.queue.pop(b)) {
+                h.live = false;
+                return false;
+            }
+            ++stats_.waits;
+        }
+        if (b.records.empty()) {
+            s.free.try_push(std::move(b));
+            return true;
+        }
+        const uint64_t seq = h.base + h.held.size();
+        for (uint32_t k = 0; k < b.records.size(); ++k) {
+            const Record& r = b.records[k];
+            if (r.lane >= h.lanes.size()) {
+                h.empty_lanes += r.lane + 1 - h.lanes.size();
+                h.lanes.resize(r.lane + 1);
+            }
+            auto& q = h.lanes[r.lane];
+            if (q.empty()) {
+                --h.empty_lanes;
+                push(r.key, i, r.lane);
+            } else {
+                h.warm = true;
+            }
+            q.push_back(Ref{seq, k});
+        }
+        h.pending += b.records.size();
+        h.held_bytes += b.bytes.size();
+        const auto cnt = static_cast<uint32_t>(b.records.size());
+        h.held.push_back(Held{std::move(b), cnt});
+        return true;
+    };
+
+    // 源 i 的最早包可以确定：源已结束，或每条 link 都有数据（暂存超限时不再等）。
+    // 开头还不知道有哪些 link，先读到某条 link 重复出现为止
+    auto settle = [&](std::size_t i) {
+        Head& h = heads[i];
+        while (h.live && (h.pending == 0 || ((h.empty_lanes || !h.warm) && h.held_bytes < opt_.reorder_bytes)))
+            if (!pull(i)) break;
+    };
+
+    try {
+        for (std::size_t i = 0; i < n; ++i) settle(i);
+
+        uint64_t last = 0;
+        while (!heap.empty() && !stop_.load(std::memory_order_relaxed)) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            const auto [key, i, lane] = heap.back();
+            heap.pop_back();
+
+            Head& h = heads[i];
+            auto& q = h.lanes[lane];
+            const Ref ref = q.front();
+            q.pop_front();
+            Held& hb = h.held[ref.seq - h.base];
+            const Record& r = hb.batch.records[ref.rec];
+            if (stats_.packets && key < last) ++stats_.out_of_order;
+            last = key;
+            ++stats_.packets;
+            stats_.bytes += r.len;
+            sink(MergedPacket{i, static_cast<uint32_t>(key >> 12), static_cast<uint16_t>(key & 0xFFF), r.offset,
+                              r.link, r.framed, std::span<const std::byte>(hb.batch.bytes).subspan(r.begin, r.len)});
+
+            if (!q.empty()) {
+                const Ref nx = q.front();
+                push(h.held[nx.seq - h.base].batch.records[nx.rec].key, i, lane);
+            } else {
+                ++h.empty_lanes;
+            }
+            --h.pending;
+            // 批按顺序回收：前面的批全部交出后才回收后面的
+            --hb.left;
+            while (!h.held.empty() && h.held.front().left == 0) {
+                h.held_bytes -= h.held.front().batch.bytes.size();
+                sources_[i]->free.try_push(std::move(h.held.front().batch));
+                h.held.pop_front();
+                ++h.base;
+            }
+            settle(i);
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    stop();
+    stats_.sources.clear();
+    for (auto& s : sources_) {
+        if (s->worker.joinable()) s->worker.join();
+        stats_.sources.push_back(s->stats);
+    }
+    if (err_) std::rethrow_exception(err_);
+}
+
+} // namespace bp
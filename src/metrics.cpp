@@ -0,0 +1,89 @@
+#include "binparse/metrics.hpp"
+
+#include <cstdio>
+
+namespace bp {
+namespace {
+
+constexpr auto kRelaxed = std::memory_order_relaxed;
+
+void append_hist(std::string& out, const char* name, const LatencyHistogram& h) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu,\"buckets\":[",
+                  name, static_cast<unsigned long long>(h.count()), h.mean(),
+                  static_cast<unsigned long long>(h.percentile(0.50)),
+                  static_cast<unsigned long long>(h.percentile(0.90)),
+                  static_cast<unsigned long long>(h.percentile(0.99)),
+                  static_cast<unsigned long long>(h.max()));
+    out += buf;
+    bool first = true;
+    h.for_each_bucket([&](uint64_t upper, uint64_t n) {
+        std::snprintf(buf, sizeof(buf), "%s[%llu,%llu]", first ? "" : ",", static_cast<unsigned long long>(upper),
+                      static_cast<unsigned long long>(n));
+        out += buf;
+        first = false;
+    });
+    out += "]}";
+}
+
+} // namespace
+
+MetricsSnapshot DecoderMetrics::snapshot() const noexcept {
+    using Clock = std::chrono::steady_clock;
+    MetricsSnapshot s;
+    s.uptime_s = std::chrono::duration<double>(
+        Clock::now().time_since_epoch() - Clock::duration(start_.load(kRelaxed))).count();
+    s.bytes_read      = bytes_read.load(kRelaxed);
+    s.reads           = reads.load(kRelaxed);
+    s.chunks_parsed   = chunks_parsed.load(kRelaxed);
+    s.data_lines      = data_lines.load(kRelaxed);
+    s.trg_lines       = trg_lines.load(kRelaxed);
+    s.rdh_l0_lines    = rdh_l0_lines.load(kRelaxed);
+    s.rdh_l1_lines    = rdh_l1_lines.load(kRelaxed);
+    s.undefined_lines = undefined_lines.load(kRelaxed);
+    s.carry_events    = carry_events.load(kRelaxed);
+    s.carried_bytes   = carried_bytes.load(kRelaxed);
+    s.rotations       = rotations.load(kRelaxed);
+    s.truncations     = truncations.load(kRelaxed);
+    s.read_ns         = read_ns.snapshot();
+    s.parse_ns        = parse_ns.snapshot();
+    s.callback_ns     = callback_ns.snapshot();
+    return s;
+}
+
+void DecoderMetrics::reset() noexcept {
+    for (auto* c : {&bytes_read, &reads, &chunks_parsed, &data_lines, &trg_lines, &rdh_l0_lines,
+                    &rdh_l1_lines, &undefined_lines, &carry_events, &carried_bytes, &rotations, &truncations})
+        c->store(0, kRelaxed);
+    read_ns.reset();
+    parse_ns.reset();
+    callback_ns.reset();
+    start_.store(std::chrono::steady_clock::now().time_since_epoch().count(), kRelaxed);
+}
+
+std::string to_json(const MetricsSnapshot& s) {
+    char buf[768];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"uptime_s\":%.3f,\"bytes_read\":%llu,\"reads\":%llu,\"chunks_parsed\":%llu,"
+                  "\"lines\":{\"total\":%llu,\"data\":%llu,\"trg\":%llu,\"rdh_l0\":%llu,\"rdh_l1\":%llu,\"undefined\":%llu},"
+                  "\"carry_events\":%llu,\"carried_bytes\":%llu,\"rotations\":%llu,\"truncations\":%llu,",
+                  s.uptime_s,
+                  static_cast<unsigned long long>(s.bytes_read), static_cast<unsigned long long>(s.reads),
+                  static_cast<unsigned long long>(s.chunks_parsed), static_cast<unsigned long long>(s.lines()),
+                  static_cast<unsigned long long>(s.data_lines), static_cast<unsigned long long>(s.trg_lines),
+                  static_cast<unsigned long long>(s.rdh_l0_lines), static_cast<unsigned long long>(s.rdh_l1_lines),
+                  static_cast<unsigned long long>(s.undefined_lines),
+                  static_cast<unsigned long long>(s.carry_events), static_cast<unsigned long long>(s.carried_bytes),
+                  static_cast<unsigned long long>(s.rotations), static_cast<unsigned long long>(s.truncations));
+    std::string out = buf;
+    append_hist(out, "read_ns", s.read_ns);
+    out += ',';
+    append_hist(out, "parse_ns", s.parse_ns);
+    out += ',';
+    append_hist(out, "callback_ns", s.callback_ns);
+    out += '}';
+    return out;
+}
+
+} // namespace bp
@@ -0,0 +1,233 @@
+#include "binparse/occupancy.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace bp {
+namespace {
+
+// 不假定 POPCNT（库不带 -march）：std::popcount 在那里会变成 libgcc 调用，SWAR 版本还可向量化
+constexpr uint32_t popcount32(uint32_t v) noexcept {
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return (((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
+
+} // namespace
+
+// ---------------- Recorder ----------------
+
+OccupancyMonitor::Recorder::Recorder(const OccupancyOptions& opt)
+    : flush_lines_(std::max<std::size_t>(opt.flush_lines, 1))
+    , local_(kCounters)
+    , orbit_key_(std::bit_ceil(std::max<std::size_t>(opt.orbit_window, 1)), kNoOrbit)
+    , orbit_count_(orbit_key_.size())
+    , orbit_mask_(orbit_key_.size() - 1)
+    , pub_(new std::atomic<uint64_t>[kCounters])
+    , pub_orbit_key_(new std::atomic<uint64_t>[orbit_key_.size()])
+    , pub_orbit_count_(new std::atomic<uint64_t>[orbit_key_.size()])
+{
+    for (std::size_t i = 0; i < kCounters; ++i) pub_[i].store(0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < orbit_key_.size(); ++i) {
+        pub_orbit_key_[i].store(kNoOrbit, std::memory_order_relaxed);
+        pub_orbit_count_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void OccupancyMonitor::Recorder::on_data_line(DataLineView d) noexcept {
+    ++local_[kDataLines];
+    ++local_[kVldb + d.header_vldb_id()];
+    ++local_[kDataBx + d.bx_cnt()];
+
+    // data word 先攒 kWordBatch 行，再成批统计位占用（见 spill_words）
+    for (std::size_t w = 0; w < kOccWords; ++w) words_[w][n_words_] = d.data_word(w);
+    if (++n_words_ == kWordBatch) spill_words();
+
+    // 槽被更早的 orbit 占着：先发布它的计数再换号；比槽里的还早就是滑出窗口的迟到行
+    const uint64_t orbit = d.ob_cnt();
+    const std::size_t i = orbit & orbit_mask_;
+    if (orbit_key_[i] == orbit) {
+        ++orbit_count_[i];
+    } else if (orbit_key_[i] == kNoOrbit || orbit > orbit_key_[i]) {
+        publish_orbit(i);
+        orbit_key_[i] = orbit;
+        orbit_count_[i] = 1;
+    } else {
+        ++local_[kLateOrbit];
+    }
+
+    if (++pending_lines_ >= flush_lines_) flush();
+}
+
+void OccupancyMonitor::Recorder::on_trg_line(TrgLineView t) noexcept {
+    ++local_[kTrgLines];
+    ++local_[kTrgBx + (t.bx_cnt() & 0xFFF)];
+    if (++pending_lines_ >= flush_lines_) flush();
+}
+
+// 位占用用半字节计数器累加：acc[b] 的第 k 个半字节统计第 4k+b 位，至多 15 行不会溢出
+void OccupancyMonitor::Recorder::spill_words() noexcept {
+    static_assert(kWordBatch <= 15);
+    const std::size_t n = n_words_; // local_ 也是 uint64_t，先取出免得每次写计数后重读
+    for (std::size_t w = 0; w < kOccWords; ++w) {
+        const uint32_t* v = words_[w].data();
+        uint32_t acc[4] = {};
+        for (std::size_t k = 0; k < n; ++k)
+            for (std::size_t b = 0; b < 4; ++b) acc[b] += (v[k] >> b) & 0x11111111u;
+        uint64_t* bins = local_.data() + kWordBits + w * kOccWordBits;
+        for (std::size_t b = 0; b < 4; ++b)
+            for (std::size_t k = 0; k < 8; ++k) bins[4 * k + b] += (acc[b] >> (4 * k)) & 0xF;
+
+        uint64_t* pop = local_.data() + kWordPop + w * (kOccWordBits + 1);
+        for (std::size_t k = 0; k < n; ++k) ++pop[popcount32(v[k])];
+    }
+    n_words_ = 0;
+}
+
+// 本地槽 i 的增量并入镜像；镜像里的 orbit 换号时先把 key 置空，读端据此丢弃这一槽
+void OccupancyMonitor::Recorder::publish_orbit(std::size_t i) noexcept {
+    const uint64_t key = orbit_key_[i];
+    if (key == kNoOrbit) return;
+    auto& pk = pub_orbit_key_[i];
+    auto& pc = pub_orbit_count_[i];
+    if (pk.load(std::memory_order_relaxed) != key) {
+        pk.store(kNoOrbit, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        pc.store(0, std::memory_order_relaxed);
+        pk.store(key, std::memory_order_release);
+    }
+    pc.store(pc.load(std::memory_order_relaxed) + orbit_count_[i], std::memory_order_relaxed);
+    orbit_count_[i] = 0;
+}
+
+void OccupancyMonitor::Recorder::flush() {
+    if (n_words_) spill_words();
+    // 单写者：load + store 即可，不需要 RMW
+    for (std::size_t i = 0; i < kCounters; ++i) {
+        if (!local_[i]) continue;
+        pub_[i].store(pub_[i].load(std::memory_order_relaxed) + local_[i], std::memory_order_relaxed);
+        local_[i] = 0;
+    }
+    for (std::size_t i = 0; i < orbit_key_.size(); ++i)
+        if (orbit_count_[i]) publish_orbit(i);
+    pending_lines_ = 0;
+}
+
+void OccupancyMonitor::Recorder::feed(std::span<const std::byte> chunk) {
+    parser_.feed(chunk);
+}
+
+void OccupancyMonitor::Recorder::merge_into(OccupancySnapshot& s, std::vector<uint64_t>& okeys,
+                                            std::vector<uint64_t>& ocounts) const {
+    const auto ld = [&](std::size_t i) { return pub_[i].load(std::memory_order_relaxed); };
+    s.data_lines += ld(kDataLines);
+    s.trg_lines += ld(kTrgLines);
+    s.late_orbit_lines += ld(kLateOrbit);
+    const auto add = [&](std::vector<uint64_t>& dst, std::size_t base) {
+        for (std::size_t k = 0; k < dst.size(); ++k) dst[k] += ld(base + k);
+    };
+    add(s.vldb, kVldb);
+    add(s.data_bx, kDataBx);
+    add(s.trg_bx, kTrgBx);
+    add(s.word_bits, kWordBits);
+    add(s.word_popcount, kWordPop);
+
+    for (std::size_t i = 0; i < orbit_key_.size(); ++i) {
+        const uint64_t k1 = pub_orbit_key_[i].load(std::memory_order_acquire);
+        if (k1 == kNoOrbit) continue;
+        const uint64_t c = pub_orbit_count_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (pub_orbit_key_[i].load(std::memory_order_relaxed) != k1) continue; // 正在换号
+        okeys.push_back(k1);
+        ocounts.push_back(c);
+    }
+}
+
+// ---------------- OccupancyMonitor ----------------
+
+OccupancyMonitor::OccupancyMonitor(OccupancyOptions opt)
+    : opt_(opt)
+    , recorders_(new std::atomic<Recorder*>[std::max<std::size_t>(opt.max_recorders, 1)])
+{
+    opt_.max_recorders = std::max<std::size_t>(opt_.max_recorders, 1);
+    opt_.orbit_window = std::bit_ceil(std::max<std::size_t>(opt_.orbit_window, 1));
+    for (std::size_t i = 0; i < opt_.max_recorders; ++i) recorders_[i].store(nullptr, std::memory_order_relaxed);
+}
+
+OccupancyMonitor::~OccupancyMonitor() { stop(); }
+
+OccupancyMonitor::Recorder& OccupancyMonitor::recorder() {
+    std::lock_guard lk(reg_mu_);
+    const std::size_t n = n_recorders_.load(std::memory_order_relaxed);
+    if (n >= opt_.max_recorders) throw std::length_error("OccupancyMonitor: too many recorders");
+    auto& r = owned_.emplace_back(std::make_unique<Recorder>(opt_));
+    recorders_[n].store(r.get(), std::memory_order_relaxed);
+    n_recorders_.store(n + 1, std::memory_order_release);
+    return *r;
+}
+
+OccupancySnapshot OccupancyMonitor::snapshot() const {
+    OccupancySnapshot s;
+    s.uptime_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0_).count();
+    s.vldb.assign(kOccVldbs, 0);
+    s.data_bx.assign(kOccBx, 0);
+    s.trg_bx.assign(kOccBx, 0);
+    s.word_bits.assign(kOccWords * kOccWordBits, 0);
+    s.word_popcount.assign(kOccWords * (kOccWordBits + 1), 0);
+
+    std::vector<uint64_t> okeys, ocounts;
+    const std::size_t n = n_recorders_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; ++i) recorders_[i].load(std::memory_order_relaxed)->merge_into(s, okeys, ocounts);
+
+    // 各 Recorder 的 orbit 窗口可能错开：以出现过的最大 orbit 为终点取连续的 orbit_window 个
+    if (!okeys.empty()) {
+        const uint64_t last = *std::max_element(okeys.begin(), okeys.end());
+        const uint64_t first = last >= opt_.orbit_window ? last - opt_.orbit_window + 1 : 0;
+        s.orbit.resize(last - first + 1);
+        s.orbit_data.assign(s.orbit.size(), 0);
+        for (std::size_t k = 0; k < s.orbit.size(); ++k) s.orbit[k] = first + k;
+        for (std::size_t k = 0; k < okeys.size(); ++k)
+            if (okeys[k] >= first) s.orbit_data[okeys[k] - first] += ocounts[k];
+    }
+    return s;
+}
+
+void OccupancyMonitor::start(std::chrono::milliseconds interval, Callback on_publish) {
+    stop();
+    on_publish_ = std::move(on_publish);
+    stopping_ = false;
+    publisher_ = std::thread([this, interval] { run(interval); });
+}
+
+void OccupancyMonitor::stop() {
+    {
+        std::lock_guard lk(mu_);
+        if (!publisher_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    publisher_.join();
+}
+
+void OccupancyMonitor::run(std::chrono::milliseconds interval) {
+    std::unique_lock lk(mu_);
+    while (!cv_.wait_for(lk, interval, [this] { return stopping_; })) {
+        lk.unlock();
+        auto s = std::make_shared<OccupancySnapshot>(snapshot());
+        {
+            std::lock_guard l2(latest_mu_);
+            s->seq = ++seq_;
+            latest_ = s;
+        }
+        if (on_publish_) on_publish_(*s);
+        lk.lock();
+    }
+}
+
+std::shared_ptr<const OccupancySnapshot> OccupancyMonitor::latest() const {
+    std::lock_guard lk(latest_mu_);
+    return latest_;
+}
+
+} // namespace bp
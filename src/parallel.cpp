@@ -0,0 +1,122 @@
+#include "binparse/parallel.hpp"
+#include "binparse/bytecursor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace bp {
+namespace {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+
+    // offset_new_packet 是 16 位，包结构的流里相邻 RDH_L0 不会相隔超过这么多行；
+    // 切点只在这个范围内找，没有 RDH_L0 的大段数据不会让每个切点都扫到文件尾
+    constexpr std::size_t kMaxCutScan = (std::size_t{1} << 16) / kLine;
+
+    // 从 line 下标 i 起（至多 kMaxCutScan 行）找第一个 RDH_L0 行，找不到返回 n
+    std::size_t next_rdh_l0(std::span<const std::byte> data, std::size_t i, std::size_t n) {
+        for (const std::size_t end = std::min(n, i + kMaxCutScan); i < end; ++i)
+            if (classify_line(data.subspan(i * kLine, kLine)) == LineType::RDH_L0) return i;
+        return n;
+    }
+
+    // 每个 worker 一个双端队列：自己从队头取，别人从队尾偷
+    struct WorkQueue {
+        std::mutex              mu;
+        std::deque<std::size_t> q;
+
+        bool pop_front(std::size_t& out) {
+            std::lock_guard lk(mu);
+            if (q.empty()) return false;
+            out = q.front(); q.pop_front();
+            return true;
+        }
+        bool steal_back(std::size_t& out) {
+            std::lock_guard lk(mu);
+            if (q.empty()) return false;
+            out = q.back(); q.pop_back();
+            return true;
+        }
+    };
+}
+
+std::vector<Shard> plan_shards(std::span<const std::byte> data, std::size_t nshards) {
+    const std::size_t n = data.size() / kLine;
+    std::vector<Shard> out;
+    if (n == 0) return out;
+    nshards = std::clamp<std::size_t>(nshards, 1, n);
+
+    // 每段起点（按行），首段固定从 0 开始
+    std::vector<std::size_t> starts{0};
+    for (std::size_t k = 1; k < nshards; ++k) {
+        std::size_t s = next_rdh_l0(data, n * k / nshards, n);
+        if (s > starts.back() && s < n) starts.push_back(s);
+    }
+    starts.push_back(n);
+
+    out.reserve(starts.size() - 1);
+    for (std::size_t k = 0; k + 1 < starts.size(); ++k)
+        out.push_back(Shard{starts[k] * kLine, (starts[k + 1] - starts[k]) * kLine});
+    return out;
+}
+
+void run_shards_parallel(std::span<const std::byte> data,
+                         const std::vector<Shard>& shards,
+                         unsigned nthreads,
+                         const std::function<void(std::size_t, std::span<const std::byte>)>& task)
+{
+    if (shards.empty()) return;
+    if (nthreads == 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+    nthreads = static_cast<unsigned>(std::min<std::size_t>(nthreads, shards.size()));
+
+    auto run_one = [&](std::size_t idx) {
+        const auto& s = shards[idx];
+        task(idx, data.subspan(static_cast<std::size_t>(s.offset), s.size));
+    };
+
+    if (nthreads == 1) {
+        for (std::size_t i = 0; i < shards.size(); ++i) run_one(i);
+        return;
+    }
+
+    // 初始分配：连续的 shard 区间给同一个 worker，保持顺序读的局部性
+    std::vector<WorkQueue> queues(nthreads);
+    for (std::size_t i = 0; i < shards.size(); ++i)
+        queues[i * nthreads / shards.size()].q.push_back(i);
+
+    std::atomic<bool>  failed{false};
+    std::exception_ptr first_error;
+    std::mutex         err_mu;
+
+    auto worker = [&](unsigned self) {
+        std::size_t idx;
+        for (;;) {
+            if (failed.load(std::memory_order_relaxed)) return;
+            bool got = queues[self].pop_front(idx);
+            for (unsigned k = 1; !got && k < nthreads; ++k)
+                got = queues[(self + k) % nthreads].steal_back(idx);
+            if (!got) return; // 没有新任务会再产生，全空即结束
+
+            try {
+                run_one(idx);
+            } catch (...) {
+                std::lock_guard lk(err_mu);
+                if (!first_error) first_error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads - 1);
+    for (unsigned t = 1; t < nthreads; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : threads) th.join();
+
+    if (first_error) std::rethrow_exception(first_error);
+}
+
+} // namespace bp
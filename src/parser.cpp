@@ -1,5 +1,7 @@
 #include "binparse/parser.hpp"
 #include "binparse/bytecursor.hpp"
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
@@ -7,203 +9,169 @@
 
 namespace bp {
 namespace {
-    // constexpr std::size_t kLine = ByteCursor::kLineSize;
-    // constexpr std::size_t kLinesPerPacket = LINE_BYTES;
-    // constexpr std::size_t kLinesPerHeartbeat = 2;
+    using namespace detail;
+}
 
-    inline uint8_t le8_at(std::span<const std::byte> s, std::size_t off) {
-        if (off + 1 > s.size()) return 0;
-        uint8_t v; std::memcpy(&v, s.data()+off, 1);
-        return v;
-    }
-    inline uint16_t le16_at(std::span<const std::byte> s, std::size_t off) {
-        if (off + 2 > s.size()) return 0;
-        uint16_t v; std::memcpy(&v, s.data()+off, 2);
-        if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
-        return v;
-    }
-    inline uint32_t le32_at(std::span<const std::byte> s, std::size_t off) {
-        if (off + 4 > s.size()) return 0;
-        uint32_t v; std::memcpy(&v, s.data()+off, 4);
-        if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
-        return v;
-    }
-    inline uint64_t le64_at(std::span<const std::byte> s, std::size_t off) {
-        if (off + 8 > s.size()) return 0;
-        uint64_t v; std::memcpy(&v, s.data()+off, 8);
-        if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
-        return v;
-    }
+template class BasicStreamParser<detail::CallbackHandler>;
 
-    inline LineType classify(std::span<const std::byte> line) {
-        uint16_t t = le16_at(line, 0);           // 头2字节的小端
-        uint8_t low = static_cast<uint8_t>(t & 0xff);
-        if (low == 0xac) return LineType::Data;
-        if (low == 0xbb) return LineType::TRG;
-        if (low == 0x07) return LineType::RDH_L0;
-        if (low == 0x03) return LineType::RDH_L1;
-        return LineType::Undefined;
-    }
+void StreamParser::feed(std::span<const std::byte> chunk) {
+    impl_.feed(chunk);
+}
 
-    namespace off_L0 {
-        constexpr std::size_t header_version   = 0; // uint8_t
-        constexpr std::size_t header_size      = 1; // uint8_t
-        constexpr std::size_t fee_id           = 2; // uint16_t
-        constexpr std::size_t priority_bit     = 4; // uint8_t
-        constexpr std::size_t system_id        = 5; // uint8_t
-        constexpr std::size_t reserved0        = 6; // uint16_t
-        constexpr std::size_t offset_new_packet= 8; // uint16_t
-        constexpr std::size_t memory_size      = 10; // uint16_t
-        constexpr std::size_t link_id          = 12; // uint8_t
-        constexpr std::size_t packet_counter   = 13; // uint8_t
-        constexpr std::size_t cru_id           = 14; // uint16_t (12 bits)
-        constexpr std::size_t dw               = 15; // uint8_t  (4 bits)
-        constexpr std::size_t bc               = 16; // uint16_t (12 bits
-        constexpr std::size_t reserved1        = 17; // uint32_t (20 bits)
-        constexpr std::size_t orbit            = 20; // uint32_t
-        constexpr std::size_t data_format      = 24; // uint8_t
-        constexpr std::size_t reserved2        = 25; // uint32_t (24 bits)
-        constexpr std::size_t reserved3        = 28; // uint32_t
-    }
-    namespace off_L1 {
-        constexpr std::size_t trg_type          = 0; // uint32_t
-        constexpr std::size_t hb_packet_counter = 4; // uint16_t
-        constexpr std::size_t stop_bit          = 6; // uint8_t
-        constexpr std::size_t reserved0         = 7; // uint8_t
-        constexpr std::size_t reserved1         = 8; // uint32_t
-        constexpr std::size_t reserved2         = 12; // uint32_t
-        constexpr std::size_t detector_field    = 16; // uint32_t
-        constexpr std::size_t par_bit           = 20; // uint16_t
-        constexpr std::size_t reserved3         = 22; // uint16_t
-        constexpr std::size_t reserved4         = 24; // uint32_t
-        constexpr std::size_t reserved5         = 28; // uint32_t
-    }
-    namespace off_data {
-        constexpr std::size_t header_type = 0; // uint8_t
-        constexpr std::size_t header_vldb_id = 1; // uint8_t
-        constexpr std::size_t bx_cnt = 2; // uint16_t
-        constexpr std::size_t ob_cnt = 4; // uint32_t
-        constexpr std::size_t data_word0 = 8; // uint32_t
-        constexpr std::size_t data_word1 = 12; // uint32_t
-        constexpr std::size_t data_word2 = 16; // uint32_t
-        constexpr std::size_t data_word3 = 20; // uint32_t
-        constexpr std::size_t data_word4 = 24; // uint32_t
-        constexpr std::size_t data_word5 = 28; // uint32_t
-    }
-    namespace off_trg {
-        constexpr std::size_t header_type = 0; // uint32_t
-        constexpr std::size_t bx_cnt = 4;   // uint64_t
-        constexpr std::size_t ob_cnt = 12;  // uint64_t
-        constexpr std::size_t reserved0 = 20; // uint32_t
-        constexpr std::size_t reserved1 = 24; // uint64_t
-    }
+namespace {
+// 选中时扩到 n，否则清空并释放容量（投影变窄后不再占着旧列的内存；已为空时不分配也不释放）
+template <class T>
+void resize_if(std::vector<T>& col, std::size_t n, bool selected) {
+    if (selected) col.resize(n);
+    else if (col.capacity()) std::vector<T>().swap(col);
+}
+} // namespace
 
-    inline RDH_L0 parse_rdh_l0(std::span<const std::byte> line) {
-        RDH_L0 r{};
-        r.header_version    = le8_at(line, off_L0::header_version);
-        r.header_size       = le8_at(line, off_L0::header_size);
-        r.fee_id            = le16_at(line, off_L0::fee_id);
-        r.priority_bit      = le8_at(line, off_L0::priority_bit);
-        r.system_id         = le8_at(line, off_L0::system_id);
-        r.reserved0         = le16_at(line, off_L0::reserved0);
-        r.offset_new_packet = le16_at(line, off_L0::offset_new_packet);
-        r.memory_size       = le16_at(line, off_L0::memory_size);
-        r.link_id           = le8_at(line, off_L0::link_id);
-        r.packet_counter    = le8_at(line, off_L0::packet_counter);
-        r.cru_id            = le16_at(line, off_L0::cru_id) & 0x0FFF; // 12 bits
-        r.dw                = (le8_at(line, off_L0::dw) >> 4) & 0x0F; // 4 bits
-        r.bc                = le16_at(line, off_L0::bc) & 0x0FFF; // 12 bits
-        r.reserved1         = (le32_at(line, off_L0::reserved1) & 0x00FFFFF0) >> 4;
-        r.orbit             = le32_at(line, off_L0::orbit);
-        r.data_format       = le8_at(line, off_L0::data_format);
-        r.reserved2         = (le32_at(line, off_L0::reserved2) & 0x00FFFFFF);
-        r.reserved3         = le32_at(line, off_L0::reserved3);
-        return r;
-    }
+void DataColumns::resize(std::size_t n, uint32_t fields) {
+    offset.resize(n);
+    resize_if(header_vldb_id, n, fields & field::data::header_vldb_id);
+    resize_if(bx_cnt,         n, fields & field::data::bx_cnt);
+    resize_if(ob_cnt,         n, fields & field::data::ob_cnt);
+    resize_if(data_word0,     n, fields & (field::data::data_word0 << 0));
+    resize_if(data_word1,     n, fields & (field::data::data_word0 << 1));
+    resize_if(data_word2,     n, fields & (field::data::data_word0 << 2));
+    resize_if(data_word3,     n, fields & (field::data::data_word0 << 3));
+    resize_if(data_word4,     n, fields & (field::data::data_word0 << 4));
+    resize_if(data_word5,     n, fields & (field::data::data_word0 << 5));
+}
 
-    inline RDH_L1 parse_rdh_l1(std::span<const std::byte> line) {
-        RDH_L1 r{};
-        r.trg_type          = le32_at(line, off_L1::trg_type);
-        r.hb_packet_counter = le16_at(line, off_L1::hb_packet_counter);
-        r.stop_bit          = le8_at(line, off_L1::stop_bit);
-        r.reserved0         = le8_at(line, off_L1::reserved0);
-        r.reserved1         = le32_at(line, off_L1::reserved1);
-        r.reserved2         = le32_at(line, off_L1::reserved2);
-        r.detector_field    = le32_at(line, off_L1::detector_field);
-        r.par_bit           = le16_at(line, off_L1::par_bit);
-        r.reserved3         = le16_at(line, off_L1::reserved3);
-        r.reserved4         = le32_at(line, off_L1::reserved4);
-        r.reserved5         = le32_at(line, off_L1::reserved5);
-        return r;
-    }
+void TrgColumns::resize(std::size_t n, uint32_t fields) {
+    offset.resize(n);
+    resize_if(bx_cnt, n, fields & field::trg::bx_cnt);
+    resize_if(ob_cnt, n, fields & field::trg::ob_cnt);
+}
 
-    inline DataLine parse_data_line(std::span<const std::byte> line) {
-        DataLine r{};
-        r.header_type   = le8_at(line, off_data::header_type);
-        r.header_vldb_id= le8_at(line, off_data::header_vldb_id);
-        r.bx_cnt        = (le16_at(line, off_data::bx_cnt) & 0x0FFF); // 12 bits
-        r.ob_cnt        = le32_at(line, off_data::ob_cnt);
-        r.data_word0    = le32_at(line, off_data::data_word0);
-        r.data_word1    = le32_at(line, off_data::data_word1);
-        r.data_word2    = le32_at(line, off_data::data_word2);
-        r.data_word3    = le32_at(line, off_data::data_word3);
-        r.data_word4    = le32_at(line, off_data::data_word4);
-        r.data_word5    = le32_at(line, off_data::data_word5);
-        return r;
-    }
+void RdhL0Columns::resize(std::size_t n, uint32_t fields) {
+    offset.resize(n);
+    resize_if(fee_id,            n, fields & field::rdh_l0::fee_id);
+    resize_if(offset_new_packet, n, fields & field::rdh_l0::offset_new_packet);
+    resize_if(memory_size,       n, fields & field::rdh_l0::memory_size);
+    resize_if(link_id,           n, fields & field::rdh_l0::link_id);
+    resize_if(packet_counter,    n, fields & field::rdh_l0::packet_counter);
+    resize_if(cru_id,            n, fields & field::rdh_l0::cru_id);
+    resize_if(bc,                n, fields & field::rdh_l0::bc);
+    resize_if(orbit,             n, fields & field::rdh_l0::orbit);
+}
 
-    inline TrgLine parse_trg_line(std::span<const std::byte> line) {
-        TrgLine r{};
-        r.header_type = le32_at(line, off_trg::header_type);
-        r.bx_cnt      = le64_at(line, off_trg::bx_cnt);
-        r.ob_cnt      = le64_at(line, off_trg::ob_cnt);
-        r.reserved0   = le32_at(line, off_trg::reserved0);
-        r.reserved1   = le64_at(line, off_trg::reserved1);
-        return r;
-    }
-    
+void RdhL1Columns::resize(std::size_t n, uint32_t fields) {
+    offset.resize(n);
+    resize_if(trg_type,          n, fields & field::rdh_l1::trg_type);
+    resize_if(hb_packet_counter, n, fields & field::rdh_l1::hb_packet_counter);
+    resize_if(stop_bit,          n, fields & field::rdh_l1::stop_bit);
+    resize_if(detector_field,    n, fields & field::rdh_l1::detector_field);
 }
 
-void StreamParser::feed(std::span<const std::byte> chunk) {
+void LineBatch::clear() {
+    type.clear();
+    base_offset = 0;
+    data.clear();
+    trg.clear();
+    rdh_l0.clear();
+    rdh_l1.clear();
+    undefined_offset.clear();
+}
+
+std::size_t decode_batch(std::span<const std::byte> chunk, LineBatch& out, uint64_t base_offset,
+                         const FieldMask& fields) {
     constexpr size_t kLine = ByteCursor::kLineSize;
     const size_t n = chunk.size() / kLine;
-    if (n == 0) return;
+    if (n == 0) return 0;
+    if (out.type.empty()) out.base_offset = base_offset;
+
+    // 1) 分类直接写进 type 列
+    const size_t t0 = out.type.size();
+    out.type.resize(t0 + n);
+    const LineType* types = out.type.data() + t0;
+    classify_lines(chunk, out.type.data() + t0);
 
+    // 2) 统计各类型行数，一次性扩列（只扩选中的列），之后按下标写入（无 push_back 容量检查）
+    size_t c_data = 0, c_trg = 0, c_l0 = 0, c_l1 = 0;
     for (size_t i = 0; i < n; ++i) {
-        auto line = chunk.subspan(i * kLine, kLine);
-        auto type = classify(line);
+        c_data += types[i] == LineType::Data;
+        c_trg  += types[i] == LineType::TRG;
+        c_l0   += types[i] == LineType::RDH_L0;
+        c_l1   += types[i] == LineType::RDH_L1;
+    }
+    size_t i_data = out.data.size(), i_trg = out.trg.size();
+    size_t i_l0 = out.rdh_l0.size(), i_l1 = out.rdh_l1.size();
+    out.data.resize(i_data + c_data, fields.data);
+    out.trg.resize(i_trg + c_trg, fields.trg);
+    out.rdh_l0.resize(i_l0 + c_l0, fields.rdh_l0);
+    out.rdh_l1.resize(i_l1 + c_l1, fields.rdh_l1);
 
-        switch (type) {
-        case LineType::RDH_L0: {
-            RDH_L0 r = parse_rdh_l0(line);
-            // r.display();
-            if (on_rdh_l0_) on_rdh_l0_(r, line);
+    // 3) 填列。掩码在整个循环内不变，字段判断的分支总能预测对；未选中的字段不读内存
+    auto& D = out.data;
+    auto& T = out.trg;
+    auto& L0 = out.rdh_l0;
+    auto& L1 = out.rdh_l1;
+    const uint32_t fd = fields.data, ft = fields.trg, f0 = fields.rdh_l0, f1 = fields.rdh_l1;
+    for (size_t i = 0; i < n; ++i) {
+        const std::byte* line = chunk.data() + i * kLine;
+        const uint64_t off = base_offset + i * kLine;
+        switch (types[i]) {
+        case LineType::Data: {
+            const size_t r = i_data++;
+            D.offset[r] = off;
+            if (fd & field::data::header_vldb_id) D.header_vldb_id[r] = ld<uint8_t>(line + off_data::header_vldb_id);
+            if (fd & field::data::bx_cnt)         D.bx_cnt[r] = ld<uint16_t>(line + off_data::bx_cnt) & 0x0FFF;
+            if (fd & field::data::ob_cnt)         D.ob_cnt[r] = ld<uint32_t>(line + off_data::ob_cnt);
+            if (fd & field::data::data_words) {
+                if (fd & (field::data::data_word0 << 0)) D.data_word0[r] = ld<uint32_t>(line + off_data::data_word0);
+                if (fd & (field::data::data_word0 << 1)) D.data_word1[r] = ld<uint32_t>(line + off_data::data_word1);
+                if (fd & (field::data::data_word0 << 2)) D.data_word2[r] = ld<uint32_t>(line + off_data::data_word2);
+                if (fd & (field::data::data_word0 << 3)) D.data_word3[r] = ld<uint32_t>(line + off_data::data_word3);
+                if (fd & (field::data::data_word0 << 4)) D.data_word4[r] = ld<uint32_t>(line + off_data::data_word4);
+                if (fd & (field::data::data_word0 << 5)) D.data_word5[r] = ld<uint32_t>(line + off_data::data_word5);
+            }
             break;
         }
-        case LineType::RDH_L1: {
-            RDH_L1 r = parse_rdh_l1(line);
-            // r.display();
-            if (on_rdh_l1_) on_rdh_l1_(r, line);
+        case LineType::TRG: {
+            const size_t r = i_trg++;
+            T.offset[r] = off;
+            if (ft & field::trg::bx_cnt) T.bx_cnt[r] = ld<uint64_t>(line + off_trg::bx_cnt);
+            if (ft & field::trg::ob_cnt) T.ob_cnt[r] = ld<uint64_t>(line + off_trg::ob_cnt);
             break;
         }
-        case LineType::Data: {
-            DataLine d = parse_data_line(line);
-            if (on_data_line_) on_data_line_(d, line);
+        case LineType::RDH_L0: {
+            const size_t r = i_l0++;
+            L0.offset[r] = off;
+            if (f0 & field::rdh_l0::fee_id)            L0.fee_id[r]            = ld<uint16_t>(line + off_L0::fee_id);
+            if (f0 & field::rdh_l0::offset_new_packet) L0.offset_new_packet[r] = ld<uint16_t>(line + off_L0::offset_new_packet);
+            if (f0 & field::rdh_l0::memory_size)       L0.memory_size[r]       = ld<uint16_t>(line + off_L0::memory_size);
+            if (f0 & field::rdh_l0::link_id)           L0.link_id[r]           = ld<uint8_t>(line + off_L0::link_id);
+            if (f0 & field::rdh_l0::packet_counter)    L0.packet_counter[r]    = ld<uint8_t>(line + off_L0::packet_counter);
+            if (f0 & field::rdh_l0::cru_id)            L0.cru_id[r]            = ld<uint16_t>(line + off_L0::cru_id) & 0x0FFF;
+            if (f0 & field::rdh_l0::bc)                L0.bc[r]                = ld<uint16_t>(line + off_L0::bc) & 0x0FFF;
+            if (f0 & field::rdh_l0::orbit)             L0.orbit[r]             = ld<uint32_t>(line + off_L0::orbit);
             break;
         }
-        case LineType::TRG: {
-            // std::cout << "[TRG ]" << std::endl;
-            // print in hex
-            ::bp::TrgLine t = parse_trg_line(line);
-            if (on_trg_line_) on_trg_line_(t, line);
+        case LineType::RDH_L1: {
+            const size_t r = i_l1++;
+            L1.offset[r] = off;
+            if (f1 & field::rdh_l1::trg_type)          L1.trg_type[r]          = ld<uint32_t>(line + off_L1::trg_type);
+            if (f1 & field::rdh_l1::hb_packet_counter) L1.hb_packet_counter[r] = ld<uint16_t>(line + off_L1::hb_packet_counter);
+            if (f1 & field::rdh_l1::stop_bit)          L1.stop_bit[r]          = ld<uint8_t>(line + off_L1::stop_bit);
+            if (f1 & field::rdh_l1::detector_field)    L1.detector_field[r]    = ld<uint32_t>(line + off_L1::detector_field);
             break;
         }
         default:
-            if (on_packet_) on_packet_(Packet{line});
+            out.undefined_offset.push_back(off);
             break;
         }
     }
+    return n;
 }
 
+const LineBatch& BatchDecoder::decode_batch(std::span<const std::byte> chunk) {
+    batch_.clear();
+    const std::size_t n = ::bp::decode_batch(chunk, batch_, next_offset_, fields_);
+    next_offset_ += n * ByteCursor::kLineSize;
+    return batch_;
+}
 
 } // namespace bp
\ No newline at end of file
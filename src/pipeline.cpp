@@ -0,0 +1,68 @@
+#include "binparse/pipeline.hpp"
+
+#include <algorithm>
+
+namespace bp {
+
+ChunkPipeline::ChunkPipeline(std::size_t slots, std::size_t slot_bytes, PipelineStats* stats)
+    : slot_bytes_(slot_bytes)
+    , slots_(std::max<std::size_t>(slots, 2))
+    , filled_(slots_.size())
+    , free_(slots_.size())
+    , stats_(stats ? stats : &own_stats_)
+{
+    for (uint32_t i = 0; i < slots_.size(); ++i) {
+        slots_[i].resize(slot_bytes_);
+        free_.try_push(i);
+    }
+}
+
+std::span<std::byte> ChunkPipeline::acquire() {
+    if (!free_.try_pop(writing_)) {
+        stats_->producer_stalls.fetch_add(1, std::memory_order_relaxed);
+        do {
+            if (!free_.wait_not_empty()) return {};
+        } while (!free_.try_pop(writing_));
+    }
+    if (cancelled()) return {};
+    return slots_[writing_];
+}
+
+void ChunkPipeline::commit(std::size_t n) {
+    // filled_ 的容量不小于槽位数，push 不会失败
+    filled_.try_push(Filled{writing_, n});
+
+    if (n) stats_->chunks.fetch_add(1, std::memory_order_relaxed);
+    stats_->bytes.fetch_add(n, std::memory_order_relaxed);
+    const uint32_t occ = stats_->occupancy.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t prev = stats_->max_occupancy.load(std::memory_order_relaxed);
+    while (occ > prev && !stats_->max_occupancy.compare_exchange_weak(prev, occ, std::memory_order_relaxed)) {}
+}
+
+void ChunkPipeline::close() {
+    filled_.close();
+}
+
+bool ChunkPipeline::pop(std::span<const std::byte>& out) {
+    Filled f;
+    if (!filled_.try_pop(f)) {
+        stats_->consumer_stalls.fetch_add(1, std::memory_order_relaxed);
+        do {
+            if (!filled_.wait_not_empty()) return false;
+        } while (!filled_.try_pop(f));
+    }
+    reading_ = f.slot;
+    out = std::span<const std::byte>(slots_[f.slot].data(), f.len);
+    return true;
+}
+
+void ChunkPipeline::release() {
+    stats_->occupancy.fetch_sub(1, std::memory_order_relaxed);
+    free_.try_push(reading_);
+}
+
+void ChunkPipeline::cancel() {
+    free_.close();
+}
+
+} // namespace bp
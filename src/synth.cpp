@@ -0,0 +1,151 @@
+#include "binparse/synth.hpp"
+#include "binparse/bytecursor.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace bp {
+namespace {
+
+constexpr uint16_t kBxPerOrbit = 3564;
+
+template <class T>
+void put(std::byte* p, std::size_t off, T v) {
+    if constexpr (sizeof(T) > 1 && std::endian::native == std::endian::big) v = std::byteswap(v);
+    std::memcpy(p + off, &v, sizeof(T));
+}
+
+} // namespace
+
+SynthStream::SynthStream(SynthOptions opt)
+    : opt_(opt)
+    , state_(opt.seed)
+    , orbit_(opt.first_orbit)
+    , links_(std::max<std::size_t>(opt.links, 1))
+{
+    opt_.links = links_.size();
+    // memory_size/offset_new_packet 是 16 位：对齐后的页长也不能超过 0xFFFF。
+    // 不超过 0xFFFF 的最大对齐倍数作为页长上限，页内行数按它收紧
+    if (opt_.page_align > 0xFFFF) opt_.page_align = 0;
+    const std::size_t max_stride = opt_.page_align ? 0xFFFF / opt_.page_align * opt_.page_align : 0xFFFF;
+    opt_.page_lines = std::clamp<std::size_t>(opt_.page_lines, 1, max_stride / ByteCursor::kLineSize - 2);
+    build_orbit();
+}
+
+// splitmix64
+uint64_t SynthStream::rand() noexcept {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// [0, 2*mean] 上的均匀整数，期望为 mean
+std::size_t SynthStream::draw(double mean) noexcept {
+    if (mean <= 0) return 0;
+    const double u = static_cast<double>(rand() >> 11) * 0x1.0p-53;
+    return static_cast<std::size_t>(u * (2 * mean + 1));
+}
+
+void SynthStream::build_orbit() {
+    for (std::size_t li = 0; li < links_.size(); ++li) {
+        auto& L = links_[li];
+        L.lines.clear();
+        L.bx.clear();
+        L.next = 0;
+        L.page = 0;
+        L.done = false;
+
+        std::vector<uint16_t> bxs(draw(opt_.triggers_per_orbit));
+        for (auto& bx : bxs) bx = static_cast<uint16_t>(rand() % kBxPerOrbit);
+        std::sort(bxs.begin(), bxs.end());
+
+        for (const uint16_t bx : bxs) {
+            Line& t = L.lines.emplace_back();
+            L.bx.push_back(bx);
+            put<uint32_t>(t.data(), 0, 0xBBBB);
+            put<uint64_t>(t.data(), 4, bx);
+            put<uint64_t>(t.data(), 12, orbit_);
+
+            const std::size_t nd = draw(opt_.data_per_trigger);
+            for (std::size_t k = 0; k < nd; ++k) {
+                Line& d = L.lines.emplace_back();
+                L.bx.push_back(bx);
+                put<uint8_t>(d.data(), 0, 0xAC);
+                put<uint8_t>(d.data(), 1, static_cast<uint8_t>(li));
+                put<uint16_t>(d.data(), 2, bx);
+                put<uint32_t>(d.data(), 4, orbit_);
+                for (std::size_t w = 0; w < 6; w += 2) put<uint64_t>(d.data(), 8 + 4 * w, rand());
+            }
+        }
+    }
+}
+
+std::size_t SynthStream::next_packet(std::vector<std::byte>& out) {
+    constexpr std::size_t kLine = ByteCursor::kLineSize;
+
+    // 所有 link 的帧都输出完：进入下一个 orbit
+    if (std::all_of(links_.begin(), links_.end(), [](const Link& l) { return l.done; })) {
+        ++orbit_;
+        build_orbit();
+    }
+    while (links_[cursor_].done) cursor_ = (cursor_ + 1) % links_.size();
+    const std::size_t li = cursor_;
+    cursor_ = (cursor_ + 1) % links_.size();
+
+    Link& L = links_[li];
+    const std::size_t n = std::min(opt_.page_lines, L.lines.size() - L.next);
+    const bool last = (L.next + n == L.lines.size());
+
+    const std::size_t mem = (2 + n) * kLine;
+    std::size_t stride = mem;
+    if (opt_.page_align > 0) stride = (mem + opt_.page_align - 1) / opt_.page_align * opt_.page_align;
+
+    const std::size_t at = out.size();
+    out.resize(at + stride); // 对齐空隙保持为 0
+    std::byte* p = out.data() + at;
+
+    const uint16_t bc = (n > 0) ? L.bx[L.next] : 0;
+
+    // RDH_L0
+    put<uint8_t>(p, 0, 0x07);                                           // header_version
+    put<uint8_t>(p, 1, 64);                                             // header_size
+    put<uint16_t>(p, 2, static_cast<uint16_t>(opt_.fee_id_base + li));
+    put<uint8_t>(p, 5, 0x20);                                           // system_id
+    put<uint16_t>(p, 8, static_cast<uint16_t>(stride));                 // offset_new_packet
+    put<uint16_t>(p, 10, static_cast<uint16_t>(mem));                   // memory_size
+    put<uint8_t>(p, 12, static_cast<uint8_t>(li));                      // link_id
+    put<uint8_t>(p, 13, L.packet_counter++);
+    put<uint16_t>(p, 14, static_cast<uint16_t>(opt_.cru_id & 0x0FFF));
+    put<uint16_t>(p, 16, static_cast<uint16_t>(bc & 0x0FFF));
+    put<uint32_t>(p, 20, orbit_);
+    put<uint8_t>(p, 24, 2);                                             // data_format
+
+    // RDH_L1
+    put<uint32_t>(p + kLine, 0, 0x0803);                                // trg_type（低字节 0x03）
+    put<uint16_t>(p + kLine, 4, L.page++);
+    put<uint8_t>(p + kLine, 6, last ? 1 : 0);
+
+    for (std::size_t k = 0; k < n; ++k)
+        std::memcpy(p + (2 + k) * kLine, L.lines[L.next + k].data(), kLine);
+
+    L.next += n;
+    L.done = last;
+    ++packets_;
+    return stride;
+}
+
+void SynthStream::generate(std::vector<std::byte>& out, std::size_t bytes) {
+    const std::size_t target = out.size() + bytes;
+    out.reserve(target + (opt_.page_lines + 2) * ByteCursor::kLineSize + opt_.page_align);
+    while (out.size() < target) next_packet(out);
+}
+
+std::vector<std::byte> SynthStream::generate(std::size_t bytes) {
+    std::vector<std::byte> out;
+    generate(out, bytes);
+    return out;
+}
+
+} // namespace bp
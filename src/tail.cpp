@@ -1,7 +1,14 @@
 #include "binparse/tail.hpp"
+#include "binparse/chunk_pool.hpp"
+#include "binparse/metrics.hpp"
+#include "binparse/pipeline.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <functional>
@@ -9,9 +16,15 @@
 #include <stdexcept>
 #include <system_error>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#ifdef __linux__
+  #include <poll.h>
+  #include <sys/inotify.h>
+#endif
 #ifndef _WIN32
+  #include <sys/mman.h>
   #include <sys/stat.h>
   #include <fcntl.h>
   #include <unistd.h>
@@ -19,9 +32,255 @@
 
 namespace bp {
 
-void tail_growing_file(const std::string& path,
-                       TailOptions opt,
-                       const std::function<void(std::span<const std::byte>)>& on_bytes)
+namespace {
+bool stop_requested(const TailOptions& opt) noexcept {
+    return opt.stop && opt.stop->load(std::memory_order_relaxed);
+}
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point t0) noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count());
+}
+
+void note_read(const TailOptions& opt, std::size_t n) noexcept {
+    if (!opt.metrics) return;
+    opt.metrics->reads.fetch_add(1, std::memory_order_relaxed);
+    opt.metrics->bytes_read.fetch_add(n, std::memory_order_relaxed);
+}
+
+void note_reopen(const TailOptions& opt, bool rotated) noexcept {
+    if (!opt.metrics) return;
+    (rotated ? opt.metrics->rotations : opt.metrics->truncations).fetch_add(1, std::memory_order_relaxed);
+}
+} // namespace
+
+#ifndef _WIN32
+namespace {
+
+// 无新数据时的等待。Linux 上用 inotify（IN_MODIFY / IN_ATTRIB / IN_MOVE_SELF / IN_DELETE_SELF），
+// 写入后立即唤醒，poll_ms 只作兜底超时；否则退化为固定 sleep。
+class ChangeWaiter {
+public:
+    ChangeWaiter(const TailOptions& opt, std::chrono::milliseconds poll) : poll_(poll) {
+        if (opt.latency_target_us > 0)
+            sleep_ = std::min<std::chrono::microseconds>(poll, std::chrono::microseconds(opt.latency_target_us));
+        else
+            sleep_ = poll;
+#ifdef __linux__
+        if (opt.notify) in_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    }
+    ~ChangeWaiter() {
+        if (in_fd_ >= 0) ::close(in_fd_);
+    }
+    ChangeWaiter(const ChangeWaiter&) = delete;
+    ChangeWaiter& operator=(const ChangeWaiter&) = delete;
+
+    // (重新) 监视 path 指向的当前文件，并清除 moved 标记
+    void watch(const std::string& path) {
+        moved_ = false;
+#ifdef __linux__
+        if (in_fd_ < 0) return;
+        if (wd_ >= 0) ::inotify_rm_watch(in_fd_, wd_);
+        wd_ = ::inotify_add_watch(in_fd_, path.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+#else
+        (void)path;
+#endif
+    }
+
+    void wait() {
+#ifdef __linux__
+        if (in_fd_ >= 0 && wd_ >= 0) {
+            struct pollfd pfd{in_fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, static_cast<int>(poll_.count())) > 0) drain();
+            return;
+        }
+#endif
+        std::this_thread::sleep_for(sleep_);
+    }
+
+    // 文件可能已被移走或删除（轮转的信号），直到下一次 watch() 前保持为 true。
+    // 没有 inotify 监视时无法得知，总是返回 true，由调用方 stat(path) 确认。
+    bool moved() const noexcept { return moved_ || wd_ < 0; }
+
+private:
+#ifdef __linux__
+    void drain() {
+        alignas(struct inotify_event) char buf[4096];
+        for (;;) {
+            const ssize_t n = ::read(in_fd_, buf, sizeof(buf));
+            if (n <= 0) return;
+            for (ssize_t i = 0; i < n; ) {
+                const auto* ev = reinterpret_cast<const struct inotify_event*>(buf + i);
+                // unlink 时我们仍持有 fd，IN_DELETE_SELF 不会触发；链接数变化只报 IN_ATTRIB，
+                // 同样当作可能已轮转，由调用方 stat(path) 确认
+                if (ev->mask & (IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)) moved_ = true;
+                if ((ev->mask & IN_IGNORED) && ev->wd == wd_) wd_ = -1; // 文件已删除，退回兜底轮询（旧 watch 的迟到事件不算）
+                i += static_cast<ssize_t>(sizeof(struct inotify_event) + ev->len);
+            }
+        }
+    }
+#endif
+
+    std::chrono::milliseconds poll_;
+    std::chrono::microseconds sleep_{};
+    int  in_fd_ = -1;
+    int  wd_    = -1;
+    bool moved_ = false;
+};
+
+// 收到 moved 信号后，path 现在是否指向另一个 inode（新文件已出现）
+bool path_replaced(const std::string& path, ino_t ino) {
+    struct stat ps{};
+    return ::stat(path.c_str(), &ps) == 0 && ps.st_ino != ino;
+}
+
+// 关闭旧 fd，打开 path 当前指向的文件并更新 ino
+void reopen(int& fd, const std::string& path, ino_t& ino) {
+    ::close(fd);
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("reopen failed: " + path);
+    struct stat st{};
+    if (fstat(fd, &st) == 0) ino = st.st_ino;
+}
+
+// 一段映射：[file_off, file_off+len) 映射在 base
+struct MapWindow {
+    std::byte* base     = nullptr;
+    off_t      file_off = 0;
+    std::size_t len     = 0;
+};
+
+// 零拷贝版本：span 直接指向映射；窗口的保留规则见 TailOptions::use_mmap
+void tail_mmap(const std::string& path,
+               TailOptions opt,
+               const std::function<void(std::span<const std::byte>)>& on_bytes)
+{
+    using namespace std::chrono;
+
+    const auto poll = (opt.poll_ms > 0) ? milliseconds(opt.poll_ms) : milliseconds(50);
+    const std::size_t chunk = (opt.read_chunk > 0) ? opt.read_chunk : (1u << 20);
+    const bool use_timeout = (opt.inactivity_timeout_ms > 0);
+    const auto timeout = milliseconds(opt.inactivity_timeout_ms);
+    const auto page = static_cast<off_t>(::sysconf(_SC_PAGESIZE));
+    const auto window = static_cast<off_t>(std::max<std::size_t>(opt.mmap_window, chunk));
+
+    auto last_activity = steady_clock::now();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("open failed: " + path);
+
+    ChangeWaiter waiter(opt, poll);
+    waiter.watch(path);
+
+    std::deque<MapWindow>  maps;    // 当前文件的窗口，最新的在尾部
+    std::vector<MapWindow> retired; // 轮转/截断前的窗口，新文件第一块交出后释放
+    auto unmap = [](MapWindow& m) noexcept {
+        if (m.base) ::munmap(m.base, m.len);
+        m.base = nullptr;
+    };
+    auto release_retired = [&]() noexcept {
+        for (auto& m : retired) unmap(m);
+        retired.clear();
+    };
+    auto cleanup = [&] {
+        for (auto& m : maps) unmap(m);
+        release_retired();
+        if (fd >= 0) ::close(fd);
+    };
+
+    off_t pos = 0;
+    ino_t ino = 0;
+    {
+        struct stat st{};
+        if (fstat(fd, &st) == 0) ino = st.st_ino;
+    }
+    bool idle = false; // 已报告过 on_idle，之后还没读到数据
+
+    try {
+        while (!stop_requested(opt)) {
+            struct stat st{};
+            if (fstat(fd, &st) != 0) {
+                waiter.wait();
+                if (use_timeout && (steady_clock::now() - last_activity > timeout)) break;
+                continue;
+            }
+
+            // 轮转（旧文件读完后才切换）或截断：旧窗口暂留（最后交出的 span 不立即失效），从新文件头开始
+            const bool rotated = waiter.moved() && st.st_size <= pos && path_replaced(path, ino);
+            if (rotated || st.st_size < pos) {
+                note_reopen(opt, rotated);
+                reopen(fd, path, ino);
+                waiter.watch(path);
+                pos = 0;
+                retired.insert(retired.end(), maps.begin(), maps.end());
+                maps.clear();
+                continue;
+            }
+
+            if (st.st_size > pos) {
+                // 当前窗口不覆盖 [pos, size) 时，从 pos 的页边界重新映射一个窗口
+                MapWindow* cur = maps.empty() ? nullptr : &maps.back();
+                if (!cur || cur->file_off + static_cast<off_t>(cur->len) < st.st_size) {
+                    MapWindow m;
+                    m.file_off = pos - pos % page;
+                    m.len = static_cast<std::size_t>(std::max(window, st.st_size - m.file_off));
+                    // 映射可以超出 EOF：文件长到窗口内时新数据直接可见
+                    void* p = ::mmap(nullptr, m.len, PROT_READ, MAP_SHARED, fd, m.file_off);
+                    if (p == MAP_FAILED) throw std::runtime_error("mmap failed: " + path);
+                    m.base = static_cast<std::byte*>(p);
+                    ::madvise(m.base, m.len, MADV_SEQUENTIAL);
+                    maps.push_back(m);
+                    while (maps.size() - 1 > opt.mmap_retain_windows) {
+                        unmap(maps.front());
+                        maps.pop_front();
+                    }
+                    cur = &maps.back();
+                }
+
+                const off_t end = st.st_size;
+                while (pos < end && !stop_requested(opt)) {
+                    const auto n = static_cast<std::size_t>(std::min<off_t>(static_cast<off_t>(chunk), end - pos));
+                    std::byte* p = cur->base + (pos - cur->file_off);
+
+                    // 预读下一块，让缺页在回调解析当前块时发生
+                    const off_t ahead = pos + static_cast<off_t>(n);
+                    if (ahead < end) {
+                        const off_t a0 = ahead - ahead % page;
+                        const auto alen = static_cast<std::size_t>(
+                            std::min<off_t>(static_cast<off_t>(chunk), end - a0));
+                        ::madvise(cur->base + (a0 - cur->file_off), alen, MADV_WILLNEED);
+                    }
+
+                    pos += static_cast<off_t>(n);
+                    last_activity = steady_clock::now();
+                    note_read(opt, n);
+                    idle = false;
+                    on_bytes(std::span<const std::byte>(p, n));
+                    if (!retired.empty()) release_retired(); // 新文件的数据已被消费
+                }
+            } else {
+                if (!idle && opt.on_idle) opt.on_idle();
+                idle = true;
+                waiter.wait();
+            }
+
+            if (use_timeout && (steady_clock::now() - last_activity > timeout)) break;
+        }
+    } catch (...) {
+        cleanup();
+        throw;
+    }
+    cleanup();
+}
+
+// pread 读循环：每次读进 acquire() 给出的缓冲（至少 read_chunk 字节，nullptr 表示停止），
+// 读到的字节交给 deliver()；stop 置位后尽快返回。acquire() 只在上一块已交出后才再调用：
+// 没读到数据（截断、EINTR 等）时缓冲留到下次重试，不会从流水线/池里漏掉槽位。
+// 读到当前末尾、开始等待前调用一次 idle()（此时没有持有缓冲）。
+template <class Acquire, class Deliver, class Idle>
+void pread_loop(const std::string& path, const TailOptions& opt,
+                Acquire&& acquire, Deliver&& deliver, Idle&& idle, const std::atomic<bool>* stop)
 {
     using namespace std::chrono;
 
@@ -33,14 +292,9 @@ void tail_growing_file(const std::string& path,
 
     auto last_activity = steady_clock::now(); // 最近一次读到新数据的时间
 
-#ifndef _WIN32
-    // -------- POSIX 版本（使用 open/fstat/pread）--------
     int fd = ::open(path.c_str(), O_RDONLY);
     if (fd < 0) throw std::runtime_error("open failed: " + path);
 
-    std::vector<std::byte> buf;
-    buf.resize(chunk);
-
     off_t pos = 0;
     ino_t ino = 0;
     {
@@ -48,22 +302,37 @@ void tail_growing_file(const std::string& path,
         if (fstat(fd, &st) == 0) ino = st.st_ino;
     }
 
+    ChangeWaiter waiter(opt, poll);
+    waiter.watch(path);
+
+    struct FdCloser {
+        int& fd;
+        ~FdCloser() { if (fd >= 0) ::close(fd); }
+    } closer{fd};
+
+    std::byte* buf = nullptr; // 已取得、尚未交出的缓冲
+    bool idle_sent = false;   // 已报告过空闲，之后还没读到数据
+
     for (;;) {
+        if (stop && stop->load(std::memory_order_relaxed)) return;
+        if (stop_requested(opt)) return;
+
         struct stat st{};
         if (fstat(fd, &st) != 0) {
-            std::this_thread::sleep_for(poll);
+            waiter.wait();
             if (use_timeout && (steady_clock::now() - last_activity > timeout)) return;
             continue;
         }
 
-        // 轮转或截断
-        if (st.st_ino != ino || st.st_size < pos) {
-            ::close(fd);
-            fd = ::open(path.c_str(), O_RDONLY);
-            if (fd < 0) throw std::runtime_error("reopen failed: " + path);
+        // 轮转（旧文件读完后才切换）或截断
+        const bool rotated = waiter.moved() && st.st_size <= pos && path_replaced(path, ino);
+        if (rotated || st.st_size < pos) {
+            note_reopen(opt, rotated);
+            reopen(fd, path, ino);
+            waiter.watch(path);
             pos = 0;
-            ino = st.st_ino;
             // 轮转/截断不算活动，只有真正读到字节时才刷新 last_activity
+            continue;
         }
 
         if (st.st_size > pos) {
@@ -71,32 +340,126 @@ void tail_growing_file(const std::string& path,
             const std::size_t to_read = static_cast<std::size_t>(
                 std::min<off_t>(static_cast<off_t>(chunk), avail));
 
-            ssize_t n = ::pread(fd, buf.data(), to_read, pos);
+            if (!buf) buf = acquire();
+            if (!buf) return;
+            const auto t_read = steady_clock::now();
+            ssize_t n = ::pread(fd, buf, to_read, pos);
+            if (opt.metrics) opt.metrics->read_ns.record(elapsed_ns(t_read));
             if (n > 0) {
                 pos += n;
+                note_read(opt, static_cast<std::size_t>(n));
                 last_activity = steady_clock::now(); // 读到新数据，刷新活动时间
-                on_bytes(std::span<const std::byte>(buf.data(), static_cast<std::size_t>(n)));
+                idle_sent = false;
+                deliver(std::span<const std::byte>(std::exchange(buf, nullptr), static_cast<std::size_t>(n)));
             } else {
-                // 没读到（例如被另一进程占用），休眠后再试
-                std::this_thread::sleep_for(poll);
+                // 没读到（例如被另一进程占用），等待后再试
+                waiter.wait();
             }
         } else {
-            // 没有新增
-            std::this_thread::sleep_for(poll);
+            // 没有新增：等待写入事件（或兜底超时）
+            if (!idle_sent && !buf) {
+                idle_sent = true;
+                idle();
+            }
+            waiter.wait();
         }
 
         if (use_timeout && (steady_clock::now() - last_activity > timeout)) return;
     }
+}
+
+// 读与解析重叠：后台线程 pread 进流水线的槽位（生产），调用线程跑 on_bytes（消费），
+// 下一块在回调处理当前块时已读进内存
+void tail_read_ahead(const std::string& path,
+                     TailOptions opt,
+                     const std::function<void(std::span<const std::byte>)>& on_bytes)
+{
+    const std::size_t chunk = (opt.read_chunk > 0) ? opt.read_chunk : (1u << 20);
+    ChunkPipeline pipe(opt.read_ahead, chunk, opt.pipeline_stats);
+    std::atomic<bool> stop{false};
+    std::exception_ptr err;
+
+    std::thread reader([&] {
+        try {
+            pread_loop(path, opt,
+                       [&] {
+                           auto slot = pipe.acquire();
+                           if (slot.empty()) stop.store(true);
+                           return slot.empty() ? nullptr : slot.data();
+                       },
+                       [&](std::span<const std::byte> bytes) { pipe.commit(bytes.size()); },
+                       [&] {
+                           // 空块作空闲标记，排在已读的块之后交给调用线程
+                           if (!opt.on_idle || pipe.acquire().empty()) return;
+                           pipe.commit(0);
+                       },
+                       &stop);
+        } catch (...) {
+            err = std::current_exception();
+        }
+        pipe.close();
+    });
+
+    try {
+        std::span<const std::byte> bytes;
+        while (pipe.pop(bytes)) {
+            if (!bytes.empty()) on_bytes(bytes);
+            else opt.on_idle();
+            pipe.release();
+        }
+    } catch (...) {
+        stop.store(true);
+        pipe.cancel();
+        reader.join();
+        throw;
+    }
+    reader.join();
+    if (err) std::rethrow_exception(err);
+}
+
+} // namespace
+#endif
+
+namespace {
+
+void tail_impl(const std::string& path,
+               TailOptions opt,
+               const std::function<void(std::span<const std::byte>)>& on_bytes)
+{
+#ifndef _WIN32
+    // -------- POSIX 版本（使用 open/fstat/pread）--------
+    if (opt.use_mmap) return tail_mmap(path, opt, on_bytes);
+    if (opt.read_ahead >= 2) return tail_read_ahead(path, opt, on_bytes);
+
+    const std::size_t chunk = (opt.read_chunk > 0) ? opt.read_chunk : (1u << 20);
+    std::vector<std::byte> buf;
+    buf.resize(chunk);
+    pread_loop(path, opt,
+               [&] { return buf.data(); },
+               [&](std::span<const std::byte> bytes) { on_bytes(bytes); },
+               [&] { if (opt.on_idle) opt.on_idle(); },
+               nullptr);
 
 #else
+    using namespace std::chrono;
+
+    const auto poll = (opt.poll_ms > 0) ? milliseconds(opt.poll_ms) : milliseconds(50);
+    const std::size_t chunk = (opt.read_chunk > 0) ? opt.read_chunk : (1u << 20);
+
+    const bool use_timeout = (opt.inactivity_timeout_ms > 0);
+    const auto timeout = milliseconds(opt.inactivity_timeout_ms);
+
+    auto last_activity = steady_clock::now(); // 最近一次读到新数据的时间
+
     // -------- Windows / 可移植版本（ifstream + filesystem 轮询）--------
     std::vector<std::byte> buf;
     buf.resize(chunk);
 
     std::error_code ec;
     uintmax_t pos = 0;
+    bool idle = false; // 已报告过 on_idle，之后还没读到数据
 
-    for (;;) {
+    while (!stop_requested(opt)) {
         ec.clear();
         const auto size_now = std::filesystem::file_size(path, ec);
         if (ec) {
@@ -107,6 +470,7 @@ void tail_growing_file(const std::string& path,
 
         // 截断或轮转
         if (size_now < pos) {
+            note_reopen(opt, false);
             pos = 0;
         }
 
@@ -120,19 +484,25 @@ void tail_growing_file(const std::string& path,
             in.seekg(static_cast<std::streamoff>(pos), std::ios::beg);
 
             uintmax_t remaining = size_now - pos;
-            while (remaining > 0) {
+            while (remaining > 0 && !stop_requested(opt)) {
                 const std::size_t to_read = static_cast<std::size_t>(
                     std::min<uintmax_t>(buf.size(), remaining));
+                const auto t_read = steady_clock::now();
                 in.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(to_read));
+                if (opt.metrics) opt.metrics->read_ns.record(elapsed_ns(t_read));
                 const auto got = static_cast<std::size_t>(in.gcount());
                 if (got == 0) break;
+                note_read(opt, got);
 
                 last_activity = steady_clock::now(); // 读到新数据
+                idle = false;
                 on_bytes(std::span<const std::byte>(buf.data(), got));
                 remaining -= got;
                 pos       += got;
             }
         } else {
+            if (!idle && opt.on_idle) opt.on_idle();
+            idle = true;
             std::this_thread::sleep_for(poll);
         }
 
@@ -141,4 +511,84 @@ void tail_growing_file(const std::string& path,
 #endif
 }
 
-} // namespace bp
\ No newline at end of file
+// 租约模式：POSIX 下直接 pread 进池中的块，否则从 tail_impl 的读缓冲拷入
+void tail_leases(const std::string& path,
+                 TailOptions opt,
+                 ChunkPool& pool,
+                 const std::function<void(ChunkLease)>& on_chunk)
+{
+    const auto poll = std::chrono::milliseconds(opt.poll_ms > 0 ? opt.poll_ms : 50);
+    const std::size_t chunk = std::min((opt.read_chunk > 0) ? opt.read_chunk : (1u << 20), pool.chunk_bytes());
+    opt.read_chunk = chunk;
+    uint64_t offset = 0;
+
+    // 池耗尽时等待，期间每 poll 检查一次停止标志；拿不到（停止或池已关闭）时返回空租约
+    auto lease_one = [&] {
+        for (;;) {
+            if (ChunkLease l = pool.acquire_for(poll); l || pool.closed() || stop_requested(opt)) return l;
+        }
+    };
+    auto deliver = [&](ChunkLease& l, std::size_t n) {
+        l.set_bytes(n, offset);
+        offset += n;
+        on_chunk(std::move(l));
+    };
+
+#ifndef _WIN32
+    ChunkLease cur;
+    pread_loop(path, opt,
+               [&]() -> std::byte* {
+                   cur = lease_one();
+                   return cur ? cur.writable().data() : nullptr;
+               },
+               [&](std::span<const std::byte> bytes) { deliver(cur, bytes.size()); },
+               [&] { if (opt.on_idle) opt.on_idle(); },
+               nullptr);
+#else
+    opt.use_mmap = false;
+    tail_impl(path, opt, [&](std::span<const std::byte> bytes) {
+        while (!bytes.empty()) {
+            ChunkLease l = lease_one();
+            if (!l) return;
+            const std::size_t n = std::min(bytes.size(), l.writable().size());
+            std::memcpy(l.writable().data(), bytes.data(), n);
+            deliver(l, n);
+            bytes = bytes.subspan(n);
+        }
+    });
+#endif
+}
+
+} // namespace
+
+void tail_growing_file(const std::string& path,
+                       TailOptions opt,
+                       const std::function<void(std::span<const std::byte>)>& on_bytes)
+{
+    if (!opt.metrics) return tail_impl(path, opt, on_bytes);
+
+    // 回调耗时在调用 on_bytes 的线程上测（预读模式下即解析线程）
+    DecoderMetrics* m = opt.metrics;
+    tail_impl(path, opt, [&on_bytes, m](std::span<const std::byte> bytes) {
+        const auto t0 = std::chrono::steady_clock::now();
+        on_bytes(bytes);
+        m->callback_ns.record(elapsed_ns(t0));
+    });
+}
+
+void tail_growing_file(const std::string& path,
+                       TailOptions opt,
+                       ChunkPool& pool,
+                       const std::function<void(ChunkLease)>& on_chunk)
+{
+    if (!opt.metrics) return tail_leases(path, opt, pool, on_chunk);
+
+    DecoderMetrics* m = opt.metrics;
+    tail_leases(path, opt, pool, [&on_chunk, m](ChunkLease lease) {
+        const auto t0 = std::chrono::steady_clock::now();
+        on_chunk(std::move(lease));
+        m->callback_ns.record(elapsed_ns(t0));
+    });
+}
+
+} // namespace bp
@@ -0,0 +1,118 @@
+// codec 往返测试：compress → decompress / decompress_stream → 逐字节比较
+#include "binparse/codec.hpp"
+#include "binparse/synth.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (ok) return;
+    ++failures;
+    std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+}
+
+bool same(const std::vector<std::byte>& a, const std::vector<std::byte>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
+struct Mix {
+    const char*      name;
+    bp::SynthOptions opt;
+};
+
+// 与 bpx_bench 相同的几种合成流
+std::vector<Mix> mixes() {
+    bp::SynthOptions base;
+    Mix def{"default", base};
+    Mix data{"data_heavy", base};
+    data.opt.triggers_per_orbit = 4;
+    data.opt.data_per_trigger = 60;
+    Mix rdh{"rdh_heavy", base};
+    rdh.opt.triggers_per_orbit = 2;
+    rdh.opt.data_per_trigger = 2;
+    rdh.opt.page_lines = 4;
+    Mix trg{"trg_heavy", base};
+    trg.opt.triggers_per_orbit = 64;
+    trg.opt.data_per_trigger = 1;
+    Mix padded{"padded_8k", base};
+    padded.opt.page_align = 8192;
+    return {def, data, rdh, trg, padded};
+}
+
+void roundtrip(const std::vector<std::byte>& raw, std::size_t block_bytes, const std::string& tag) {
+    for (unsigned threads : {1u, 2u, 4u}) {
+        const std::string what = tag + " block=" + std::to_string(block_bytes) + " threads=" + std::to_string(threads);
+        bp::CodecOptions opt;
+        opt.block_bytes = block_bytes;
+        opt.threads = threads;
+        const auto packed = bp::compress(raw, opt);
+        check(bp::decompressed_size(packed) == raw.size(), what + ": decompressed_size");
+        check(same(bp::decompress(packed, threads), raw), what + ": decompress");
+
+        std::vector<std::byte> out;
+        out.reserve(raw.size());
+        bp::decompress_stream(packed, [&](std::span<const std::byte> b) { out.insert(out.end(), b.begin(), b.end()); },
+                              threads);
+        check(same(out, raw), what + ": decompress_stream");
+    }
+}
+
+// 回调抛出的异常原样传出，解码线程被收回
+void stream_rethrows() {
+    const auto raw = bp::SynthStream().generate(256u << 10);
+    bp::CodecOptions opt;
+    opt.block_bytes = 4096;
+    const auto packed = bp::compress(raw, opt);
+    for (unsigned threads : {1u, 3u}) {
+        std::size_t calls = 0;
+        bool caught = false;
+        try {
+            bp::decompress_stream(packed, [&](std::span<const std::byte>) {
+                if (++calls == 5) throw std::runtime_error("stop");
+            }, threads);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        check(caught && calls == 5, "callback exception, threads=" + std::to_string(threads));
+    }
+}
+
+} // namespace
+
+int main() {
+    for (const auto& m : mixes()) {
+        const auto raw = bp::SynthStream(m.opt).generate(1u << 20);
+        for (std::size_t bs : {std::size_t{256} << 10, std::size_t{4096}, std::size_t{100}, std::size_t{32}})
+            roundtrip(raw, bs, m.name);
+
+        // 不足一行的尾部
+        for (std::size_t cut : {1u, 7u, 31u, 33u}) {
+            std::vector<std::byte> odd(raw.begin(), raw.end() - static_cast<std::ptrdiff_t>(cut));
+            roundtrip(odd, 4096, std::string(m.name) + " minus " + std::to_string(cut));
+        }
+    }
+
+    // 边界输入：空、不足一行、一整行、任意字节
+    roundtrip({}, 4096, "empty");
+    std::vector<std::byte> junk(1000);
+    for (std::size_t i = 0; i < junk.size(); ++i) junk[i] = static_cast<std::byte>(i * 131 + 7);
+    roundtrip(std::vector<std::byte>(junk.begin(), junk.begin() + 13), 32, "13 bytes");
+    roundtrip(std::vector<std::byte>(junk.begin(), junk.begin() + 32), 32, "one line");
+    roundtrip(junk, 64, "junk");
+
+    stream_rethrows();
+
+    if (failures) {
+        std::fprintf(stderr, "%d failure(s)\n", failures);
+        return 1;
+    }
+    std::puts("codec_roundtrip: ok");
+    return 0;
+}
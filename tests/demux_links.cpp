@@ -0,0 +1,140 @@
+// LinkDemux 测试：交错的多 link 流拆分后，每个 link 的 payload 行按原顺序落到自己的批里
+#include "binparse/demux.hpp"
+#include "binparse/synth.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (ok) return;
+    ++failures;
+    std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+}
+
+constexpr std::size_t kLine = bp::ByteCursor::kLineSize;
+
+// 直接按 RDH 字段切出每个 link 的 payload（合成流无对齐空隙：memory_size == offset_new_packet）
+std::map<int, std::vector<std::byte>> expected_payloads(const std::vector<std::byte>& raw) {
+    std::map<int, std::vector<std::byte>> out;
+    for (std::size_t at = 0; at + 2 * kLine <= raw.size();) {
+        uint16_t mem = 0;
+        std::memcpy(&mem, raw.data() + at + 10, sizeof(mem));
+        const int link = static_cast<int>(raw[at + 12]);
+        auto& v = out[link];
+        v.insert(v.end(), raw.begin() + static_cast<std::ptrdiff_t>(at + 2 * kLine),
+                 raw.begin() + static_cast<std::ptrdiff_t>(at + mem));
+        at += mem;
+    }
+    return out;
+}
+
+struct Collected {
+    std::mutex                                mu;
+    std::map<int, std::vector<std::byte>>     bytes;
+    std::map<int, std::thread::id>            thread;
+    std::map<int, bp::LinkKey>                key;
+    bool                                      moved_thread = false;
+};
+
+void interleaved(std::size_t consumers, std::size_t batch_bytes, std::size_t chunk) {
+    const std::string what = "consumers=" + std::to_string(consumers) + " batch=" + std::to_string(batch_bytes) +
+                             " chunk=" + std::to_string(chunk);
+    bp::SynthOptions so;
+    so.links = 6;
+    so.page_lines = 7; // 小页：各 link 的包密集交错
+    const auto raw = bp::SynthStream(so).generate(2u << 20);
+    const auto want = expected_payloads(raw);
+
+    Collected got;
+    bp::DemuxOptions opt;
+    opt.consumers = consumers;
+    opt.batch_bytes = batch_bytes;
+    opt.queue_batches = 4;
+    std::size_t orphans = 0;
+    {
+        bp::LinkDemux demux(opt, [&](const bp::LinkKey& k, std::span<const std::byte> lines) {
+            std::lock_guard lk(got.mu);
+            const int link = k.link_id;
+            auto [it, first] = got.thread.try_emplace(link, std::this_thread::get_id());
+            if (!first && it->second != std::this_thread::get_id()) got.moved_thread = true;
+            got.key[link] = k;
+            auto& v = got.bytes[link];
+            v.insert(v.end(), lines.begin(), lines.end());
+        });
+        for (std::size_t at = 0; at < raw.size(); at += chunk)
+            demux.feed(std::span(raw).subspan(at, std::min(chunk, raw.size() - at)));
+        demux.close();
+        orphans = demux.orphan_lines();
+    }
+
+    check(orphans == 0, what + ": orphan lines");
+    check(!got.moved_thread, what + ": a link's batches arrived on more than one thread");
+    check(got.bytes.size() == want.size(), what + ": link count");
+    for (const auto& [link, bytes] : want) {
+        const auto it = got.bytes.find(link);
+        check(it != got.bytes.end() && it->second == bytes, what + ": payload of link " + std::to_string(link));
+        const auto k = got.key[link];
+        check(k.cru_id == so.cru_id && k.fee_id == so.fee_id_base + link, what + ": key of link " + std::to_string(link));
+    }
+}
+
+// 第一个 RDH_L0 之前的行无法归属
+void leading_orphans() {
+    auto raw = bp::SynthStream().generate(64u << 10);
+    std::vector<std::byte> line(kLine);
+    line[0] = std::byte{0xAC};
+    raw.insert(raw.begin(), line.begin(), line.end());
+    raw.insert(raw.begin(), line.begin(), line.end());
+
+    bp::LinkDemux demux({}, [](const bp::LinkKey&, std::span<const std::byte>) {});
+    demux.feed(raw);
+    demux.close();
+    check(demux.orphan_lines() == 2, "leading orphan lines");
+}
+
+// 消费者抛出的异常在 close() 里重新抛出
+void consumer_rethrows() {
+    const auto raw = bp::SynthStream().generate(256u << 10);
+    bp::DemuxOptions opt;
+    opt.consumers = 2;
+    opt.batch_bytes = 4096;
+    bool caught = false;
+    try {
+        bp::LinkDemux demux(opt, [](const bp::LinkKey&, std::span<const std::byte>) {
+            throw std::runtime_error("stop");
+        });
+        demux.feed(raw);
+        demux.close();
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    check(caught, "consumer exception");
+}
+
+} // namespace
+
+int main() {
+    for (std::size_t consumers : {1u, 3u})
+        for (std::size_t batch : {std::size_t{kLine}, std::size_t{4096}, std::size_t{64} << 10})
+            for (std::size_t chunk : {std::size_t{1000}, std::size_t{1} << 20})
+                interleaved(consumers, batch, chunk);
+    leading_orphans();
+    consumer_rethrows();
+
+    if (failures) {
+        std::fprintf(stderr, "%d failure(s)\n", failures);
+        return 1;
+    }
+    std::puts("demux_links: ok");
+    return 0;
+}